@@ -0,0 +1,7 @@
+#version 330 core
+// Zapis koloru i głębi wyłączony, liczy się tylko ilość próbek, które przeszły test głębi
+out vec4 color;
+
+void main(){
+   color = vec4( 1.0 );
+}
@@ -0,0 +1,10 @@
+#version 330 core
+// Wierzchołki sześcianu [0, 1]
+layout ( location = 0 ) in vec3 position;
+
+// projection * view * translate( Min ) * scale( Max - Min ), liczone na CPU dla każdego testowanego prostopadłościanu
+uniform mat4 boxMatrix;
+
+void main(){
+   gl_Position = boxMatrix * vec4( position, 1.0 );
+}
@@ -5,15 +5,24 @@ struct Material_{
    sampler2D Texture_specular;
 };
 
+// Dane klatki (jeden bufor uniformów), ten sam układ co w Shader.vert
 struct Directional_Light{
-   vec3 Position;
-   vec3 Ambient;
-   vec3 Diffuse;
-   vec3 Specular;
+   vec4 Position;
+   vec4 Ambient;
+   vec4 Diffuse;
+   vec4 Specular;
 };
 
 #define Max_Directional_Light 2
 
+layout ( std140 ) uniform FrameData{
+   mat4 view;
+   mat4 projection;
+   mat4 viewProjection;
+   vec4 ViewPos;
+   Directional_Light DirectionalLight[Max_Directional_Light];
+};
+
 in vec2 UV;
 in vec3 Normal;
 in vec3 FragPos;
@@ -21,15 +30,13 @@ in vec3 FragPos;
 out vec4 color;
 
 uniform Material_ Material;
-uniform Directional_Light DirectionalLight[Max_Directional_Light];
-uniform vec3 ViewPos;
 
 vec3 CalculateDirectionalLight( Directional_Light DirectionalLight_, vec3 normal_, vec3 viewDir_, vec3 fragPos_ );
 
 void main()
 {
    vec3 normal = normalize( Normal );
-   vec3 viewDir = normalize( ViewPos - FragPos );
+   vec3 viewDir = normalize( ViewPos.xyz - FragPos );
    vec3 result = vec3( 0.0f );
    for( int i = 0; i < Max_Directional_Light; ++i ){
       result += CalculateDirectionalLight( DirectionalLight[i], normal, viewDir, FragPos  );
@@ -38,15 +45,15 @@ void main()
 }
 
 vec3 CalculateDirectionalLight( Directional_Light DirectionalLight_, vec3 normal_, vec3 viewDir_, vec3 fragPos_ ){
-   vec3 lightDir = normalize( DirectionalLight_.Position - fragPos_ );
+   vec3 lightDir = normalize( DirectionalLight_.Position.xyz - fragPos_ );
    // Diffuse shading
    float diff = max( dot( normal_, lightDir ), 0.0 );
    // Specular shading
    vec3 reflectDir = reflect( -lightDir, normal_ );
    float spec = pow( max( dot( viewDir_, reflectDir ), 0.0 ), 32.0 );
    // Combine results
-   vec3 ambient = DirectionalLight_.Ambient * vec3( texture( Material.Texture, UV ) );
-   vec3 diffuse = DirectionalLight_.Diffuse * diff * vec3( texture( Material.Texture, UV ) );
-   vec3 specular = DirectionalLight_.Specular * spec * vec3( texture( Material.Texture_specular, UV ) );
+   vec3 ambient = DirectionalLight_.Ambient.xyz * vec3( texture( Material.Texture, UV ) );
+   vec3 diffuse = DirectionalLight_.Diffuse.xyz * diff * vec3( texture( Material.Texture, UV ) );
+   vec3 specular = DirectionalLight_.Specular.xyz * spec * vec3( texture( Material.Texture_specular, UV ) );
    return ( ambient + diffuse + specular );
 }
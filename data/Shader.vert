@@ -1,20 +1,71 @@
-#version 330 core
-layout ( location = 0 ) in vec3 position;
-layout ( location = 1 ) in vec2 uv;
-layout ( location = 2 ) in vec3 normal;
-
-out vec2 UV;
-out vec3 Normal;
-out vec3 FragPos;
-
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
-
-void main()
-{
-   gl_Position = projection * view * model * vec4( position, 1.0f );
-   UV = uv;
-   Normal = mat3( transpose( inverse( model ) ) ) * normal;
-   FragPos = vec3( model * vec4( position, 1.0f ) );
-}
+#version 330 core
+layout ( location = 0 ) in vec3 position;
+layout ( location = 1 ) in vec2 uv;
+layout ( location = 2 ) in vec3 normal;
+
+out vec2 UV;
+out vec3 Normal;
+out vec3 FragPos;
+
+// Dane klatki (jeden bufor uniformów), ten sam układ co w Shader.frag
+struct Directional_Light{
+   vec4 Position;
+   vec4 Ambient;
+   vec4 Diffuse;
+   vec4 Specular;
+};
+
+#define Max_Directional_Light 2
+
+layout ( std140 ) uniform FrameData{
+   mat4 view;
+   mat4 projection;
+   mat4 viewProjection;
+   vec4 ViewPos;
+   Directional_Light DirectionalLight[Max_Directional_Light];
+};
+
+#ifdef INDIRECT
+// Numer obiektu: z bufora (dzielnik 1, BaseInstance) lub stała wartość atrybutu
+layout ( location = 3 ) in uint drawID;
+// Dane obiektów: 13 texeli na obiekt (4 kolumny macierzy model-widok-projekcja, 4 kolumny macierzy modelu,
+// 3 kolumny macierzy normalnych, skala i przesunięcie pozycji)
+uniform samplerBuffer ObjectData;
+#else
+uniform mat4 model;
+// Liczone na CPU raz na obiekt: projection * view * model oraz transpose( inverse( mat3( model ) ) )
+uniform mat4 modelViewProjection;
+uniform mat3 normalMatrix;
+// Macierz modelu i normalnych instancji (dzielnik 1), bez instancji stała wartość = macierz jednostkowa
+layout ( location = 4 ) in mat4 instanceMatrix;
+layout ( location = 8 ) in mat3 instanceNormalMatrix;
+// Kwantyzowana pozycja: position * PositionScale + PositionOffset (dla float: 1 i 0)
+uniform vec3 PositionScale;
+uniform vec3 PositionOffset;
+#endif
+
+void main()
+{
+#ifdef INDIRECT
+   int object = int( drawID ) * 13;
+   mat4 worldViewProjection = mat4( texelFetch( ObjectData, object ), texelFetch( ObjectData, object + 1 ),
+                                    texelFetch( ObjectData, object + 2 ), texelFetch( ObjectData, object + 3 ) );
+   mat4 world = mat4( texelFetch( ObjectData, object + 4 ), texelFetch( ObjectData, object + 5 ),
+                      texelFetch( ObjectData, object + 6 ), texelFetch( ObjectData, object + 7 ) );
+   mat3 worldNormal = mat3( texelFetch( ObjectData, object + 8 ).xyz, texelFetch( ObjectData, object + 9 ).xyz,
+                            texelFetch( ObjectData, object + 10 ).xyz );
+   vec3 PositionScale = texelFetch( ObjectData, object + 11 ).xyz;
+   vec3 PositionOffset = texelFetch( ObjectData, object + 12 ).xyz;
+   vec4 objectPosition = vec4( position * PositionScale + PositionOffset, 1.0f );
+   gl_Position = worldViewProjection * objectPosition;
+   Normal = worldNormal * normal;
+   FragPos = vec3( world * objectPosition );
+#else
+   // Tylko iloczyny macierz * wektor (bez iloczynów macierzy dla każdego wierzchołka)
+   vec4 instancePosition = instanceMatrix * vec4( position * PositionScale + PositionOffset, 1.0f );
+   gl_Position = modelViewProjection * instancePosition;
+   Normal = normalMatrix * ( instanceNormalMatrix * normal );
+   FragPos = vec3( model * instancePosition );
+#endif
+   UV = uv;
+}
@@ -0,0 +1,333 @@
+/*!
+   \file benchmark.cpp
+   \brief Plik odpowiedzialny za pomiar czasu klatek (tryb benchmark).
+*/
+#ifndef __benchmark_hpp__
+#define __benchmark_hpp__
+
+/*!
+   \brief Klasa odpowiedzialna za tryb benchmark: ustaloną ścieżkę kamery, pomiar czasu klatek oraz zapis wyników.
+
+   Kamera okrąża środek sceny (jeden pełny obrót na wszystkie mierzone klatki), dzięki czemu każde uruchomienie rysuje te same klatki.
+*/
+class Benchmark{
+   public:
+      /*!
+         \brief Konstruktor domyślny.
+      */
+      Benchmark();
+      /*!
+         \brief Rozpoczyna benchmark.
+
+         \param frames - ilość mierzonych klatek (bez klatek rozgrzewkowych \link Warmup \endlink)
+      */
+      void Start( int frames );
+      /*!
+         \brief Zwraca TRUE, gdy benchmark jest w trakcie działania.
+      */
+      bool IsRunning() const;
+      /*!
+         \brief Zwraca TRUE, gdy wszystkie klatki zostały zmierzone.
+      */
+      bool IsFinished() const;
+      /*!
+         \brief Ustawia kamerę w pozycji dla aktualnej klatki.
+
+         \param camera - kamera, która zostanie ustawiona
+      */
+      void MoveCamera( Camera &camera );
+      /*!
+         \brief Dodaje wyniki jednej klatki.
+
+         \param update_time - czas CPU rysowania klatki (bez wyświetlenia), w milisekundach
+         \param frame_time - całkowity czas klatki, w milisekundach
+         \param stats - liczniki klatki
+      */
+      void AddFrame( double update_time, double frame_time, const FrameStats &stats );
+      /*!
+         \brief Ustala numer klatki \link GpuProfiler \endlink aktualnej klatki (wywoływane co klatkę, przed \link AddFrame() \endlink ).
+
+         Zapamiętywany jest numer pierwszej mierzonej klatki, czasy GPU klatek rozgrzewkowych są pomijane.
+
+         \param frame - numer klatki ( \link GpuProfiler::ReturnFrame() \endlink )
+      */
+      void SetGpuFrame( unsigned long frame );
+      /*!
+         \brief Dodaje czasy GPU jednej klatki (odczytane z opóźnieniem przez \link GpuProfiler \endlink), tylko dla mierzonych klatek.
+
+         \param sections - zmierzone fragmenty klatki
+         \param frame - numer klatki ( \link GpuProfiler::ReturnCompletedFrames() \endlink )
+      */
+      void AddGpuFrame( const vector <GpuSection> &sections, unsigned long frame );
+      /*!
+         \brief Zapisuje wyniki do pliku JSON.
+
+         \param file - ścieżka do pliku wyjściowego
+         \param width - szerokość obrazu
+         \param height - wysokość obrazu
+         \param headless - TRUE = tryb headless
+         \return - wartość logiczną dla zapisu pliku, FALSE = błąd
+      */
+      bool Save( string file, int width, int height, bool headless );
+   private:
+      /*!
+         \brief Zapisuje podsumowanie (średnia, p50, p95, p99, max) wektora wartości w formacie JSON.
+
+         \param output - strumień wyjściowy
+         \param values - wektor wartości
+      */
+      void SaveSummary( ostream &output, vector <double> values );
+      /*!
+         \brief Ilość mierzonych klatek.
+      */
+      int Frames = 0;
+      /*!
+         \brief Ilość klatek rozgrzewkowych (nie są mierzone), domyślnie 5.
+      */
+      int Warmup = 5;
+      /*!
+         \brief Numer aktualnej klatki (razem z klatkami rozgrzewkowymi).
+      */
+      int Frame = 0;
+      /*!
+         \brief Promień okręgu, po którym porusza się kamera.
+      */
+      GLfloat Radius = 10.0f;
+      /*!
+         \brief Wysokość, na której porusza się kamera.
+      */
+      GLfloat Height = 3.0f;
+      /*!
+         \brief Czas CPU rysowania każdej klatki, w milisekundach.
+      */
+      vector <double> UpdateTimes;
+      /*!
+         \brief Całkowity czas każdej klatki, w milisekundach.
+      */
+      vector <double> FrameTimes;
+      /*!
+         \brief Liczniki każdej klatki.
+      */
+      vector <FrameStats> Stats;
+      /*!
+         \brief Czas GPU każdej klatki, w milisekundach.
+      */
+      vector <double> GpuFrameTimes;
+      /*!
+         \brief Czas GPU każdego rodzaju fragmentu (suma w klatce), w milisekundach.
+      */
+      map < string, vector <double> > GpuSectionTimes;
+      /*!
+         \brief Czas GPU rysowania każdego obiektu, w milisekundach.
+      */
+      map < string, vector <double> > GpuItemTimes;
+      /*!
+         \brief Numer klatki \link GpuProfiler \endlink pierwszej mierzonej klatki, 0 = jeszcze nieznany.
+      */
+      unsigned long GpuFirstFrame = 0;
+};
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+Benchmark::Benchmark(){
+}
+
+void Benchmark::Start( int frames ){
+   this->Frames = frames;
+   this->Frame = 0;
+   this->UpdateTimes.clear();
+   this->FrameTimes.clear();
+   this->Stats.clear();
+   this->GpuFrameTimes.clear();
+   this->GpuSectionTimes.clear();
+   this->GpuItemTimes.clear();
+   this->GpuFirstFrame = 0;
+   this->UpdateTimes.reserve( frames );
+   this->FrameTimes.reserve( frames );
+   this->Stats.reserve( frames );
+}
+
+bool Benchmark::IsRunning() const{
+   return this->Frames > 0 and ! this->IsFinished();
+}
+
+bool Benchmark::IsFinished() const{
+   return this->Frames > 0 and (int)this->FrameTimes.size() >= this->Frames;
+}
+
+void Benchmark::MoveCamera( Camera &camera ){
+   /*
+      Klatki rozgrzewkowe rysowane są z pozycji pierwszej klatki.
+   */
+   int Measured = this->Frame - this->Warmup;
+   if( Measured < 0 ){
+      Measured = 0;
+   }
+   GLfloat Angle = 2.0f * 3.14159265f * Measured / this->Frames;
+   vec3 Position = vec3( this->Radius * cos( Angle ), this->Height, this->Radius * sin( Angle ) );
+   camera.SetPosition( Position );
+   camera.SetViewDirection( normalize( -Position ) );
+}
+
+void Benchmark::AddFrame( double update_time, double frame_time, const FrameStats &stats ){
+   ++this->Frame;
+   if( this->Frame <= this->Warmup or this->IsFinished() ){
+      return;
+   }
+   this->UpdateTimes.push_back( update_time );
+   this->FrameTimes.push_back( frame_time );
+   this->Stats.push_back( stats );
+}
+
+void Benchmark::SetGpuFrame( unsigned long frame ){
+   if( this->Frame == this->Warmup ){
+      this->GpuFirstFrame = frame;
+   }
+}
+
+void Benchmark::AddGpuFrame( const vector <GpuSection> &sections, unsigned long frame ){
+   /*
+      Klatki rozgrzewkowe (odczytane już po rozgrzewce) i klatki po zakończeniu pomiaru są pomijane.
+   */
+   if( sections.empty() or this->GpuFirstFrame == 0 or frame < this->GpuFirstFrame or frame >= this->GpuFirstFrame + this->Frames ){
+      return;
+   }
+   double Total = 0.0;
+   map <string, double> Sections;
+   map <string, double> Items;
+   for( unsigned int i = 0; i < sections.size(); ++i ){
+      double Time = sections[i].Duration / 1000000.0;
+      Total += Time;
+      Sections[ sections[i].Name ] += Time;
+      if( ! sections[i].Detail.empty() ){
+         Items[ sections[i].Detail ] += Time;
+      }
+   }
+   this->GpuFrameTimes.push_back( Total );
+   for( map <string, double>::iterator It = Sections.begin(); It != Sections.end(); ++It ){
+      this->GpuSectionTimes[ It->first ].push_back( It->second );
+   }
+   for( map <string, double>::iterator It = Items.begin(); It != Items.end(); ++It ){
+      this->GpuItemTimes[ It->first ].push_back( It->second );
+   }
+}
+
+bool Benchmark::Save( string file, int width, int height, bool headless ){
+   fstream output;
+   output.open( file.c_str(), ios::out );
+   if( ! output.good() ){
+      cout<<"File error: "<<file<<"\n";
+      return false;
+   }
+   output<<fixed<<setprecision( 4 );
+   output<<"{\n";
+   output<<"   \"frames\": "<<this->FrameTimes.size()<<",\n";
+   output<<"   \"width\": "<<width<<",\n";
+   output<<"   \"height\": "<<height<<",\n";
+   output<<"   \"headless\": "<<( headless ? "true" : "false" )<<",\n";
+   output<<"   \"update_ms\": ";
+   this->SaveSummary( output, this->UpdateTimes );
+   output<<",\n";
+   output<<"   \"frame_ms\": ";
+   this->SaveSummary( output, this->FrameTimes );
+   output<<",\n";
+   /*
+      Czasy GPU (tylko gdy były mierzone).
+   */
+   if( ! this->GpuFrameTimes.empty() ){
+      output<<"   \"gpu_ms\": {\n";
+      output<<"      \"frames\": "<<this->GpuFrameTimes.size()<<",\n";
+      /*
+         Mierzone klatki bez czasów GPU (wyniki nie były gotowe).
+      */
+      output<<"      \"dropped\": "<<this->FrameTimes.size() - this->GpuFrameTimes.size()<<",\n";
+      output<<"      \"frame\": ";
+      this->SaveSummary( output, this->GpuFrameTimes );
+      output<<",\n";
+      output<<"      \"sections\": {\n";
+      for( map < string, vector <double> >::iterator It = this->GpuSectionTimes.begin(); It != this->GpuSectionTimes.end(); ++It ){
+         output<<"         ";
+         Profiler::SaveString( output, It->first );
+         output<<": ";
+         this->SaveSummary( output, It->second );
+         output<<( It != --this->GpuSectionTimes.end() ? ",\n" : "\n" );
+      }
+      output<<"      },\n";
+      output<<"      \"items\": {\n";
+      for( map < string, vector <double> >::iterator It = this->GpuItemTimes.begin(); It != this->GpuItemTimes.end(); ++It ){
+         output<<"         ";
+         Profiler::SaveString( output, It->first );
+         output<<": ";
+         this->SaveSummary( output, It->second );
+         output<<( It != --this->GpuItemTimes.end() ? ",\n" : "\n" );
+      }
+      output<<"      }\n";
+      output<<"   },\n";
+   }
+   /*
+      Podsumowanie wszystkich liczników.
+   */
+   output<<"   \"counters\": {\n";
+   for( int i = 0; i < COUNTER_COUNT; ++i ){
+      vector <double> Values;
+      Values.reserve( this->Stats.size() );
+      for( unsigned int j = 0; j < this->Stats.size(); ++j ){
+         Values.push_back( this->Stats[j].Return( (Counter)i ) );
+      }
+      output<<"      \""<<FrameStats::ReturnName( (Counter)i )<<"\": ";
+      this->SaveSummary( output, Values );
+      output<<( i + 1 < COUNTER_COUNT ? ",\n" : "\n" );
+   }
+   output<<"   },\n";
+   /*
+      Wyniki każdej klatki.
+   */
+   output<<"   \"per_frame\": [\n";
+   for( unsigned int i = 0; i < this->FrameTimes.size(); ++i ){
+      output<<"      { \"update_ms\": "<<this->UpdateTimes[i]<<", \"frame_ms\": "<<this->FrameTimes[i];
+      for( int j = 0; j < COUNTER_COUNT; ++j ){
+         output<<", \""<<FrameStats::ReturnName( (Counter)j )<<"\": "<<this->Stats[i].Return( (Counter)j );
+      }
+      output<<( i + 1 < this->FrameTimes.size() ? " },\n" : " }\n" );
+   }
+   output<<"   ]\n";
+   output<<"}\n";
+   output.close();
+   cout<<"Benchmark: "<<file<<"\n";
+   return true;
+}
+
+void Benchmark::SaveSummary( ostream &output, vector <double> values ){
+   if( values.empty() ){
+      output<<"{ \"mean\": 0, \"p50\": 0, \"p95\": 0, \"p99\": 0, \"max\": 0 }";
+      return;
+   }
+   sort( values.begin(), values.end() );
+   double Sum = 0.0;
+   for( unsigned int i = 0; i < values.size(); ++i ){
+      Sum += values[i];
+   }
+   /*
+      Percentyl metodą najbliższej pozycji (nearest-rank).
+   */
+   double Percentiles[3] = { 50.0, 95.0, 99.0 };
+   double Results[3];
+   for( int i = 0; i < 3; ++i ){
+      int Index = (int)ceil( Percentiles[i] / 100.0 * values.size() ) - 1;
+      if( Index < 0 ){
+         Index = 0;
+      }
+      Results[i] = values[ Index ];
+   }
+   output<<"{ \"mean\": "<<Sum / values.size()
+         <<", \"p50\": "<<Results[0]
+         <<", \"p95\": "<<Results[1]
+         <<", \"p99\": "<<Results[2]
+         <<", \"max\": "<<values.back()<<" }";
+}
+
+#endif
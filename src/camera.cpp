@@ -5,8 +5,27 @@
 #ifndef __camera_hpp__
 #define __camera_hpp__
 
+/*!
+   \brief Płaszczyzny ostrosłupa widzenia kamery (kolejność w \link Camera::ReturnFrustumPlanes() \endlink ).
+*/
+enum FrustumPlane{
+   FRUSTUM_LEFT = 0,
+   FRUSTUM_RIGHT,
+   FRUSTUM_BOTTOM,
+   FRUSTUM_TOP,
+   FRUSTUM_NEAR,
+   FRUSTUM_FAR,
+   /*!
+      \brief Ilość płaszczyzn, zawsze ostatnia.
+   */
+   FRUSTUM_PLANES
+};
+
 /*!
    \brief Klasa odpowiedzialna za zarządzaniem kamerą gracza.
+
+   Macierze i płaszczyzny ostrosłupa widzenia liczone są tylko po zmianie kamery (flagi \link ViewDirty \endlink i \link ProjectionDirty \endlink ),
+   każda zmiana zwiększa \link Version \endlink (np. dla wyników odrzucania obiektów zapamiętanych dla kamery).
 */
 class Camera{
    public:
@@ -27,23 +46,55 @@ class Camera{
       */
       Camera & operator=( const Camera &camera );
       /*!
-         \brief Zwraca macierz projekcji.
+         \brief Zwraca macierz projekcji (przeliczaną tylko po zmianie parametrów).
+      */
+      const mat4 & ReturnProjectionMatrix();
+      /*!
+         \brief Zwraca macierz widoku (przeliczaną tylko po zmianie pozycji lub kierunku).
+      */
+      const mat4 & ReturnViewMatrix();
+      /*!
+         \brief Zwraca iloczyn macierzy projekcji i widoku.
       */
-      mat4 ReturnProjectionMatrix();
+      const mat4 & ReturnViewProjectionMatrix();
       /*!
-         \brief Zwraca macierz widoku.
+         \brief Zwraca \link FRUSTUM_PLANES \endlink płaszczyzn ostrosłupa widzenia w świecie (kolejność \link FrustumPlane \endlink ).
+
+         Płaszczyzna (xyz - znormalizowany wektor normalny skierowany do wnętrza, w - odległość): punkt p jest po wewnętrznej stronie, gdy dot( xyz, p ) + w >= 0.
       */
-      mat4 ReturnViewMatrix();
+      const vec4 * ReturnFrustumPlanes();
+      /*!
+         \brief Zwraca numer wersji kamery ( \link Version \endlink ), zmieniany przy każdej zmianie kamery.
+      */
+      unsigned long ReturnVersion() const;
       /*!
          \brief Zwraca aktualną pozycję kamery.
       */
       vec3 ReturnPosition() const;
       /*!
-         \brief Aktualizuje macierz projekcji.
+         \brief Ustala nową pozycję kamery ( \link Position \endlink ).
+
+         \param vector_position - nowa wartość dla pozycji kamery
+      */
+      void SetPosition( vec3 vector_position );
+      /*!
+         \brief Ustala nowy kierunek patrzenia kamery ( \link ViewDirection \endlink ).
+
+         \param vector_direction - nowa wartość dla kierunku patrzenia kamery (wektor jednostkowy)
+      */
+      void SetViewDirection( vec3 vector_direction );
+      /*!
+         \brief Ustala nowy współczynnik szerokości do wysokości ( \link Aspect \endlink ).
+
+         \param aspect - szerokość / wysokość
+      */
+      void SetAspect( GLfloat aspect );
+      /*!
+         \brief Aktualizuje macierz projekcji, gdy \link ProjectionDirty \endlink.
       */
       inline void UpdateProjectionMatrix();
       /*!
-         \brief Aktualizuje macierz widoku.
+         \brief Aktualizuje macierz widoku, gdy \link ViewDirty \endlink.
       */
       inline void UpdateViewMatrix();
       /*!
@@ -91,6 +142,14 @@ class Camera{
       */
       void MoveRight();
    private:
+      /*!
+         \brief Przelicza nieaktualne macierze, \link ViewProjectionMatrix \endlink i \link FrustumPlanes \endlink.
+      */
+      void Update();
+      /*!
+         \brief Oznacza zmianę macierzy widoku.
+      */
+      void ChangeView();
       /*!
          \brief Pozycja kamery.
       */
@@ -119,6 +178,30 @@ class Camera{
          \brief Macierz widoku.
       */
       mat4 ViewMatrix = mat4( 1.0f );
+      /*!
+         \brief Iloczyn macierzy projekcji i widoku.
+      */
+      mat4 ViewProjectionMatrix = mat4( 1.0f );
+      /*!
+         \brief Płaszczyzny ostrosłupa widzenia w świecie.
+      */
+      vec4 FrustumPlanes[ FRUSTUM_PLANES ];
+      /*!
+         \brief TRUE = \link ViewMatrix \endlink wymaga przeliczenia.
+      */
+      bool ViewDirty = true;
+      /*!
+         \brief TRUE = \link ProjectionMatrix \endlink wymaga przeliczenia.
+      */
+      bool ProjectionDirty = true;
+      /*!
+         \brief TRUE = \link ViewProjectionMatrix \endlink i \link FrustumPlanes \endlink wymagają przeliczenia.
+      */
+      bool FrustumDirty = true;
+      /*!
+         \brief Numer wersji kamery, zwiększany przy każdej zmianie.
+      */
+      unsigned long Version = 0;
       /*!
          \brief Kąt widzenia dla kamery, wyrażony w stopniach.
       */
@@ -157,14 +240,7 @@ class Camera{
 */
 
 Camera::Camera(){
-   /*
-      Otrzymanie macierzy projekcji
-   */
-   this->ProjectionMatrix = perspective( radians( this->VOF.x ), this->Aspect.x, this->Near.x, this->Far.x );
-   /*
-      Otrzymanie macierzy widoku
-   */
-   this->ViewMatrix = lookAt( this->Position, this->Position + this->ViewDirection, this->Up );
+   this->Update();
 }
 
 Camera::~Camera(){
@@ -182,6 +258,14 @@ Camera::Camera( const Camera &camera ){
    this->Aspect = camera.Aspect;
    this->Near = camera.Near;
    this->Far = camera.Far;
+   this->ViewProjectionMatrix = camera.ViewProjectionMatrix;
+   for( int i = 0; i < FRUSTUM_PLANES; ++i ){
+      this->FrustumPlanes[i] = camera.FrustumPlanes[i];
+   }
+   this->ViewDirty = camera.ViewDirty;
+   this->ProjectionDirty = camera.ProjectionDirty;
+   this->FrustumDirty = camera.FrustumDirty;
+   this->Version = camera.Version;
 }
 
 Camera & Camera::operator=( const Camera &camera ){
@@ -196,59 +280,158 @@ Camera & Camera::operator=( const Camera &camera ){
    this->Aspect = camera.Aspect;
    this->Near = camera.Near;
    this->Far = camera.Far;
+   this->ViewProjectionMatrix = camera.ViewProjectionMatrix;
+   for( int i = 0; i < FRUSTUM_PLANES; ++i ){
+      this->FrustumPlanes[i] = camera.FrustumPlanes[i];
+   }
+   this->ViewDirty = camera.ViewDirty;
+   this->ProjectionDirty = camera.ProjectionDirty;
+   this->FrustumDirty = camera.FrustumDirty;
+   this->Version = camera.Version;
    return *this;
 }
 
-mat4 Camera::ReturnProjectionMatrix(){
-   /*
-      Otrzymanie macierzy projekcji
-   */
-   this->ProjectionMatrix = perspective( radians( this->VOF.x ), this->Aspect.x, this->Near.x, this->Far.x );
+const mat4 & Camera::ReturnProjectionMatrix(){
+   this->UpdateProjectionMatrix();
    return this->ProjectionMatrix;
 }
 
-mat4 Camera::ReturnViewMatrix(){
-   /*
-      Otrzymanie macierzy widoku
-   */
-   this->ViewMatrix = lookAt( this->Position, this->Position + this->ViewDirection, this->Up );
+const mat4 & Camera::ReturnViewMatrix(){
+   this->UpdateViewMatrix();
    return this->ViewMatrix;
 }
 
+const mat4 & Camera::ReturnViewProjectionMatrix(){
+   this->Update();
+   return this->ViewProjectionMatrix;
+}
+
+const vec4 * Camera::ReturnFrustumPlanes(){
+   this->Update();
+   return this->FrustumPlanes;
+}
+
+unsigned long Camera::ReturnVersion() const{
+   return this->Version;
+}
+
 vec3 Camera::ReturnPosition() const{
    return this->Position;
 }
 
+void Camera::SetPosition( vec3 vector_position ){
+   this->Position = vector_position;
+   this->ChangeView();
+}
+
+void Camera::SetViewDirection( vec3 vector_direction ){
+   this->ViewDirection = vector_direction;
+   this->ChangeView();
+}
+
+void Camera::SetAspect( GLfloat aspect ){
+   if( this->Aspect.x == aspect ){
+      return;
+   }
+   this->Aspect = vec1( aspect );
+   this->ProjectionDirty = true;
+   this->FrustumDirty = true;
+   ++this->Version;
+}
+
+void Camera::UpdateProjectionMatrix(){
+   if( this->ProjectionDirty ){
+      /*
+         Otrzymanie macierzy projekcji
+      */
+      this->ProjectionMatrix = perspective( radians( this->VOF.x ), this->Aspect.x, this->Near.x, this->Far.x );
+      this->ProjectionDirty = false;
+   }
+}
+
+void Camera::UpdateViewMatrix(){
+   if( this->ViewDirty ){
+      /*
+         Otrzymanie macierzy widoku
+      */
+      this->ViewMatrix = lookAt( this->Position, this->Position + this->ViewDirection, this->Up );
+      this->ViewDirty = false;
+   }
+}
+
 void Camera::MouseUpdate( const vec2 &Mouse ){
+   if( Mouse.x == 0.0f and Mouse.y == 0.0f ){
+      return;
+   }
    this->RotationAround = cross( this->ViewDirection, this->Up );
    this->Rotation = rotate( Mouse.x * this->RotationSpeed.x, this->Up ) * rotate( Mouse.y * this->RotationSpeed.x, this->RotationAround );
    this->ViewDirection = mat3( this->Rotation ) * this->ViewDirection;
+   this->ChangeView();
 }
 
 void Camera::MoveUp(){
    this->Position += this->MovementSpeed.x * this->Up;
+   this->ChangeView();
 }
 
 void Camera::MoveDown(){
    this->Position -= this->MovementSpeed.x * this->Up;
+   this->ChangeView();
 }
 
 void Camera::MoveForward(){
    this->Position += this->MovementSpeed.x * this->ViewDirection;
+   this->ChangeView();
 }
 
 void Camera::MoveBackward(){
    this->Position -= this->MovementSpeed.x * this->ViewDirection;
+   this->ChangeView();
 }
 
 void Camera::MoveLeft(){
    this->MovementDirection = cross( this->ViewDirection, this->Up );
    this->Position -= this->MovementSpeed.x * this->MovementDirection;
+   this->ChangeView();
 }
 
 void Camera::MoveRight(){
    this->MovementDirection = cross( this->ViewDirection, this->Up );
    this->Position += this->MovementSpeed.x * this->MovementDirection;
+   this->ChangeView();
+}
+
+void Camera::Update(){
+   if( ! this->FrustumDirty ){
+      return;
+   }
+   this->UpdateProjectionMatrix();
+   this->UpdateViewMatrix();
+   this->ViewProjectionMatrix = this->ProjectionMatrix * this->ViewMatrix;
+   /*
+      Płaszczyzny z wierszy macierzy (Gribb, Hartmann): wiersz 3 +/- wiersz 0, 1, 2.
+   */
+   const mat4 &M = this->ViewProjectionMatrix;
+   vec4 Row[4];
+   for( int i = 0; i < 4; ++i ){
+      Row[i] = vec4( M[0][i], M[1][i], M[2][i], M[3][i] );
+   }
+   this->FrustumPlanes[ FRUSTUM_LEFT ] = Row[3] + Row[0];
+   this->FrustumPlanes[ FRUSTUM_RIGHT ] = Row[3] - Row[0];
+   this->FrustumPlanes[ FRUSTUM_BOTTOM ] = Row[3] + Row[1];
+   this->FrustumPlanes[ FRUSTUM_TOP ] = Row[3] - Row[1];
+   this->FrustumPlanes[ FRUSTUM_NEAR ] = Row[3] + Row[2];
+   this->FrustumPlanes[ FRUSTUM_FAR ] = Row[3] - Row[2];
+   for( int i = 0; i < FRUSTUM_PLANES; ++i ){
+      this->FrustumPlanes[i] /= length( vec3( this->FrustumPlanes[i] ) );
+   }
+   this->FrustumDirty = false;
+}
+
+void Camera::ChangeView(){
+   this->ViewDirty = true;
+   this->FrustumDirty = true;
+   ++this->Version;
 }
 
 #endif
@@ -0,0 +1,336 @@
+/*!
+   \file cluster_culler.cpp
+   \brief Plik odpowiedzialny za odrzucanie grup trójkątów (meshletów) obiektów poza ostrosłupem widzenia i zwróconych tyłem do kamery.
+*/
+#ifndef __cluster_culler_hpp__
+#define __cluster_culler_hpp__
+
+/*!
+   \brief Ilość grup sprawdzanych przez jedno zadanie puli wątków.
+*/
+#define CLUSTER_CULLER_TASK_CLUSTERS 1024
+/*!
+   \brief Najmniejsza ilość grup w klatce, od której test dzielony jest na zadania puli wątków (mniej grup = test w wątku głównym).
+*/
+#define CLUSTER_CULLER_PARALLEL_CLUSTERS 4096
+
+/*!
+   \brief Zakresy indeksów widocznych grup jednej części (argumenty glMultiDrawElementsBaseVertex).
+*/
+struct ClusterRanges{
+   /*!
+      \brief Ilość indeksów każdego zakresu.
+   */
+   vector <GLsizei> Counts;
+   /*!
+      \brief Położenie (w bajtach) każdego zakresu w buforze indeksów.
+   */
+   vector <const GLvoid *> Offsets;
+   /*!
+      \brief Wierzchołek bazowy każdego zakresu (taki sam dla całej części).
+   */
+   vector <GLint> BaseVertices;
+   /*!
+      \brief Pierwszy indeks każdego zakresu względem początku obiektu (jak \link MeshPart::FirstIndex \endlink ).
+   */
+   vector <GLuint> FirstIndices;
+   /*!
+      \brief Ilość trójkątów wszystkich zakresów.
+   */
+   GLuint Triangles;
+};
+
+/*!
+   \brief Dane obiektu dla testu grup w jednej klatce.
+*/
+struct ClusterItem{
+   /*!
+      \brief TRUE = obiekt rysowany zakresami widocznych grup (\link Parts \endlink ), FALSE = całymi częściami.
+   */
+   bool Active;
+   /*!
+      \brief Płaszczyzny ostrosłupa widzenia we współrzędnych obiektu (odległość w świecie).
+   */
+   vec4 Planes[ FRUSTUM_PLANES ];
+   /*!
+      \brief Skala promienia sfery (promień w świecie / promień we współrzędnych obiektu).
+   */
+   GLfloat Scale;
+   /*!
+      \brief Pozycja kamery we współrzędnych obiektu.
+   */
+   vec3 CameraPosition;
+   /*!
+      \brief TRUE = test stożka normalnych (macierz modelu zachowuje kąty i orientację trójkątów).
+   */
+   bool Cone;
+   /*!
+      \brief Widoczność każdej grupy obiektu, 1 = widoczna.
+   */
+   vector <uint8_t> Visible;
+   /*!
+      \brief Zakresy widocznych grup każdej części poziomu 0.
+   */
+   vector <ClusterRanges> Parts;
+};
+
+/*!
+   \brief Klasa odpowiedzialna za test grup trójkątów ( \link MeshCluster \endlink ) widocznych obiektów z jedną instancją.
+
+   Grupa jest odrzucana, gdy jej sfera otaczająca leży poza ostrosłupem widzenia albo gdy wszystkie jej trójkąty są zwrócone tyłem do kamery
+   (test stożka normalnych: dot( środek - kamera, oś ) >= sin( rozwarcie ) * | środek - kamera | + promień).
+   Test liczony jest we współrzędnych obiektu (płaszczyzny przekształcone transpozycją macierzy modelu), przy wielu grupach w puli wątków.
+   Sąsiednie widoczne grupy łączone są w jeden zakres, każda część rysowana jest jednym glMultiDrawElementsBaseVertex.
+   Obiekty z instancjami i z uproszczonym poziomem szczegółowości rysowane są całymi częściami.
+*/
+class ClusterCuller{
+   public:
+      /*!
+         \brief Konstruktor domyślny.
+      */
+      ClusterCuller();
+      /*!
+         \brief Uruchamia wątki testu grup.
+
+         \param threads - ilość wątków, 0 = ilość rdzeni procesora
+      */
+      void Start( int threads );
+      /*!
+         \brief Czeka na zakończenie wszystkich zadań testu grup.
+      */
+      void Wait();
+      /*!
+         \brief Ustala, czy grupy są odrzucane. FALSE = obiekty rysowane całymi częściami.
+
+         \param enabled - TRUE = odrzucanie włączone
+      */
+      void SetEnabled( bool enabled );
+      /*!
+         \brief Sprawdza grupy widocznych obiektów (po \link FrustumCuller::Cull() \endlink i \link LodSelector::Select() \endlink ).
+
+         \param items - obiekty
+         \param camera - kamera (płaszczyzny ostrosłupa widzenia i pozycja)
+         \param culler - widoczność instancji
+         \param lods - poziomy szczegółowości instancji
+         \param stats - liczniki klatki (sprawdzone i odrzucone grupy)
+      */
+      void Cull( const vector <Mesh> &items, Camera &camera, const FrustumCuller &culler, const LodSelector &lods, FrameStats &stats );
+      /*!
+         \brief Zwraca TRUE, gdy obiekt rysowany jest zakresami widocznych grup (po \link Cull() \endlink ).
+
+         \param item - numer obiektu
+      */
+      bool IsActive( GLuint item ) const;
+      /*!
+         \brief Zwraca zakresy widocznych grup części poziomu 0 (tylko dla \link IsActive() \endlink ).
+
+         \param item - numer obiektu
+         \param part - numer części
+      */
+      const ClusterRanges & ReturnRanges( GLuint item, GLuint part ) const;
+      /*!
+         \brief Rysuje zakresy widocznych grup części jednym wywołaniem (VAO wspólnych buforów musi być dowiązane).
+
+         \param item - obiekt
+         \param ranges - zakresy części ( \link ReturnRanges() \endlink )
+      */
+      static void Draw( const Mesh &item, const ClusterRanges &ranges );
+   private:
+      /*!
+         \brief Test grup [ begin, end ) obiektu, wynik w \link ClusterItem::Visible \endlink.
+
+         \param item - obiekt
+         \param data - dane obiektu w klatce
+         \param begin - pierwsza grupa
+         \param end - za ostatnią grupą
+      */
+      static void Test( const Mesh &item, ClusterItem &data, GLuint begin, GLuint end );
+      /*!
+         \brief Łączy sąsiednie widoczne grupy obiektu w zakresy części.
+
+         \param item - obiekt
+         \param data - dane obiektu w klatce
+      */
+      static void BuildRanges( const Mesh &item, ClusterItem &data );
+      /*!
+         \brief TRUE = odrzucanie włączone.
+      */
+      bool Enabled = true;
+      /*!
+         \brief Dane każdego obiektu.
+      */
+      vector <ClusterItem> Items;
+      /*!
+         \brief Wątki testu grup (osobne od wątków wczytujących obiekty).
+      */
+      ThreadPool pool;
+};
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+ClusterCuller::ClusterCuller(){
+}
+
+void ClusterCuller::Start( int threads ){
+   this->pool.Start( threads );
+}
+
+void ClusterCuller::Wait(){
+   this->pool.Wait();
+}
+
+void ClusterCuller::SetEnabled( bool enabled ){
+   this->Enabled = enabled;
+}
+
+void ClusterCuller::Cull( const vector <Mesh> &items, Camera &camera, const FrustumCuller &culler, const LodSelector &lods, FrameStats &stats ){
+   PROFILE_SCOPE( "ClusterCuller::Cull" );
+   if( this->Items.size() < items.size() ){
+      this->Items.resize( items.size() );
+   }
+   const vec4 *Planes = camera.ReturnFrustumPlanes();
+   vec3 Position = camera.ReturnPosition();
+   unsigned long Clusters = 0;
+   for( unsigned int i = 0; i < items.size(); ++i ){
+      const Mesh &Item = items[i];
+      ClusterItem &Data = this->Items[i];
+      Data.Active = this->Enabled and Item.IsLoaded() and Item.ReturnGeometry() != 0 and ! Item.ReturnClusters().empty()
+                    and Item.ReturnInstanceCount() == 1 and culler.IsVisible( i, 0 ) and lods.ReturnLevel( i, 0 ) == 0;
+      if( ! Data.Active ){
+         continue;
+      }
+      /*
+         Płaszczyzna we współrzędnych obiektu: dot( P, M * x ) = dot( transpose( M ) * P, x ), odległość pozostaje w jednostkach świata.
+      */
+      mat4 Model = Item.ReturnModelMatrix();
+      mat4 Transposed = transpose( Model );
+      for( int k = 0; k < FRUSTUM_PLANES; ++k ){
+         Data.Planes[k] = Transposed * Planes[k];
+      }
+      GLfloat Radius = Item.ReturnBounds().Radius;
+      Data.Scale = ( Radius > 0.0f ) ? Item.ReturnWorldBounds( 0 ).Radius / Radius : 1.0f;
+      Data.CameraPosition = vec3( inverse( Model ) * vec4( Position, 1.0f ) );
+      /*
+         Stożek normalnych tylko przy obrocie, przesunięciu i jednakowej skali (bez odbicia): kąty w obiekcie takie same jak w świecie.
+      */
+      vec3 X = vec3( Model[0] ), Y = vec3( Model[1] ), Z = vec3( Model[2] );
+      GLfloat Length = length( X ), Tolerance = 1e-3f * Length * Length;
+      Data.Cone = Length > 0.0f and fabs( dot( X, X ) - dot( Y, Y ) ) <= Tolerance and fabs( dot( X, X ) - dot( Z, Z ) ) <= Tolerance
+                  and fabs( dot( X, Y ) ) <= Tolerance and fabs( dot( X, Z ) ) <= Tolerance and fabs( dot( Y, Z ) ) <= Tolerance
+                  and dot( cross( X, Y ), Z ) > 0.0f;
+      Data.Visible.resize( Item.ReturnClusters().size() );
+      Clusters += Item.ReturnClusters().size();
+   }
+   /*
+      Zadania po CLUSTER_CULLER_TASK_CLUSTERS grup (duży obiekt dzielony jest na kilka zadań), każde zapisuje tylko widoczność swoich grup.
+   */
+   bool Parallel = this->pool.ReturnThreads() > 0 and Clusters >= CLUSTER_CULLER_PARALLEL_CLUSTERS;
+   for( unsigned int i = 0; i < items.size(); ++i ){
+      if( ! this->Items[i].Active ){
+         continue;
+      }
+      GLuint Count = items[i].ReturnClusters().size();
+      for( GLuint Begin = 0; Begin < Count; Begin += CLUSTER_CULLER_TASK_CLUSTERS ){
+         GLuint End = std::min( Begin + CLUSTER_CULLER_TASK_CLUSTERS, Count );
+         if( Parallel ){
+            const Mesh *Item = &items[i];
+            ClusterItem *Data = &this->Items[i];
+            this->pool.Add( [ Item, Data, Begin, End ](){ ClusterCuller::Test( *Item, *Data, Begin, End ); } );
+         }
+         else{
+            ClusterCuller::Test( items[i], this->Items[i], Begin, End );
+         }
+      }
+   }
+   if( Parallel ){
+      this->pool.Wait();
+   }
+   unsigned long Culled = 0;
+   for( unsigned int i = 0; i < items.size(); ++i ){
+      ClusterItem &Data = this->Items[i];
+      if( ! Data.Active ){
+         continue;
+      }
+      for( unsigned int k = 0; k < Data.Visible.size(); ++k ){
+         Culled += Data.Visible[k] == 0;
+      }
+      ClusterCuller::BuildRanges( items[i], Data );
+   }
+   stats.Add( COUNTER_CLUSTERS, Clusters );
+   stats.Add( COUNTER_CLUSTERS_CULLED, Culled );
+}
+
+void ClusterCuller::Test( const Mesh &item, ClusterItem &data, GLuint begin, GLuint end ){
+   const vector <MeshCluster> &Clusters = item.ReturnClusters();
+   for( GLuint i = begin; i < end; ++i ){
+      const MeshCluster &Cluster = Clusters[i];
+      GLfloat Radius = Cluster.Radius * data.Scale;
+      bool Visible = true;
+      for( int k = 0; k < FRUSTUM_PLANES and Visible; ++k ){
+         Visible = dot( data.Planes[k], vec4( Cluster.Center, 1.0f ) ) >= -Radius;
+      }
+      if( Visible and data.Cone and Cluster.ConeCutoff < 1.0f ){
+         vec3 Direction = Cluster.Center - data.CameraPosition;
+         Visible = dot( Direction, Cluster.ConeAxis ) < Cluster.ConeCutoff * length( Direction ) + Cluster.Radius;
+      }
+      data.Visible[i] = Visible;
+   }
+}
+
+void ClusterCuller::BuildRanges( const Mesh &item, ClusterItem &data ){
+   const vector <MeshCluster> &Clusters = item.ReturnClusters();
+   const vector <MeshPart> &Parts = item.ReturnParts();
+   GLuint PartCount = item.ReturnLods()[0].PartCount;
+   data.Parts.resize( PartCount );
+   for( GLuint i = 0; i < PartCount; ++i ){
+      ClusterRanges &Ranges = data.Parts[i];
+      Ranges.Counts.clear();
+      Ranges.Offsets.clear();
+      Ranges.BaseVertices.clear();
+      Ranges.FirstIndices.clear();
+      Ranges.Triangles = 0;
+   }
+   /*
+      Grupy części są kolejnymi zakresami indeksów, sąsiednie widoczne grupy tworzą jeden zakres.
+   */
+   GLintptr IndexOffset = GeometryArena::ReturnIndexOffset( item.ReturnGeometry() );
+   GLint BaseVertex = GeometryArena::ReturnBaseVertex( item.ReturnGeometry() );
+   GLsizeiptr IndexSize = ( item.ReturnIndexType() == GL_UNSIGNED_SHORT ) ? sizeof( uint16_t ) : sizeof( GLuint );
+   for( unsigned int i = 0; i < Clusters.size(); ++i ){
+      if( ! data.Visible[i] ){
+         continue;
+      }
+      const MeshCluster &Cluster = Clusters[i];
+      ClusterRanges &Ranges = data.Parts[ Cluster.Part ];
+      Ranges.Triangles += Cluster.IndexCount / 3;
+      if( ! Ranges.Counts.empty() and Ranges.FirstIndices.back() + Ranges.Counts.back() == Cluster.FirstIndex ){
+         Ranges.Counts.back() += Cluster.IndexCount;
+         continue;
+      }
+      Ranges.Counts.push_back( Cluster.IndexCount );
+      Ranges.Offsets.push_back( (const GLvoid *)( IndexOffset + Cluster.FirstIndex * IndexSize ) );
+      Ranges.BaseVertices.push_back( BaseVertex + Parts[ Cluster.Part ].BaseVertex );
+      Ranges.FirstIndices.push_back( Cluster.FirstIndex );
+   }
+}
+
+bool ClusterCuller::IsActive( GLuint item ) const{
+   return item < this->Items.size() and this->Items[ item ].Active;
+}
+
+const ClusterRanges & ClusterCuller::ReturnRanges( GLuint item, GLuint part ) const{
+   return this->Items[ item ].Parts[ part ];
+}
+
+void ClusterCuller::Draw( const Mesh &item, const ClusterRanges &ranges ){
+   if( ranges.Counts.empty() ){
+      return;
+   }
+   glMultiDrawElementsBaseVertex( GL_TRIANGLES, ranges.Counts.data(), item.ReturnIndexType(), (const GLvoid * const *)ranges.Offsets.data(), ranges.Counts.size(), (GLint *)ranges.BaseVertices.data() );
+}
+
+#endif
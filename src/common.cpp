@@ -10,9 +10,90 @@
 
    \param vertex - ścieżka do pliku z shaderem wierzchołków
    \param fragment - ścieżka do pliku z shaderem fragmentu
+   \param defines - dodatkowe linie (np. "#define INDIRECT\n") wstawiane za linią #version obu shaderów
    \return - identyfikator programu z dołączonymi shaderami
 */
-GLuint CreateShader( string vertex, string fragment );
+GLuint CreateShader( string vertex, string fragment, string defines = "" );
+
+/*!
+   \brief Jeden poziom mipmapy przygotowanej tekstury.
+*/
+struct ImageLevel{
+   /*!
+      \brief Szerokość poziomu.
+   */
+   GLsizei Width;
+   /*!
+      \brief Wysokość poziomu.
+   */
+   GLsizei Height;
+   /*!
+      \brief Dane poziomu (w \link ImageData::Pixels \endlink lub w zmapowanym pliku \link ImageData::Cache \endlink ).
+   */
+   const unsigned char *Data;
+   /*!
+      \brief Wielkość danych poziomu w bajtach.
+   */
+   GLsizei Size;
+};
+
+/*!
+   \brief Zdekodowana tekstura w pamięci CPU (przed przekazaniem do OpenGL).
+*/
+struct ImageData{
+   /*!
+      \brief Szerokość obrazka.
+   */
+   GLint Width;
+   /*!
+      \brief Wysokość obrazka.
+   */
+   GLint Height;
+   /*!
+      \brief Typ obrazka (np. RGB lub RGBA).
+   */
+   GLint Format;
+   /*!
+      \brief Specyfikacja pikseli (np. unsigned byte).
+   */
+   GLint Type;
+   /*!
+      \brief Piksele obrazka.
+   */
+   vector <unsigned char> Pixels;
+   /*!
+      \brief Suma kontrolna zawartości (liczona tylko przez \link TextureCache \endlink ). 0 = brak.
+   */
+   uint64_t Hash = 0;
+   /*!
+      \brief Format tekstury w OpenGL dla przygotowanych poziomów ( \link TextureCook \endlink ).
+   */
+   GLenum InternalFormat = 0;
+   /*!
+      \brief TRUE = przygotowane poziomy są skompresowane (glCompressedTexImage2D).
+   */
+   bool Compressed = false;
+   /*!
+      \brief Przygotowane poziomy mipmapy. Pusty = tylko \link Pixels \endlink, mipmapa liczona przez glGenerateMipmap.
+   */
+   vector <ImageLevel> Levels;
+   /*!
+      \brief Zmapowany plik pamięci podręcznej, w którym są przygotowane poziomy (NULL = poziomy w \link Pixels \endlink ).
+   */
+   shared_ptr <MeshCacheFile> Cache;
+};
+
+/*!
+   \brief Zwraca wielkość wszystkich danych tekstury w bajtach (wszystkich przygotowanych poziomów lub \link ImageData::Pixels \endlink ).
+
+   \param data - tekstura
+*/
+GLsizeiptr ReturnImageSize( const ImageData &data );
+
+/*!
+   \brief Blokada dla biblioteki DevIL, która przechowuje aktualny obrazek globalnie (nie może działać w kilku wątkach naraz).
+*/
+mutex DevILLock;
 
 /*!
    \brief Ładuje teksturę obiektu do pamięci.
@@ -21,10 +102,177 @@ GLuint CreateShader( string vertex, string fragment );
    \param image - identyfikator tekstury obiektu
    \return - wartość logiczną dla ładowania tekstury, FALSE = błąd
 
-   Wykorzystuje bibliotekę DevIL.
+   Wykorzystuje bibliotekę DevIL. Łączy \link DecodeImg() \endlink i \link UploadImg() \endlink.
 */
 bool LoadImg( const char *img_path_file, GLuint &image );
 
+/*!
+   \brief Dekoduje plik tekstury do pamięci CPU.
+
+   \param img_path_file - ścieżka do pliku z teksturą obiektu
+   \param data - zdekodowana tekstura
+   \return - wartość logiczną dla dekodowania tekstury, FALSE = błąd
+
+   Wykorzystuje bibliotekę DevIL (pod blokadą \link DevILLock \endlink), nie wywołuje funkcji OpenGL, więc może działać w wątku roboczym.
+*/
+bool DecodeImg( const char *img_path_file, ImageData &data );
+
+/*!
+   \brief Tworzy teksturę OpenGL ze zdekodowanej tekstury.
+
+   \param img_path_file - ścieżka do pliku z teksturą obiektu (dla komunikatów błędów)
+   \param data - zdekodowana tekstura
+   \param image - identyfikator tekstury obiektu
+   \param from_buffer - TRUE = piksele czytane są z aktualnego GL_PIXEL_UNPACK_BUFFER (od przesunięcia 0, poziomy jeden za drugim),
+   a nie z \link ImageData::Pixels \endlink lub \link ImageData::Levels \endlink
+   \return - wartość logiczną dla tworzenia tekstury, FALSE = błąd
+*/
+bool UploadImg( const char *img_path_file, const ImageData &data, GLuint &image, bool from_buffer = false );
+
+/*!
+   \brief Część obiektu (aiMesh) w buforach wspólnych dla całego obiektu.
+
+   Indeksy części liczone są od \link BaseVertex \endlink, rysowana jest przez glDrawElementsBaseVertex.
+*/
+struct MeshPart{
+   /*!
+      \brief Pierwszy indeks części w buforze indeksów.
+   */
+   GLuint FirstIndex;
+   /*!
+      \brief Ilość indeksów części.
+   */
+   GLuint IndexCount;
+   /*!
+      \brief Pierwszy wierzchołek części w buforze wierzchołków.
+   */
+   GLuint BaseVertex;
+   /*!
+      \brief Ilość wierzchołków części.
+   */
+   GLuint VertexCount;
+   /*!
+      \brief Numer materiału części.
+   */
+   GLuint Material;
+};
+
+/*!
+   \brief Poziom szczegółowości obiektu (LOD): kolejne części w \link Mesh::Parts \endlink, poziom 0 to obiekt wczytany przez assimp.
+*/
+struct MeshLod{
+   /*!
+      \brief Pierwsza część poziomu.
+   */
+   GLuint FirstPart;
+   /*!
+      \brief Ilość części poziomu (taka sama na każdym poziomie, te same materiały i wierzchołki, inne indeksy).
+   */
+   GLuint PartCount;
+   /*!
+      \brief Błąd uproszczenia we współrzędnych obiektu (odległość, oszacowanie z góry), 0 dla poziomu 0.
+   */
+   GLfloat Error;
+};
+
+/*!
+   \brief Grupa kolejnych trójkątów części poziomu 0 (meshlet) z bryłą otaczającą i stożkiem normalnych.
+*/
+struct MeshCluster{
+   /*!
+      \brief Środek sfery otaczającej (współrzędne obiektu).
+   */
+   vec3 Center;
+   /*!
+      \brief Promień sfery otaczającej.
+   */
+   GLfloat Radius;
+   /*!
+      \brief Oś stożka normalnych trójkątów (znormalizowana).
+   */
+   vec3 ConeAxis;
+   /*!
+      \brief Sinus rozwarcia stożka normalnych, 1 = grupa nigdy nie jest w całości odwrócona tyłem.
+   */
+   GLfloat ConeCutoff;
+   /*!
+      \brief Pierwszy indeks grupy w buforze indeksów (jak \link MeshPart::FirstIndex \endlink ).
+   */
+   GLuint FirstIndex;
+   /*!
+      \brief Ilość indeksów grupy.
+   */
+   GLuint IndexCount;
+   /*!
+      \brief Numer części (poziomu 0).
+   */
+   GLuint Part;
+};
+
+/*!
+   \brief Materiał wczytany przez assimp, pusta ścieżka = tekstura z pliku data.init.
+*/
+struct MeshMaterial{
+   /*!
+      \brief Ścieżka do pliku głównej tekstury.
+   */
+   string Texture;
+   /*!
+      \brief Ścieżka do pliku spektralnej tekstury.
+   */
+   string TextureSpecular;
+};
+
+/*!
+   \brief Bryły otaczające obiekt: prostopadłościan (AABB) i sfera.
+*/
+struct MeshBounds{
+   /*!
+      \brief Najmniejsze współrzędne prostopadłościanu.
+   */
+   vec3 Min;
+   /*!
+      \brief Największe współrzędne prostopadłościanu.
+   */
+   vec3 Max;
+   /*!
+      \brief Środek sfery.
+   */
+   vec3 Center;
+   /*!
+      \brief Promień sfery.
+   */
+   GLfloat Radius;
+};
+
+/*!
+   \brief Liczy bryły otaczające wierzchołki.
+
+   \param vertices - wektor Wierzchołków
+   \param bounds - bryły otaczające (środek sfery w środku prostopadłościanu, promień do najdalszego wierzchołka)
+*/
+void ComputeBounds( const vector <vec3> &vertices, MeshBounds &bounds );
+
+/*!
+   \brief Przenosi bryły otaczające przez macierz (np. do świata).
+
+   \param bounds - bryły otaczające
+   \param matrix - macierz przekształcenia
+   \return - bryły otaczające po przekształceniu (prostopadłościan obejmuje obrócony prostopadłościan, promień skalowany największą skalą)
+*/
+MeshBounds TransformBounds( const MeshBounds &bounds, const mat4 &matrix );
+
+/*!
+   \brief Zwraca największy indeks z zakresu [ first, first + count ).
+
+   \param indices - indeksy wierzchołków
+   \param type - typ indeksów (GL_UNSIGNED_SHORT lub GL_UNSIGNED_INT)
+   \param first - pierwszy indeks zakresu
+   \param count - ilość indeksów
+   \return - największy indeks, 0 dla pustego zakresu
+*/
+GLuint ReturnMaxIndex( const void *indices, GLenum type, GLuint first, GLuint count );
+
 /*!
    \brief Ładuje plik .obj do pamięci.
 
@@ -32,12 +280,15 @@ bool LoadImg( const char *img_path_file, GLuint &image );
    \param vertices - wektor Wierzchołków
    \param uvs - wektor UV Map
    \param normals - wektor Normalnych
-   \param indices - wektor Indeksów Wierzchołków
+   \param indices - wektor Indeksów Wierzchołków (liczonych od początku części)
+   \param parts - wektor części obiektu, posortowany według materiału
+   \param materials - wektor materiałów
+   \param bounds - bryły otaczające wszystkie wierzchołki
    \return - wartość logiczną dla ładowania pliku .obj, FALSE = błąd
 
-   Wykorzystuje bibliotekę assimp.
+   Wykorzystuje bibliotekę assimp. Wczytywane są wszystkie części obiektu (aiMesh) do wspólnych wektorów.
 */
-bool LoadAssimp( string file, vector <vec3> &vertices, vector <vec2> &uvs, vector <vec3> &normals, vector <GLuint> &indices );
+bool LoadAssimp( string file, vector <vec3> &vertices, vector <vec2> &uvs, vector <vec3> &normals, vector <GLuint> &indices, vector <MeshPart> &parts, vector <MeshMaterial> &materials, MeshBounds &bounds );
 
 /*
    ========
@@ -45,7 +296,7 @@ bool LoadAssimp( string file, vector <vec3> &vertices, vector <vec2> &uvs, vecto
    ========
 */
 
-GLuint CreateShader( string vertex, string fragment ){
+GLuint CreateShader( string vertex, string fragment, string defines ){
    /*
       Tworzenie shadera wierzchołków i fragmentu
       Zmienne w których przypisane będą ww shadery
@@ -77,8 +328,12 @@ GLuint CreateShader( string vertex, string fragment ){
       while( getline( VertexShaderStream, Line ) ){
          /*
             Dodaj to do zmiennej, w której będzie cały kod shadera.
+            Definicje muszą być za linią #version.
          */
          VertexShaderCode += Line + "\n";
+         if( Line.compare( 0, 8, "#version" ) == 0 ){
+            VertexShaderCode += defines;
+         }
       }
       /*
          Zamknięcie pliku.
@@ -102,6 +357,9 @@ GLuint CreateShader( string vertex, string fragment ){
       Line = "";
       while( getline( FragmentShaderStream, Line ) ){
          FragmentShaderCode += Line + "\n";
+         if( Line.compare( 0, 8, "#version" ) == 0 ){
+            FragmentShaderCode += defines;
+         }
       }
       FragmentShaderStream.close();
    }
@@ -251,11 +509,35 @@ GLuint CreateShader( string vertex, string fragment ){
 }
 
 bool LoadImg( const char *img_path_file, GLuint &image ){
+   ImageData data;
+   if( ! DecodeImg( img_path_file, data ) ){
+      image = 0;
+      return false;
+   }
+   return UploadImg( img_path_file, data, image );
+}
+
+GLsizeiptr ReturnImageSize( const ImageData &data ){
+   if( data.Levels.empty() ){
+      return data.Pixels.size();
+   }
+   GLsizeiptr Size = 0;
+   for( unsigned int i = 0; i < data.Levels.size(); ++i ){
+      Size += data.Levels[i].Size;
+   }
+   return Size;
+}
+
+bool DecodeImg( const char *img_path_file, ImageData &data ){
+   PROFILE_SCOPE_DETAIL( "DecodeImg", img_path_file );
    ILenum error;
-   GLenum error_gl;
    ILboolean success;
    ILuint imgage_id;
 
+   /*
+      DevIL ma jeden globalny aktualny obrazek, więc tylko jeden wątek naraz.
+   */
+   lock_guard <mutex> Guard( DevILLock );
    /*
       Tworzy identyfikator dla wczytywanej grafiki.
    */
@@ -284,7 +566,6 @@ bool LoadImg( const char *img_path_file, GLuint &image ){
             Wyświetl bład.
          */
          cout<<"ilLoadImage ("<<img_path_file<<"): "<<iluErrorString( error )<<"\n";
-         image = 0;
          /*
             Usuń z pamięci.
          */
@@ -295,7 +576,6 @@ bool LoadImg( const char *img_path_file, GLuint &image ){
          Gdyby były błedy z wczytanie a kod błedu na to nie wskazywał.
       */
       cout<<"ilLoadImage ("<<img_path_file<<"): "<<ilGetError()<<"\n";
-      image = 0;
       /*
          Usuń z pamięci.
       */
@@ -306,19 +586,35 @@ bool LoadImg( const char *img_path_file, GLuint &image ){
    /*
       Szerokość obrazka
    */
-   GLint width = ilGetInteger( IL_IMAGE_WIDTH );
+   data.Width = ilGetInteger( IL_IMAGE_WIDTH );
    /*
       Wysokość obrazka
    */
-   GLint height = ilGetInteger( IL_IMAGE_HEIGHT );
+   data.Height = ilGetInteger( IL_IMAGE_HEIGHT );
    /*
       Typ obrazka (np. RGB lub RGBA).
    */
-   GLint type = ilGetInteger( IL_IMAGE_TYPE );
+   data.Type = ilGetInteger( IL_IMAGE_TYPE );
    /*
       Specyfikacja pikseli (jak są reprezentowane, np. unsigned int).
    */
-   GLint format = ilGetInteger( IL_IMAGE_FORMAT );
+   data.Format = ilGetInteger( IL_IMAGE_FORMAT );
+   /*
+      Kopia pikseli, obrazek w DevIL zostanie usunięty.
+   */
+   ILubyte *Pixels = ilGetData();
+   data.Pixels.assign( Pixels, Pixels + ilGetInteger( IL_IMAGE_SIZE_OF_DATA ) );
+
+   /*
+      Usunięcie z pamięci obrazka w DevIL.
+   */
+   ilDeleteImages( 1, &imgage_id );
+   return true;
+}
+
+bool UploadImg( const char *img_path_file, const ImageData &data, GLuint &image, bool from_buffer ){
+   PROFILE_SCOPE_DETAIL( "UploadImg", img_path_file );
+   GLenum error_gl;
 
    /*
       Tworzy identyfikator tekstury
@@ -329,12 +625,30 @@ bool LoadImg( const char *img_path_file, GLuint &image ){
    */
    glBindTexture( GL_TEXTURE_2D, image );
 
-   /*
-      Kopiuje grafikę z DevIL do OpenGL.
-
-      ilGetData() - przekazanie całego obrazka (danych), który jest aktualnie przetwarzany.
-   */
-   glTexImage2D( GL_TEXTURE_2D, 0, format, width, height, 0, format, type, ilGetData() );
+   if( data.Levels.empty() ){
+      /*
+         Kopiuje zdekodowaną grafikę do OpenGL.
+      */
+      glTexImage2D( GL_TEXTURE_2D, 0, data.Format, data.Width, data.Height, 0, data.Format, data.Type, from_buffer ? NULL : &data.Pixels[0] );
+   }
+   else{
+      /*
+         Przygotowane poziomy mipmapy (bez glGenerateMipmap).
+      */
+      GLintptr Offset = 0;
+      for( unsigned int i = 0; i < data.Levels.size(); ++i ){
+         const ImageLevel &Level = data.Levels[i];
+         const GLvoid *Pixels = from_buffer ? (const GLvoid *)Offset : Level.Data;
+         if( data.Compressed ){
+            glCompressedTexImage2D( GL_TEXTURE_2D, i, data.InternalFormat, Level.Width, Level.Height, 0, Level.Size, Pixels );
+         }
+         else{
+            glTexImage2D( GL_TEXTURE_2D, i, data.InternalFormat, Level.Width, Level.Height, 0, data.Format, data.Type, Pixels );
+         }
+         Offset += Level.Size;
+      }
+      glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, data.Levels.size() - 1 );
+   }
    /*
       Sprawdzenie czy nie ma błedu.
    */
@@ -347,7 +661,9 @@ bool LoadImg( const char *img_path_file, GLuint &image ){
    /*
       Tworzenie automatycznej Mipmapy, im dalej tym gorsza tekstura.
    */
-   glGenerateMipmap( GL_TEXTURE_2D );
+   if( data.Levels.empty() ){
+      glGenerateMipmap( GL_TEXTURE_2D );
+   }
 
    /*
       Typ powtarzania obrazka, gdy się skończy dana tekstura.
@@ -364,15 +680,11 @@ bool LoadImg( const char *img_path_file, GLuint &image ){
       Czyszczenie.
    */
    glBindTexture(GL_TEXTURE_2D, 0);
-
-   /*
-      Usunięcie z pamięci obrazka w DevIL.
-   */
-   ilDeleteImages( 1, &imgage_id );
    return true;
 }
 
-bool LoadAssimp( string file, vector <vec3> &vertices, vector <vec2> &uvs, vector <vec3> &normals, vector <GLuint> &indices ){
+bool LoadAssimp( string file, vector <vec3> &vertices, vector <vec2> &uvs, vector <vec3> &normals, vector <GLuint> &indices, vector <MeshPart> &parts, vector <MeshMaterial> &materials, MeshBounds &bounds ){
+   PROFILE_SCOPE_DETAIL( "LoadAssimp", file );
    /*
       Dane wyjściowe dla wierzchołków
    */
@@ -389,6 +701,11 @@ bool LoadAssimp( string file, vector <vec3> &vertices, vector <vec2> &uvs, vecto
       Dane wyjściowe dla kolejności trójkątów
    */
    indices.clear();
+   /*
+      Dane wyjściowe dla części i materiałów
+   */
+   parts.clear();
+   materials.clear();
    /*
       Tworzenie importer dla ładowania danych.
    */
@@ -404,56 +721,167 @@ bool LoadAssimp( string file, vector <vec3> &vertices, vector <vec2> &uvs, vecto
       cout<<"importer.ReadFile ("<<file<<"):  "<<importer.GetErrorString()<<"\n";
       return false;
    }
-   /*
-      Wczytujemy tylko pierwszą część obiektu, inne pomijamy(występuje w obiektach kilku elementowych/częściowych).
-   */
-   const aiMesh* mesh = scene->mMeshes[0];
+   if( scene->mNumMeshes == 0 ){
+      cout<<"importer.ReadFile ("<<file<<"):  no meshes\n";
+      return false;
+   }
    unsigned int i = 0;
+   //materials:
    /*
-      Wektor dla pobierania danych.
+      Ścieżki tekstur materiałów są względne do katalogu pliku .obj.
    */
-   aiVector3D tmp;
-   //vertices:
+   string Directory;
+   size_t Slash = file.find_last_of( "/\\" );
+   if( Slash != string::npos ){
+      Directory = file.substr( 0, Slash + 1 );
+   }
+   materials.resize( scene->mNumMaterials );
+   for( i = 0; i < scene->mNumMaterials; ++i ){
+      aiString Path;
+      if( scene->mMaterials[i]->GetTexture( aiTextureType_DIFFUSE, 0, &Path ) == aiReturn_SUCCESS ){
+         materials[i].Texture = Directory + Path.C_Str();
+      }
+      if( scene->mMaterials[i]->GetTexture( aiTextureType_SPECULAR, 0, &Path ) == aiReturn_SUCCESS ){
+         materials[i].TextureSpecular = Directory + Path.C_Str();
+      }
+   }
    /*
-      Wierzchołki obiektu.
+      Części w kolejności materiałów, aby tekstury zmieniały się jak najrzadziej.
    */
-   vertices.reserve( mesh->mNumVertices );
-   for( i = 0; i < mesh->mNumVertices; ++i ){
-      tmp = mesh->mVertices[i];
-      vertices.push_back( vec3( tmp.x, tmp.y, tmp.z ) );
+   vector <unsigned int> Order( scene->mNumMeshes );
+   for( i = 0; i < scene->mNumMeshes; ++i ){
+      Order[i] = i;
    }
-   //uvs:
+   stable_sort( Order.begin(), Order.end(), [scene]( unsigned int a, unsigned int b ){
+      return scene->mMeshes[a]->mMaterialIndex < scene->mMeshes[b]->mMaterialIndex;
+   } );
    /*
-      UV Mapy
+      Wektor dla pobierania danych.
    */
-   uvs.reserve( mesh->mNumVertices );
-   for( i = 0; i < mesh->mNumVertices; ++i ){
-      tmp = mesh->mTextureCoords[0][i];
-      //important!
-      //This is done because most images have the top y-axis inversed with OpenGL's top y-axis.
-      //or conver in shader
-      uvs.push_back( glm::vec2( tmp.x, 1.0 - tmp.y ) );
+   aiVector3D tmp;
+   for( unsigned int m = 0; m < scene->mNumMeshes; ++m ){
+      const aiMesh* mesh = scene->mMeshes[ Order[m] ];
+      MeshPart Part;
+      Part.FirstIndex = indices.size();
+      Part.BaseVertex = vertices.size();
+      Part.VertexCount = mesh->mNumVertices;
+      Part.Material = mesh->mMaterialIndex;
+      //vertices:
+      /*
+         Wierzchołki obiektu.
+      */
+      vertices.reserve( vertices.size() + mesh->mNumVertices );
+      for( i = 0; i < mesh->mNumVertices; ++i ){
+         tmp = mesh->mVertices[i];
+         vertices.push_back( vec3( tmp.x, tmp.y, tmp.z ) );
+      }
+      //uvs:
+      /*
+         UV Mapy (część bez UV Mapy dostaje zera).
+      */
+      uvs.reserve( uvs.size() + mesh->mNumVertices );
+      for( i = 0; i < mesh->mNumVertices; ++i ){
+         if( mesh->mTextureCoords[0] == NULL ){
+            uvs.push_back( vec2( 0.0f ) );
+            continue;
+         }
+         tmp = mesh->mTextureCoords[0][i];
+         //important!
+         //This is done because most images have the top y-axis inversed with OpenGL's top y-axis.
+         //or conver in shader
+         uvs.push_back( glm::vec2( tmp.x, 1.0 - tmp.y ) );
+      }
+      //normals:
+      /*
+         Normalne (część bez normalnych dostaje zera).
+      */
+      normals.reserve( normals.size() + mesh->mNumVertices );
+      for( i = 0; i < mesh->mNumVertices; ++i ){
+         if( mesh->mNormals == NULL ){
+            normals.push_back( vec3( 0.0f ) );
+            continue;
+         }
+         tmp = mesh->mNormals[i];
+         normals.push_back( vec3( tmp.x, tmp.y, tmp.z ) );
+      }
+      //indices:
+      /*
+         Kolejność rysowania trójkątów oraz jak każdy jest reprezentowany przez wierzchołki.
+         Wielokąty dzielone są na wachlarz trójkątów, punkty i linie są pomijane.
+      */
+      indices.reserve( indices.size() + 3*mesh->mNumFaces );
+      for( i = 0; i < mesh->mNumFaces; ++i ){
+         const aiFace &Face = mesh->mFaces[i];
+         for( unsigned int k = 2; k < Face.mNumIndices; ++k ){
+            indices.push_back( Face.mIndices[0] );
+            indices.push_back( Face.mIndices[k - 1] );
+            indices.push_back( Face.mIndices[k] );
+         }
+      }
+      Part.IndexCount = indices.size() - Part.FirstIndex;
+      if( Part.IndexCount > 0 ){
+         parts.push_back( Part );
+      }
+   }
+   ComputeBounds( vertices, bounds );
+   return ! parts.empty();
+}
+
+void ComputeBounds( const vector <vec3> &vertices, MeshBounds &bounds ){
+   if( vertices.empty() ){
+      bounds.Min = bounds.Max = bounds.Center = vec3( 0.0f );
+      bounds.Radius = 0.0f;
+      return;
+   }
+   bounds.Min = bounds.Max = vertices[0];
+   for( unsigned int i = 1; i < vertices.size(); ++i ){
+      bounds.Min = glm::min( bounds.Min, vertices[i] );
+      bounds.Max = glm::max( bounds.Max, vertices[i] );
+   }
+   bounds.Center = ( bounds.Min + bounds.Max ) * 0.5f;
+   GLfloat Radius2 = 0.0f;
+   for( unsigned int i = 0; i < vertices.size(); ++i ){
+      vec3 Delta = vertices[i] - bounds.Center;
+      Radius2 = std::max( Radius2, dot( Delta, Delta ) );
    }
-   //normals:
+   bounds.Radius = sqrt( Radius2 );
+}
+
+MeshBounds TransformBounds( const MeshBounds &bounds, const mat4 &matrix ){
+   MeshBounds Result;
    /*
-      Normalne
+      Prostopadłościan: środek przez macierz, połowy krawędzi przez wartości bezwzględne części 3x3 (Arvo).
    */
-   normals.reserve( mesh->mNumVertices );
-   for( i = 0; i < mesh->mNumVertices; ++i ){
-      tmp = mesh->mNormals[i];
-      normals.push_back( vec3( tmp.x, tmp.y, tmp.z ) );
-   }
-   //indices:
+   vec3 Center = ( bounds.Min + bounds.Max ) * 0.5f;
+   vec3 Extent = ( bounds.Max - bounds.Min ) * 0.5f;
+   vec3 WorldCenter = vec3( matrix * vec4( Center, 1.0f ) );
+   vec3 WorldExtent = abs( vec3( matrix[0] ) ) * Extent.x + abs( vec3( matrix[1] ) ) * Extent.y + abs( vec3( matrix[2] ) ) * Extent.z;
+   Result.Min = WorldCenter - WorldExtent;
+   Result.Max = WorldCenter + WorldExtent;
    /*
-      Kolejność rysowania trójkątów oraz jak każdy jest reprezentowany przez wierzchołki.
+      Sfera: promień skalowany największą skalą osi.
    */
-   indices.reserve( 3*mesh->mNumFaces );
-   for( i = 0; i < mesh->mNumFaces; ++i ){
-      indices.push_back( mesh->mFaces[i].mIndices[0] );
-      indices.push_back( mesh->mFaces[i].mIndices[1] );
-      indices.push_back( mesh->mFaces[i].mIndices[2] );
+   GLfloat Scale = std::max( std::max( length( vec3( matrix[0] ) ), length( vec3( matrix[1] ) ) ), length( vec3( matrix[2] ) ) );
+   Result.Center = vec3( matrix * vec4( bounds.Center, 1.0f ) );
+   Result.Radius = bounds.Radius * Scale;
+   return Result;
+}
+
+GLuint ReturnMaxIndex( const void *indices, GLenum type, GLuint first, GLuint count ){
+   GLuint Max = 0;
+   if( type == GL_UNSIGNED_SHORT ){
+      const uint16_t *Indices = (const uint16_t *)indices + first;
+      for( GLuint i = 0; i < count; ++i ){
+         Max = std::max( Max, (GLuint)Indices[i] );
+      }
    }
-   return true;
+   else{
+      const GLuint *Indices = (const GLuint *)indices + first;
+      for( GLuint i = 0; i < count; ++i ){
+         Max = std::max( Max, Indices[i] );
+      }
+   }
+   return Max;
 }
 
 
@@ -0,0 +1,185 @@
+/*!
+   \file frame_uniforms.cpp
+   \brief Plik odpowiedzialny za bufor uniformów klatki (kamera i światła).
+*/
+#ifndef __frame_uniforms_hpp__
+#define __frame_uniforms_hpp__
+
+/*!
+   \brief Punkt wiązania (binding) bloku FrameData.
+*/
+#define FRAME_UNIFORMS_BINDING 0
+/*!
+   \brief Ilość świateł w bloku FrameData (Max_Directional_Light w shaderze).
+*/
+#define FRAME_UNIFORMS_LIGHTS 2
+
+/*!
+   \brief Światło w bloku FrameData (std140: vec3 zajmuje 16 bajtów, dlatego vec4).
+*/
+struct FrameLight{
+   /*!
+      \brief Pozycja światła (w = 0).
+   */
+   vec4 Position;
+   /*!
+      \brief Wartość Ambient światła (w = 0).
+   */
+   vec4 Ambient;
+   /*!
+      \brief Wartość Diffuse światła (w = 0).
+   */
+   vec4 Diffuse;
+   /*!
+      \brief Wartość Specular światła (w = 0).
+   */
+   vec4 Specular;
+};
+
+/*!
+   \brief Zawartość bloku FrameData w układzie std140 (Shader.vert i Shader.frag).
+*/
+struct FrameData{
+   /*!
+      \brief Macierz widoku.
+   */
+   mat4 View;
+   /*!
+      \brief Macierz projekcji.
+   */
+   mat4 Projection;
+   /*!
+      \brief Iloczyn macierzy projekcji i widoku.
+   */
+   mat4 ViewProjection;
+   /*!
+      \brief Pozycja kamery (w = 1).
+   */
+   vec4 ViewPos;
+   /*!
+      \brief Światła.
+   */
+   FrameLight Lights[ FRAME_UNIFORMS_LIGHTS ];
+};
+
+/*!
+   \brief Klasa odpowiedzialna za bufor uniformów (UBO) z danymi wspólnymi dla całej klatki.
+
+   Dane ustalane są na CPU ( \link SetCamera() \endlink, \link SetLight() \endlink ) i przekazywane jednym wywołaniem \link Upload() \endlink.
+*/
+class FrameUniforms{
+   public:
+      /*!
+         \brief Konstruktor domyślny.
+      */
+      FrameUniforms();
+      /*!
+         \brief Tworzy bufor, wiąże go z punktem \link FRAME_UNIFORMS_BINDING \endlink oraz blok FrameData programu z tym punktem.
+
+         \param program - program shaderów z blokiem FrameData
+         \return - TRUE = program zawiera blok FrameData
+      */
+      bool Init( GLuint program );
+      /*!
+         \brief Ustala macierze widoku, projekcji i pozycję kamery.
+
+         \param camera - kamera
+      */
+      void SetCamera( Camera &camera );
+      /*!
+         \brief Ustala wartości światła.
+
+         \param index - numer światła (mniejszy niż \link FRAME_UNIFORMS_LIGHTS \endlink )
+         \param light - światło
+      */
+      void SetLight( GLuint index, const Light &light );
+      /*!
+         \brief Przekazuje dane klatki do bufora (jedno wywołanie glBufferSubData).
+      */
+      void Upload();
+      /*!
+         \brief Zwraca iloczyn macierzy projekcji i widoku (ustalony przez \link SetCamera() \endlink ).
+      */
+      const mat4 & ReturnViewProjection() const;
+      /*!
+         \brief Usuwa bufor (przed usunięciem kontekstu OpenGL).
+      */
+      void Destroy();
+   private:
+      /*!
+         \brief Bufor uniformów.
+      */
+      GLuint Buffer = 0;
+      /*!
+         \brief Dane klatki po stronie CPU.
+      */
+      FrameData Data;
+};
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+FrameUniforms::FrameUniforms(){
+}
+
+bool FrameUniforms::Init( GLuint program ){
+   GLuint Index = glGetUniformBlockIndex( program, "FrameData" );
+   if( Index == GL_INVALID_INDEX ){
+      cout<<"Missing uniform block: FrameData\n";
+      return false;
+   }
+   /*
+      Układ std140 jest stały, rozmiar bloku w programie musi być równy strukturze FrameData.
+   */
+   GLint Size = 0;
+   glGetActiveUniformBlockiv( program, Index, GL_UNIFORM_BLOCK_DATA_SIZE, &Size );
+   if( Size != (GLint)sizeof( FrameData ) ){
+      cout<<"Wrong size of uniform block FrameData: "<<Size<<" (expected "<<sizeof( FrameData )<<")\n";
+      return false;
+   }
+   glUniformBlockBinding( program, Index, FRAME_UNIFORMS_BINDING );
+   glGenBuffers( 1, &this->Buffer );
+   glBindBuffer( GL_UNIFORM_BUFFER, this->Buffer );
+   glBufferData( GL_UNIFORM_BUFFER, sizeof( FrameData ), NULL, GL_DYNAMIC_DRAW );
+   glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+   glBindBufferBase( GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, this->Buffer );
+   return true;
+}
+
+void FrameUniforms::SetCamera( Camera &camera ){
+   this->Data.View = camera.ReturnViewMatrix();
+   this->Data.Projection = camera.ReturnProjectionMatrix();
+   this->Data.ViewProjection = camera.ReturnViewProjectionMatrix();
+   this->Data.ViewPos = vec4( camera.ReturnPosition(), 1.0f );
+}
+
+void FrameUniforms::SetLight( GLuint index, const Light &light ){
+   FrameLight &Target = this->Data.Lights[ index ];
+   Target.Position = vec4( light.ReturnPosition(), 0.0f );
+   Target.Ambient = vec4( light.ReturnAmbient(), 0.0f );
+   Target.Diffuse = vec4( light.ReturnDiffuse(), 0.0f );
+   Target.Specular = vec4( light.ReturnSpecular(), 0.0f );
+}
+
+void FrameUniforms::Upload(){
+   if( this->Buffer == 0 ){
+      return;
+   }
+   glBindBuffer( GL_UNIFORM_BUFFER, this->Buffer );
+   glBufferSubData( GL_UNIFORM_BUFFER, 0, sizeof( FrameData ), &this->Data );
+   glBindBuffer( GL_UNIFORM_BUFFER, 0 );
+}
+
+const mat4 & FrameUniforms::ReturnViewProjection() const{
+   return this->Data.ViewProjection;
+}
+
+void FrameUniforms::Destroy(){
+   glDeleteBuffers( 1, &this->Buffer );
+   this->Buffer = 0;
+}
+
+#endif
@@ -0,0 +1,290 @@
+/*!
+   \file frustum_culler.cpp
+   \brief Plik odpowiedzialny za odrzucanie obiektów poza ostrosłupem widzenia kamery.
+*/
+#ifndef __frustum_culler_hpp__
+#define __frustum_culler_hpp__
+
+#if defined( __SSE__ ) or defined( _M_X64 )
+   #include <xmmintrin.h>
+   /*!
+      \brief Test sfer po 4 naraz (SSE), bez SSE test każdej sfery osobno.
+   */
+   #define FRUSTUM_CULLER_SSE
+#endif
+
+/*!
+   \brief Klasa odpowiedzialna za test sfer otaczających wszystkich instancji obiektów z płaszczyznami ostrosłupa widzenia.
+
+   Sfery w świecie ( \link Mesh::ReturnWorldBounds() \endlink ) zbierane są co klatkę do osobnych tablic X, Y, Z, promień (SoA),
+   test 6 płaszczyzn liczony jest dla 4 sfer naraz (SSE). Sfera jest odrzucana, gdy leży całkowicie po zewnętrznej stronie jednej płaszczyzny.
+   Z drzewem \link SceneBVH \endlink sprawdzane są tylko węzły przecinające ostrosłup (prostopadłościany instancji zamiast sfer),
+   a czyszczone są tylko instancje widoczne w poprzedniej klatce (bez przeglądania wszystkich instancji).
+   Położenie instancji obiektów w tablicach liczone jest od nowa tylko po zmianie zbioru instancji ( \link Mesh::ReturnLayoutVersion() \endlink ).
+*/
+class FrustumCuller{
+   public:
+      /*!
+         \brief Konstruktor domyślny.
+      */
+      FrustumCuller();
+      /*!
+         \brief Ustala, czy obiekty są odrzucane. FALSE = wszystkie instancje widoczne.
+
+         \param enabled - TRUE = odrzucanie włączone
+      */
+      void SetEnabled( bool enabled );
+      /*!
+         \brief Sprawdza widoczność wszystkich instancji wczytanych obiektów.
+
+         \param items - obiekty
+         \param camera - kamera (płaszczyzny ostrosłupa widzenia)
+         \param bvh - drzewo instancji (aktualne, \link SceneBVH::Update() \endlink ), NULL = test wszystkich sfer
+         \param stats - liczniki klatki (widoczne i odrzucone instancje, odwiedzone węzły drzewa)
+      */
+      void Cull( const vector <Mesh> &items, Camera &camera, const SceneBVH *bvh, FrameStats &stats );
+      /*!
+         \brief Zwraca TRUE, gdy instancja obiektu jest widoczna (po \link Cull() \endlink ).
+
+         \param item - numer obiektu
+         \param instance - numer instancji
+      */
+      bool IsVisible( GLuint item, GLsizei instance ) const;
+      /*!
+         \brief Ukrywa widoczną instancję obiektu (np. zasłoniętą, \link OcclusionCuller \endlink ).
+
+         \param item - numer obiektu
+         \param instance - numer instancji
+      */
+      void Hide( GLuint item, GLsizei instance );
+      /*!
+         \brief Zwraca ilość widocznych instancji obiektu, 0 = obiekt nie jest rysowany.
+
+         \param item - numer obiektu
+      */
+      GLsizei ReturnVisibleCount( GLuint item ) const;
+   private:
+      /*!
+         \brief Test sfer [ begin, end ) ze wszystkimi płaszczyznami, wynik w \link Visible \endlink.
+
+         \param planes - płaszczyzny ostrosłupa widzenia
+         \param begin - pierwsza sfera
+         \param end - za ostatnią sferą
+      */
+      void TestScalar( const vec4 *planes, unsigned int begin, unsigned int end );
+#ifdef FRUSTUM_CULLER_SSE
+      /*!
+         \brief Test sfer [ 0, end ) po 4 naraz (end podzielne przez 4), wynik w \link Visible \endlink.
+
+         \param planes - płaszczyzny ostrosłupa widzenia
+         \param end - za ostatnią sferą
+      */
+      void TestSSE( const vec4 *planes, unsigned int end );
+#endif
+      /*!
+         \brief TRUE = odrzucanie włączone.
+      */
+      bool Enabled = true;
+      /*!
+         \brief Współrzędne X środków sfer.
+      */
+      vector <GLfloat> X;
+      /*!
+         \brief Współrzędne Y środków sfer.
+      */
+      vector <GLfloat> Y;
+      /*!
+         \brief Współrzędne Z środków sfer.
+      */
+      vector <GLfloat> Z;
+      /*!
+         \brief Promienie sfer.
+      */
+      vector <GLfloat> Radius;
+      /*!
+         \brief Widoczność każdej sfery (instancji), 1 = widoczna.
+      */
+      vector <uint8_t> Visible;
+      /*!
+         \brief Numer pierwszej sfery każdego obiektu w tablicach.
+      */
+      vector <GLuint> Offsets;
+      /*!
+         \brief Ilość widocznych instancji każdego obiektu.
+      */
+      vector <GLsizei> VisibleCounts;
+      /*!
+         \brief Wynik zapytania do drzewa instancji.
+      */
+      vector <BVHHit> Hits;
+      /*!
+         \brief Wersja zbioru instancji ( \link Mesh::ReturnLayoutVersion() \endlink ) dla \link Offsets \endlink.
+      */
+      unsigned long LayoutVersion = 0;
+      /*!
+         \brief TRUE = \link Visible \endlink z poprzedniej klatki ustalone przez drzewo (ustawione tylko instancje z \link Hits \endlink ).
+      */
+      bool TreeVisible = false;
+};
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+FrustumCuller::FrustumCuller(){
+}
+
+void FrustumCuller::SetEnabled( bool enabled ){
+   this->Enabled = enabled;
+}
+
+void FrustumCuller::Cull( const vector <Mesh> &items, Camera &camera, const SceneBVH *bvh, FrameStats &stats ){
+   PROFILE_SCOPE( "FrustumCuller::Cull" );
+   bool Tree = this->Enabled and bvh != NULL;
+   /*
+      Położenie instancji w tablicach (tylko po zmianie zbioru instancji).
+   */
+   if( items.size() != this->Offsets.size() or Mesh::ReturnLayoutVersion() != this->LayoutVersion ){
+      this->LayoutVersion = Mesh::ReturnLayoutVersion();
+      this->Offsets.assign( items.size(), 0 );
+      unsigned int Total = 0;
+      for( unsigned int i = 0; i < items.size(); ++i ){
+         this->Offsets[i] = Total;
+         if( items[i].IsLoaded() and items[i].ReturnGeometry() != 0 ){
+            Total += items[i].ReturnInstanceCount();
+         }
+      }
+      this->Visible.assign( Total, 0 );
+      this->VisibleCounts.assign( items.size(), 0 );
+      this->Hits.clear();
+      this->TreeVisible = false;
+   }
+   unsigned int Count = this->Visible.size();
+   unsigned long VisibleTotal = 0;
+   if( Tree ){
+      /*
+         Wyczyszczenie tylko instancji widocznych w poprzedniej klatce, potem instancje z zapytania do drzewa.
+      */
+      if( this->TreeVisible ){
+         for( unsigned int i = 0; i < this->Hits.size(); ++i ){
+            this->Visible[ this->Offsets[ this->Hits[i].Item ] + this->Hits[i].Instance ] = 0;
+            this->VisibleCounts[ this->Hits[i].Item ] = 0;
+         }
+      }
+      else{
+         this->Visible.assign( Count, 0 );
+         this->VisibleCounts.assign( items.size(), 0 );
+      }
+      this->Hits.clear();
+      stats.Add( COUNTER_BVH_NODES, bvh->QueryFrustum( camera.ReturnFrustumPlanes(), this->Hits ) );
+      for( unsigned int i = 0; i < this->Hits.size(); ++i ){
+         this->Visible[ this->Offsets[ this->Hits[i].Item ] + this->Hits[i].Instance ] = 1;
+         ++this->VisibleCounts[ this->Hits[i].Item ];
+      }
+      this->TreeVisible = true;
+      VisibleTotal = this->Hits.size();
+   }
+   else{
+      this->TreeVisible = false;
+      this->X.clear();
+      this->Y.clear();
+      this->Z.clear();
+      this->Radius.clear();
+      /*
+         Sfery potrzebne tylko do testu bez drzewa.
+      */
+      for( unsigned int i = 0; i < items.size() and this->Enabled; ++i ){
+         unsigned int End = ( i + 1 < items.size() ) ? this->Offsets[ i + 1 ] : Count;
+         for( GLsizei k = 0; k < (GLsizei)( End - this->Offsets[i] ); ++k ){
+            const MeshBounds &Bounds = items[i].ReturnWorldBounds( k );
+            this->X.push_back( Bounds.Center.x );
+            this->Y.push_back( Bounds.Center.y );
+            this->Z.push_back( Bounds.Center.z );
+            this->Radius.push_back( Bounds.Radius );
+         }
+      }
+      this->Visible.assign( Count, this->Enabled ? 0 : 1 );
+      if( this->Enabled ){
+         const vec4 *Planes = camera.ReturnFrustumPlanes();
+#ifdef FRUSTUM_CULLER_SSE
+         unsigned int Vector = Count & ~3u;
+         this->TestSSE( Planes, Vector );
+         this->TestScalar( Planes, Vector, Count );
+#else
+         this->TestScalar( Planes, 0, Count );
+#endif
+      }
+      for( unsigned int i = 0; i < items.size(); ++i ){
+         unsigned int End = ( i + 1 < items.size() ) ? this->Offsets[ i + 1 ] : Count;
+         this->VisibleCounts[i] = 0;
+         for( unsigned int k = this->Offsets[i]; k < End; ++k ){
+            this->VisibleCounts[i] += this->Visible[k];
+         }
+         VisibleTotal += this->VisibleCounts[i];
+      }
+   }
+   stats.Add( COUNTER_VISIBLE, VisibleTotal );
+   stats.Add( COUNTER_CULLED, Count - VisibleTotal );
+}
+
+bool FrustumCuller::IsVisible( GLuint item, GLsizei instance ) const{
+   return this->Visible[ this->Offsets[ item ] + instance ] != 0;
+}
+
+void FrustumCuller::Hide( GLuint item, GLsizei instance ){
+   uint8_t &Flag = this->Visible[ this->Offsets[ item ] + instance ];
+   if( Flag ){
+      Flag = 0;
+      --this->VisibleCounts[ item ];
+   }
+}
+
+GLsizei FrustumCuller::ReturnVisibleCount( GLuint item ) const{
+   return ( item < this->VisibleCounts.size() ) ? this->VisibleCounts[ item ] : 0;
+}
+
+void FrustumCuller::TestScalar( const vec4 *planes, unsigned int begin, unsigned int end ){
+   for( unsigned int i = begin; i < end; ++i ){
+      bool Inside = true;
+      for( int p = 0; p < FRUSTUM_PLANES and Inside; ++p ){
+         Inside = planes[p].x * this->X[i] + planes[p].y * this->Y[i] + planes[p].z * this->Z[i] + planes[p].w >= -this->Radius[i];
+      }
+      this->Visible[i] = Inside;
+   }
+}
+
+#ifdef FRUSTUM_CULLER_SSE
+void FrustumCuller::TestSSE( const vec4 *planes, unsigned int end ){
+   __m128 PlaneX[ FRUSTUM_PLANES ], PlaneY[ FRUSTUM_PLANES ], PlaneZ[ FRUSTUM_PLANES ], PlaneW[ FRUSTUM_PLANES ];
+   for( int p = 0; p < FRUSTUM_PLANES; ++p ){
+      PlaneX[p] = _mm_set1_ps( planes[p].x );
+      PlaneY[p] = _mm_set1_ps( planes[p].y );
+      PlaneZ[p] = _mm_set1_ps( planes[p].z );
+      PlaneW[p] = _mm_set1_ps( planes[p].w );
+   }
+   const __m128 Zero = _mm_setzero_ps();
+   for( unsigned int i = 0; i < end; i += 4 ){
+      __m128 CenterX = _mm_loadu_ps( &this->X[i] );
+      __m128 CenterY = _mm_loadu_ps( &this->Y[i] );
+      __m128 CenterZ = _mm_loadu_ps( &this->Z[i] );
+      __m128 NegativeRadius = _mm_sub_ps( Zero, _mm_loadu_ps( &this->Radius[i] ) );
+      /*
+         Maska: bit ustawiony = sfera po wewnętrznej stronie wszystkich dotychczasowych płaszczyzn.
+      */
+      __m128 Inside = _mm_cmpeq_ps( Zero, Zero );
+      for( int p = 0; p < FRUSTUM_PLANES; ++p ){
+         __m128 Distance = _mm_add_ps( _mm_add_ps( _mm_mul_ps( PlaneX[p], CenterX ), _mm_mul_ps( PlaneY[p], CenterY ) ),
+                                       _mm_add_ps( _mm_mul_ps( PlaneZ[p], CenterZ ), PlaneW[p] ) );
+         Inside = _mm_and_ps( Inside, _mm_cmpge_ps( Distance, NegativeRadius ) );
+      }
+      int Mask = _mm_movemask_ps( Inside );
+      for( int k = 0; k < 4; ++k ){
+         this->Visible[ i + k ] = ( Mask >> k ) & 1;
+      }
+   }
+}
+#endif
+
+#endif
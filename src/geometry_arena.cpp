@@ -0,0 +1,522 @@
+/*!
+   \file geometry_arena.cpp
+   \brief Plik odpowiedzialny za wspólne bufory wierzchołków i indeksów dla wszystkich obiektów.
+*/
+#ifndef __geometry_arena_hpp__
+#define __geometry_arena_hpp__
+
+/*!
+   \brief Początkowa wielkość (w bajtach) bufora wierzchołków, bufor rośnie dwukrotnie w razie potrzeby.
+*/
+#define GEOMETRY_ARENA_VERTEX_SIZE ( 8 << 20 )
+
+/*!
+   \brief Początkowa wielkość (w bajtach) bufora indeksów, bufor rośnie dwukrotnie w razie potrzeby.
+*/
+#define GEOMETRY_ARENA_INDEX_SIZE ( 4 << 20 )
+
+/*!
+   \brief Najmniejsza ilość wolnych bajtów między fragmentami, od której bufory są kompaktowane.
+*/
+#define GEOMETRY_ARENA_COMPACT_SIZE ( 1 << 20 )
+
+/*!
+   \brief Fragment bufora OpenGL.
+*/
+struct GeometryRange{
+   /*!
+      \brief Położenie od początku bufora, w bajtach.
+   */
+   GLintptr Offset;
+   /*!
+      \brief Wielkość, w bajtach.
+   */
+   GLsizeiptr Size;
+};
+
+/*!
+   \brief Bufor OpenGL dzielony na fragmenty (lista wolnych fragmentów, first-fit).
+
+   Wyrównanie zapewnia wywołujący: wszystkie fragmenty jednego bufora muszą mieć wielkość będącą wielokrotnością wyrównania.
+
+   Wszystkie funkcje wywoływać tylko w wątku z kontekstem OpenGL.
+*/
+class GeometryBuffer{
+   public:
+      /*!
+         \brief Konstruktor domyślny.
+      */
+      GeometryBuffer();
+      /*!
+         \brief Przydziela fragment bufora i wypełnia go danymi.
+
+         \param data - dane
+         \param size - wielkość danych w bajtach (wielokrotność wyrównania fragmentów)
+         \param range - przydzielony fragment
+         \return - TRUE = bufor został zastąpiony większym (trzeba ponownie przypiąć go do VAO)
+      */
+      bool Allocate( const void *data, GLsizeiptr size, GeometryRange &range );
+      /*!
+         \brief Zwalnia fragment bufora (łączy go z sąsiednimi wolnymi fragmentami).
+
+         \param range - zwalniany fragment
+      */
+      void Free( const GeometryRange &range );
+      /*!
+         \brief Przenosi fragmenty do nowego bufora, jeden za drugim bez przerw.
+
+         \param ranges - wskaźniki do wszystkich zajętych fragmentów, położenia są zmieniane
+      */
+      void Compact( vector <GeometryRange *> &ranges );
+      /*!
+         \brief Usuwa bufor.
+      */
+      void Destroy();
+      /*!
+         \brief Zwraca identyfikator bufora OpenGL.
+      */
+      GLuint ReturnBuffer() const;
+      /*!
+         \brief Zwraca ilość wolnych bajtów między zajętymi fragmentami.
+      */
+      GLsizeiptr ReturnHoles() const;
+      /*!
+         \brief Ustala początkową wielkość bufora.
+
+         \param capacity - początkowa wielkość bufora w bajtach
+      */
+      void SetSize( GLsizeiptr capacity );
+   private:
+      /*!
+         \brief Zastępuje bufor nowym o podanej wielkości, kopiując zajętą część.
+
+         \param capacity - nowa wielkość bufora w bajtach
+      */
+      void Resize( GLsizeiptr capacity );
+      /*!
+         \brief Identyfikator bufora OpenGL, 0 = jeszcze nie utworzony.
+      */
+      GLuint Buffer = 0;
+      /*!
+         \brief Wielkość bufora w bajtach.
+      */
+      GLsizeiptr Capacity = 0;
+      /*!
+         \brief Koniec zajętej części bufora (za nim wszystko jest wolne).
+      */
+      GLsizeiptr End = 0;
+      /*!
+         \brief Początkowa wielkość bufora w bajtach.
+      */
+      GLsizeiptr InitialCapacity = 0;
+      /*!
+         \brief Wolne fragmenty przed \link End \endlink, posortowane według położenia.
+      */
+      vector <GeometryRange> FreeRanges;
+};
+
+/*!
+   \brief Geometria jednego obiektu we wspólnych buforach.
+*/
+struct GeometryAllocation{
+   /*!
+      \brief Fragment bufora wierzchołków.
+   */
+   GeometryRange Vertices;
+   /*!
+      \brief Fragment bufora indeksów.
+   */
+   GeometryRange Indices;
+   /*!
+      \brief Ilość obiektów używających geometrii, 0 = wolne miejsce w tablicy.
+   */
+   unsigned int References;
+};
+
+/*!
+   \brief Klasa odpowiedzialna za wspólne bufory wierzchołków i indeksów dla wszystkich obiektów oraz jedno VAO.
+
+   Obiekty rysowane są przez glDrawElementsBaseVertex: numer pierwszego wierzchołka i położenie indeksów zwraca identyfikator geometrii.
+   Geometria jest liczona referencjami (jak tekstury w \link TextureCache \endlink ), ostatni obiekt zwalnia fragmenty buforów.
+   Gdy wolnych bajtów między fragmentami jest więcej niż zajętych, bufory są kompaktowane (położenia zmieniają się, identyfikatory nie).
+   Wszystkie funkcje wywoływać tylko w wątku z kontekstem OpenGL.
+*/
+class GeometryArena{
+   public:
+      /*!
+         \brief Ustala format wierzchołków (przed pierwszym \link Allocate() \endlink ).
+
+         \param format - format wierzchołków
+      */
+      static void SetVertexFormat( VertexFormat format );
+      /*!
+         \brief Kopiuje geometrię obiektu do wspólnych buforów.
+
+         \param vertices - wskaźnik do wierzchołków w formacie \link Format \endlink
+         \param vertex_count - ilość wierzchołków
+         \param indices - wskaźnik do indeksów
+         \param index_size - wielkość indeksów w bajtach
+         \return - identyfikator geometrii (z jedną referencją), 0 = brak
+      */
+      static GLuint Allocate( const void *vertices, GLsizei vertex_count, const void *indices, GLsizeiptr index_size );
+      /*!
+         \brief Zwiększa licznik referencji geometrii.
+
+         \param geometry - identyfikator geometrii, 0 jest pomijane
+      */
+      static void Retain( GLuint geometry );
+      /*!
+         \brief Zmniejsza licznik referencji geometrii, ostatnia referencja zwalnia fragmenty buforów.
+
+         \param geometry - identyfikator geometrii, 0 jest pomijane
+      */
+      static void Release( GLuint geometry );
+      /*!
+         \brief Zwraca numer pierwszego wierzchołka geometrii w buforze wierzchołków.
+
+         \param geometry - identyfikator geometrii
+      */
+      static GLint ReturnBaseVertex( GLuint geometry );
+      /*!
+         \brief Zwraca położenie indeksów geometrii w buforze indeksów, w bajtach.
+
+         \param geometry - identyfikator geometrii
+      */
+      static GLintptr ReturnIndexOffset( GLuint geometry );
+      /*!
+         \brief Przypina wspólne VAO (raz przed rysowaniem wszystkich obiektów).
+      */
+      static void Bind();
+      /*!
+         \brief Zwraca identyfikator wspólnego VAO.
+      */
+      static GLuint ReturnVAO();
+      /*!
+         \brief Przenosi geometrię do nowych buforów bez przerw między fragmentami.
+      */
+      static void Compact();
+      /*!
+         \brief Usuwa bufory i VAO (przed usunięciem kontekstu OpenGL), pozostałe identyfikatory stają się nieważne.
+      */
+      static void Destroy();
+   private:
+      /*!
+         \brief Tworzy VAO i przypina do niego aktualne bufory.
+      */
+      static void UpdateVAO();
+      /*!
+         \brief Format wierzchołków, domyślnie \link VERTEX_FLOAT \endlink.
+      */
+      static VertexFormat Format;
+      /*!
+         \brief Wspólne VAO, 0 = jeszcze nie utworzone.
+      */
+      static GLuint VAO;
+      /*!
+         \brief Bufor wierzchołków (fragmenty wyrównane do wielkości wierzchołka).
+      */
+      static GeometryBuffer VertexBuffer;
+      /*!
+         \brief Bufor indeksów (fragmenty wyrównane do 4 bajtów).
+      */
+      static GeometryBuffer IndexBuffer;
+      /*!
+         \brief Geometria obiektów, identyfikator to numer w tablicy + 1.
+      */
+      static vector <GeometryAllocation> Allocations;
+};
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+GeometryBuffer::GeometryBuffer(){
+}
+
+bool GeometryBuffer::Allocate( const void *data, GLsizeiptr size, GeometryRange &range ){
+   bool Resized = false;
+   range.Size = size;
+   range.Offset = -1;
+   /*
+      Najpierw pierwszy pasujący wolny fragment.
+   */
+   for( unsigned int i = 0; i < this->FreeRanges.size(); ++i ){
+      if( this->FreeRanges[i].Size >= size ){
+         range.Offset = this->FreeRanges[i].Offset;
+         this->FreeRanges[i].Offset += size;
+         this->FreeRanges[i].Size -= size;
+         if( this->FreeRanges[i].Size == 0 ){
+            this->FreeRanges.erase( this->FreeRanges.begin() + i );
+         }
+         break;
+      }
+   }
+   /*
+      Inaczej na końcu zajętej części, bufor rośnie dwukrotnie gdy brakuje miejsca.
+   */
+   if( range.Offset < 0 ){
+      if( this->End + size > this->Capacity ){
+         GLsizeiptr Capacity = ( this->Capacity > 0 ) ? this->Capacity : this->InitialCapacity;
+         while( this->End + size > Capacity ){
+            Capacity *= 2;
+         }
+         this->Resize( Capacity );
+         Resized = true;
+      }
+      range.Offset = this->End;
+      this->End += size;
+   }
+   /*
+      GL_COPY_WRITE_BUFFER nie zmienia stanu żadnego VAO.
+   */
+   glBindBuffer( GL_COPY_WRITE_BUFFER, this->Buffer );
+   glBufferSubData( GL_COPY_WRITE_BUFFER, range.Offset, size, data );
+   glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+   return Resized;
+}
+
+void GeometryBuffer::Free( const GeometryRange &range ){
+   if( range.Size == 0 ){
+      return;
+   }
+   /*
+      Wstawienie według położenia i połączenie z sąsiadami.
+   */
+   vector <GeometryRange>::iterator It = this->FreeRanges.begin();
+   while( It != this->FreeRanges.end() and It->Offset < range.Offset ){
+      ++It;
+   }
+   It = this->FreeRanges.insert( It, range );
+   if( It + 1 != this->FreeRanges.end() and It->Offset + It->Size == ( It + 1 )->Offset ){
+      It->Size += ( It + 1 )->Size;
+      this->FreeRanges.erase( It + 1 );
+   }
+   if( It != this->FreeRanges.begin() and ( It - 1 )->Offset + ( It - 1 )->Size == It->Offset ){
+      ( It - 1 )->Size += It->Size;
+      It = this->FreeRanges.erase( It ) - 1;
+   }
+   /*
+      Wolny fragment na końcu zajętej części skraca ją.
+   */
+   if( It->Offset + It->Size == this->End ){
+      this->End = It->Offset;
+      this->FreeRanges.erase( It );
+   }
+}
+
+void GeometryBuffer::Compact( vector <GeometryRange *> &ranges ){
+   if( this->Buffer == 0 ){
+      return;
+   }
+   GLsizeiptr Used = 0;
+   for( unsigned int i = 0; i < ranges.size(); ++i ){
+      Used += ranges[i]->Size;
+   }
+   GLsizeiptr Capacity = this->InitialCapacity;
+   while( Used > Capacity ){
+      Capacity *= 2;
+   }
+   GLuint Buffer;
+   glGenBuffers( 1, &Buffer );
+   glBindBuffer( GL_COPY_WRITE_BUFFER, Buffer );
+   glBufferData( GL_COPY_WRITE_BUFFER, Capacity, NULL, GL_STATIC_DRAW );
+   glBindBuffer( GL_COPY_READ_BUFFER, this->Buffer );
+   /*
+      Fragmenty w kolejności położenia, kopiowanie na GPU bez udziału CPU.
+   */
+   sort( ranges.begin(), ranges.end(), []( const GeometryRange *a, const GeometryRange *b ){
+      return a->Offset < b->Offset;
+   } );
+   GLintptr Offset = 0;
+   for( unsigned int i = 0; i < ranges.size(); ++i ){
+      glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, ranges[i]->Offset, Offset, ranges[i]->Size );
+      ranges[i]->Offset = Offset;
+      Offset += ranges[i]->Size;
+   }
+   glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+   glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+   glDeleteBuffers( 1, &this->Buffer );
+   this->Buffer = Buffer;
+   this->Capacity = Capacity;
+   this->End = Offset;
+   this->FreeRanges.clear();
+}
+
+void GeometryBuffer::Destroy(){
+   glDeleteBuffers( 1, &this->Buffer );
+   this->Buffer = 0;
+   this->Capacity = 0;
+   this->End = 0;
+   this->FreeRanges.clear();
+}
+
+GLuint GeometryBuffer::ReturnBuffer() const{
+   return this->Buffer;
+}
+
+GLsizeiptr GeometryBuffer::ReturnHoles() const{
+   GLsizeiptr Holes = 0;
+   for( unsigned int i = 0; i < this->FreeRanges.size(); ++i ){
+      Holes += this->FreeRanges[i].Size;
+   }
+   return Holes;
+}
+
+void GeometryBuffer::SetSize( GLsizeiptr capacity ){
+   this->InitialCapacity = capacity;
+}
+
+void GeometryBuffer::Resize( GLsizeiptr capacity ){
+   GLuint Buffer;
+   glGenBuffers( 1, &Buffer );
+   glBindBuffer( GL_COPY_WRITE_BUFFER, Buffer );
+   glBufferData( GL_COPY_WRITE_BUFFER, capacity, NULL, GL_STATIC_DRAW );
+   if( this->Buffer != 0 ){
+      glBindBuffer( GL_COPY_READ_BUFFER, this->Buffer );
+      glCopyBufferSubData( GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, this->End );
+      glBindBuffer( GL_COPY_READ_BUFFER, 0 );
+      glDeleteBuffers( 1, &this->Buffer );
+   }
+   glBindBuffer( GL_COPY_WRITE_BUFFER, 0 );
+   this->Buffer = Buffer;
+   this->Capacity = capacity;
+}
+
+VertexFormat GeometryArena::Format = VERTEX_FLOAT;
+GLuint GeometryArena::VAO = 0;
+GeometryBuffer GeometryArena::VertexBuffer;
+GeometryBuffer GeometryArena::IndexBuffer;
+vector <GeometryAllocation> GeometryArena::Allocations;
+
+void GeometryArena::SetVertexFormat( VertexFormat format ){
+   GeometryArena::Format = format;
+}
+
+GLuint GeometryArena::Allocate( const void *vertices, GLsizei vertex_count, const void *indices, GLsizeiptr index_size ){
+   if( vertex_count <= 0 or index_size <= 0 ){
+      return 0;
+   }
+   GLsizeiptr Stride = ReturnVertexStride( GeometryArena::Format );
+   /*
+      Fragmenty wierzchołków są wielokrotnością wierzchołka (numer pierwszego wierzchołka to położenie / wielkość).
+   */
+   GeometryArena::VertexBuffer.SetSize( GEOMETRY_ARENA_VERTEX_SIZE / Stride * Stride );
+   GeometryArena::IndexBuffer.SetSize( GEOMETRY_ARENA_INDEX_SIZE );
+   /*
+      Indeksy 16 bitów dopełniane do 4 bajtów, aby każdy fragment zaczynał się od wyrównanego położenia.
+   */
+   GeometryAllocation Allocation;
+   Allocation.References = 1;
+   GLsizeiptr IndexSize = ( index_size + 3 ) / 4 * 4;
+   vector <unsigned char> Padded;
+   if( IndexSize != index_size ){
+      Padded.assign( (const unsigned char *)indices, (const unsigned char *)indices + index_size );
+      Padded.resize( IndexSize, 0 );
+      indices = Padded.data();
+   }
+   bool Resized = GeometryArena::VertexBuffer.Allocate( vertices, vertex_count * Stride, Allocation.Vertices );
+   Resized = GeometryArena::IndexBuffer.Allocate( indices, IndexSize, Allocation.Indices ) or Resized;
+   if( Resized or GeometryArena::VAO == 0 ){
+      GeometryArena::UpdateVAO();
+   }
+   /*
+      Pierwsze wolne miejsce w tablicy.
+   */
+   for( unsigned int i = 0; i < GeometryArena::Allocations.size(); ++i ){
+      if( GeometryArena::Allocations[i].References == 0 ){
+         GeometryArena::Allocations[i] = Allocation;
+         return i + 1;
+      }
+   }
+   GeometryArena::Allocations.push_back( Allocation );
+   return GeometryArena::Allocations.size();
+}
+
+void GeometryArena::Retain( GLuint geometry ){
+   if( geometry == 0 or geometry > GeometryArena::Allocations.size() ){
+      return;
+   }
+   ++GeometryArena::Allocations[ geometry - 1 ].References;
+}
+
+void GeometryArena::Release( GLuint geometry ){
+   if( geometry == 0 or geometry > GeometryArena::Allocations.size() ){
+      return;
+   }
+   GeometryAllocation &Allocation = GeometryArena::Allocations[ geometry - 1 ];
+   if( Allocation.References == 0 or --Allocation.References > 0 ){
+      return;
+   }
+   GeometryArena::VertexBuffer.Free( Allocation.Vertices );
+   GeometryArena::IndexBuffer.Free( Allocation.Indices );
+   /*
+      Kompaktowanie, gdy przerwy między fragmentami są duże.
+   */
+   GLsizeiptr Holes = GeometryArena::VertexBuffer.ReturnHoles() + GeometryArena::IndexBuffer.ReturnHoles();
+   GLsizeiptr Used = 0;
+   for( unsigned int i = 0; i < GeometryArena::Allocations.size(); ++i ){
+      if( GeometryArena::Allocations[i].References > 0 ){
+         Used += GeometryArena::Allocations[i].Vertices.Size + GeometryArena::Allocations[i].Indices.Size;
+      }
+   }
+   if( Holes >= GEOMETRY_ARENA_COMPACT_SIZE and Holes > Used ){
+      GeometryArena::Compact();
+   }
+}
+
+GLint GeometryArena::ReturnBaseVertex( GLuint geometry ){
+   return GeometryArena::Allocations[ geometry - 1 ].Vertices.Offset / ReturnVertexStride( GeometryArena::Format );
+}
+
+GLintptr GeometryArena::ReturnIndexOffset( GLuint geometry ){
+   return GeometryArena::Allocations[ geometry - 1 ].Indices.Offset;
+}
+
+void GeometryArena::Bind(){
+   glBindVertexArray( GeometryArena::VAO );
+}
+
+GLuint GeometryArena::ReturnVAO(){
+   return GeometryArena::VAO;
+}
+
+void GeometryArena::Compact(){
+   PROFILE_SCOPE( "GeometryArena::Compact" );
+   vector <GeometryRange *> Vertices, Indices;
+   for( unsigned int i = 0; i < GeometryArena::Allocations.size(); ++i ){
+      if( GeometryArena::Allocations[i].References > 0 ){
+         Vertices.push_back( &GeometryArena::Allocations[i].Vertices );
+         Indices.push_back( &GeometryArena::Allocations[i].Indices );
+      }
+   }
+   GeometryArena::VertexBuffer.Compact( Vertices );
+   GeometryArena::IndexBuffer.Compact( Indices );
+   GeometryArena::UpdateVAO();
+}
+
+void GeometryArena::Destroy(){
+   glDeleteVertexArrays( 1, &GeometryArena::VAO );
+   GeometryArena::VAO = 0;
+   GeometryArena::VertexBuffer.Destroy();
+   GeometryArena::IndexBuffer.Destroy();
+   GeometryArena::Allocations.clear();
+}
+
+void GeometryArena::UpdateVAO(){
+   if( GeometryArena::VAO == 0 ){
+      glGenVertexArrays( 1, &GeometryArena::VAO );
+   }
+   /*
+      Przypinanie do VAO wejść 0 (pozycja), 1 (UV Mapa) i 2 (normalna) oraz bufora indeksów.
+   */
+   glBindVertexArray( GeometryArena::VAO );
+   glBindBuffer( GL_ARRAY_BUFFER, GeometryArena::VertexBuffer.ReturnBuffer() );
+   SetVertexAttributes( GeometryArena::Format );
+   glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, GeometryArena::IndexBuffer.ReturnBuffer() );
+   glBindVertexArray( 0 );
+   glBindBuffer( GL_ARRAY_BUFFER, 0 );
+}
+
+#endif
@@ -0,0 +1,312 @@
+/*!
+   \file gpu_profiler.cpp
+   \brief Plik odpowiedzialny za pomiar czasu GPU (zapytania GL_TIMESTAMP).
+*/
+#ifndef __gpu_profiler_hpp__
+#define __gpu_profiler_hpp__
+
+/*!
+   \brief Jeden zmierzony na GPU fragment klatki.
+*/
+struct GpuSection{
+   /*!
+      \brief Nazwa fragmentu (np. Clear, Draw, Present).
+   */
+   const char *Name;
+   /*!
+      \brief Dodatkowy opis (np. nazwa obiektu).
+   */
+   string Detail;
+   /*!
+      \brief Początek fragmentu, czas GPU w nanosekundach.
+   */
+   GLint64 Start;
+   /*!
+      \brief Długość fragmentu, w nanosekundach.
+   */
+   GLint64 Duration;
+};
+
+/*!
+   \brief Klasa odpowiedzialna za pomiar czasu GPU poszczególnych fragmentów klatki.
+
+   Na początku klatki i po każdym fragmencie zapisywany jest znacznik czasu GPU (glQueryCounter z GL_TIMESTAMP).
+   Czas fragmentu to różnica pomiędzy jego znacznikiem a poprzednim.\n
+   Zapytania trzymane są w pierścieniu \link Latency \endlink klatek, wyniki odczytywane są dopiero po tylu klatkach,
+   więc odczyt nie zatrzymuje CPU. Gdy wynik nadal nie jest gotowy, klatka jest pomijana.
+*/
+class GpuProfiler{
+   public:
+      /*!
+         \brief Konstruktor domyślny.
+      */
+      GpuProfiler();
+      /*!
+         \brief Przygotowuje pierścień zapytań.
+
+         \param latency - po ilu klatkach odczytywane są wyniki
+      */
+      void Init( int latency );
+      /*!
+         \brief Zwraca TRUE, gdy pomiar jest włączony (wywołano \link Init() \endlink).
+      */
+      bool IsEnabled() const;
+      /*!
+         \brief Początek klatki: odczytuje gotowe wyniki sprzed \link Latency \endlink klatek i zapisuje pierwszy znacznik czasu.
+      */
+      void BeginFrame();
+      /*!
+         \brief Koniec fragmentu klatki, czas od poprzedniego znacznika przypisywany jest do tego fragmentu.
+
+         \param name - nazwa fragmentu (stały tekst)
+         \param detail - dodatkowy opis
+      */
+      void Mark( const char *name, const string &detail = "" );
+      /*!
+         \brief Czeka na wyniki wszystkich zapisanych klatek (np. na końcu pomiaru).
+      */
+      void Flush();
+      /*!
+         \brief Zwraca odczytane klatki (każda jako wektor fragmentów).
+      */
+      const vector < vector <GpuSection> > & ReturnCompleted() const;
+      /*!
+         \brief Zwraca numery odczytanych klatek ( \link ReturnFrame() \endlink w chwili ich rozpoczęcia), w kolejności \link ReturnCompleted() \endlink.
+      */
+      const vector <unsigned long> & ReturnCompletedFrames() const;
+      /*!
+         \brief Zwraca numer aktualnej klatki (zwiększany w \link BeginFrame() \endlink ).
+      */
+      unsigned long ReturnFrame() const;
+      /*!
+         \brief Usuwa odczytane klatki.
+      */
+      void ClearCompleted();
+      /*!
+         \brief Usuwa wszystkie zapytania (przed usunięciem kontekstu OpenGL), pomiar zostaje wyłączony.
+      */
+      void Destroy();
+      /*!
+         \brief Zwraca ilość klatek pominiętych, bo ich wyniki nie były gotowe.
+      */
+      int ReturnDropped() const;
+      /*!
+         \brief Zwraca czas GPU (w nanosekundach) zapisany w \link Init() \endlink.
+      */
+      GLint64 ReturnGpuOrigin() const;
+      /*!
+         \brief Zwraca czas CPU (SDL_GetPerformanceCounter) zapisany razem z \link ReturnGpuOrigin() \endlink.
+      */
+      Uint64 ReturnCpuOrigin() const;
+   private:
+      /*!
+         \brief Odczytuje wyniki klatki z podanego miejsca pierścienia.
+
+         \param slot - miejsce w pierścieniu
+         \param wait - TRUE = czekaj na wyniki
+      */
+      void Collect( int slot, bool wait );
+      /*!
+         \brief Po ilu klatkach odczytywane są wyniki. 0 = pomiar wyłączony.
+      */
+      int Latency = 0;
+      /*!
+         \brief Numer aktualnego miejsca w pierścieniu.
+      */
+      int Slot = 0;
+      /*!
+         \brief Zapytania dla każdego miejsca w pierścieniu (tworzone w miarę potrzeby).
+      */
+      vector < vector <GLuint> > Queries;
+      /*!
+         \brief Ilość użytych zapytań dla każdego miejsca w pierścieniu.
+      */
+      vector <unsigned int> Used;
+      /*!
+         \brief Fragmenty (bez czasów) dla każdego miejsca w pierścieniu, fragment i kończy się zapytaniem i + 1.
+      */
+      vector < vector <GpuSection> > Pending;
+      /*!
+         \brief Odczytane klatki.
+      */
+      vector < vector <GpuSection> > Completed;
+      /*!
+         \brief Numer aktualnej klatki.
+      */
+      unsigned long Frame = 0;
+      /*!
+         \brief Numer klatki dla każdego miejsca w pierścieniu.
+      */
+      vector <unsigned long> SlotFrames;
+      /*!
+         \brief Numery odczytanych klatek.
+      */
+      vector <unsigned long> CompletedFrames;
+      /*!
+         \brief Ilość pominiętych klatek.
+      */
+      int Dropped = 0;
+      /*!
+         \brief Czas GPU z \link Init() \endlink.
+      */
+      GLint64 GpuOrigin = 0;
+      /*!
+         \brief Czas CPU z \link Init() \endlink.
+      */
+      Uint64 CpuOrigin = 0;
+};
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+GpuProfiler::GpuProfiler(){
+}
+
+void GpuProfiler::Destroy(){
+   for( unsigned int i = 0; i < this->Queries.size(); ++i ){
+      if( ! this->Queries[i].empty() ){
+         glDeleteQueries( this->Queries[i].size(), &this->Queries[i][0] );
+      }
+   }
+   this->Queries.clear();
+   this->Used.clear();
+   this->Pending.clear();
+   this->SlotFrames.clear();
+   this->Latency = 0;
+}
+
+void GpuProfiler::Init( int latency ){
+   this->Latency = latency;
+   this->Slot = 0;
+   this->Queries.resize( latency );
+   this->Used.assign( latency, 0 );
+   this->Pending.resize( latency );
+   this->SlotFrames.assign( latency, 0 );
+   /*
+      Wspólny punkt czasu CPU i GPU, aby pomiary GPU można było umieścić na osi czasu CPU.
+   */
+   glGetInteger64v( GL_TIMESTAMP, &this->GpuOrigin );
+   this->CpuOrigin = SDL_GetPerformanceCounter();
+}
+
+bool GpuProfiler::IsEnabled() const{
+   return this->Latency > 0;
+}
+
+void GpuProfiler::BeginFrame(){
+   ++this->Frame;
+   if( this->Latency == 0 ){
+      return;
+   }
+   this->Slot = ( this->Slot + 1 ) % this->Latency;
+   /*
+      To miejsce w pierścieniu było użyte Latency klatek temu, wyniki powinny już być gotowe.
+   */
+   this->Collect( this->Slot, false );
+   this->Used[ this->Slot ] = 0;
+   this->Pending[ this->Slot ].clear();
+   this->SlotFrames[ this->Slot ] = this->Frame;
+   this->Mark( NULL );
+}
+
+void GpuProfiler::Mark( const char *name, const string &detail ){
+   if( this->Latency == 0 ){
+      return;
+   }
+   vector <GLuint> &List = this->Queries[ this->Slot ];
+   unsigned int &Count = this->Used[ this->Slot ];
+   if( Count == List.size() ){
+      GLuint Query;
+      glGenQueries( 1, &Query );
+      List.push_back( Query );
+   }
+   glQueryCounter( List[ Count ], GL_TIMESTAMP );
+   ++Count;
+   /*
+      Pierwszy znacznik (NULL) rozpoczyna klatkę i nie kończy żadnego fragmentu.
+   */
+   if( name != NULL ){
+      GpuSection Section;
+      Section.Name = name;
+      Section.Detail = detail;
+      Section.Start = 0;
+      Section.Duration = 0;
+      this->Pending[ this->Slot ].push_back( Section );
+   }
+}
+
+void GpuProfiler::Flush(){
+   if( this->Latency == 0 ){
+      return;
+   }
+   for( int i = 1; i <= this->Latency; ++i ){
+      int Index = ( this->Slot + i ) % this->Latency;
+      this->Collect( Index, true );
+      this->Used[ Index ] = 0;
+      this->Pending[ Index ].clear();
+   }
+}
+
+void GpuProfiler::Collect( int slot, bool wait ){
+   unsigned int Count = this->Used[ slot ];
+   if( Count < 2 ){
+      return;
+   }
+   vector <GLuint> &List = this->Queries[ slot ];
+   /*
+      Zapytania kończą się w kolejności, więc wystarczy sprawdzić ostatnie.
+   */
+   if( ! wait ){
+      GLint Available = 0;
+      glGetQueryObjectiv( List[ Count - 1 ], GL_QUERY_RESULT_AVAILABLE, &Available );
+      if( ! Available ){
+         ++this->Dropped;
+         return;
+      }
+   }
+   vector <GLint64> Times( Count );
+   for( unsigned int i = 0; i < Count; ++i ){
+      glGetQueryObjecti64v( List[i], GL_QUERY_RESULT, &Times[i] );
+   }
+   vector <GpuSection> Frame = this->Pending[ slot ];
+   for( unsigned int i = 0; i < Frame.size(); ++i ){
+      Frame[i].Start = Times[i];
+      Frame[i].Duration = Times[ i + 1 ] - Times[i];
+   }
+   this->Completed.push_back( Frame );
+   this->CompletedFrames.push_back( this->SlotFrames[ slot ] );
+}
+
+const vector < vector <GpuSection> > & GpuProfiler::ReturnCompleted() const{
+   return this->Completed;
+}
+
+const vector <unsigned long> & GpuProfiler::ReturnCompletedFrames() const{
+   return this->CompletedFrames;
+}
+
+unsigned long GpuProfiler::ReturnFrame() const{
+   return this->Frame;
+}
+
+void GpuProfiler::ClearCompleted(){
+   this->Completed.clear();
+   this->CompletedFrames.clear();
+}
+
+int GpuProfiler::ReturnDropped() const{
+   return this->Dropped;
+}
+
+GLint64 GpuProfiler::ReturnGpuOrigin() const{
+   return this->GpuOrigin;
+}
+
+Uint64 GpuProfiler::ReturnCpuOrigin() const{
+   return this->CpuOrigin;
+}
+
+#endif
@@ -4,10 +4,26 @@
 */
 #include <iostream>
 #include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cstddef>
 #include <string>
 #include <vector>
+#include <deque>
+#include <map>
+#include <unordered_map>
 #include <fstream>
 #include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <future>
 //GLEW:
 #define GLEW_STATIC
 #include <GL/glew.h>
@@ -20,6 +36,7 @@
 #include <glm/gtx/transform.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/packing.hpp>
 #include <glm/detail/setup.hpp>
 #if GLM_VERSION >= 96
    #include <glm/gtc/vec1.hpp>
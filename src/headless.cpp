@@ -0,0 +1,245 @@
+/*!
+   \file headless.cpp
+   \brief Plik odpowiedzialny za renderowanie bez okna (tryb headless).
+*/
+#ifndef __headless_hpp__
+#define __headless_hpp__
+
+#ifndef _WIN32
+   #include <EGL/egl.h>
+   #include <EGL/eglext.h>
+#endif
+
+/*!
+   \brief Klasa odpowiedzialna za kontekst OpenGL bez okna oraz bufor ramki (FBO), do którego rysowana jest scena.
+
+   Kontekst tworzony jest przez EGL (platforma surfaceless z Mesa, np. llvmpipe), więc nie jest potrzebny ani ekran, ani karta graficzna.
+*/
+class Headless{
+   public:
+      /*!
+         \brief Konstruktor domyślny.
+      */
+      Headless();
+      /*!
+         \brief Destruktor.
+
+         Usuwa bufor ramki oraz kontekst EGL.
+      */
+      ~Headless();
+      /*!
+         \brief Tworzy kontekst OpenGL 3.3 (Core) bez okna i ustawia go jako aktualny.
+
+         \return - wartość logiczną dla tworzenia kontekstu, FALSE = błąd
+      */
+      bool CreateContext();
+      /*!
+         \brief Tworzy bufor ramki (FBO) o podanej wielkości i ustawia go jako cel rysowania.
+
+         \param width - szerokość bufora ramki
+         \param height - wysokość bufora ramki
+         \return - wartość logiczną dla tworzenia bufora ramki, FALSE = błąd
+
+         Wymaga wcześniejszego wywołania \link CreateContext() \endlink oraz zainicjalizowania GLEW.
+      */
+      bool CreateFramebuffer( int width, int height );
+      /*!
+         \brief Zapisuje zawartość bufora ramki do pliku .ppm (P6).
+
+         \param file - ścieżka do pliku wyjściowego
+         \return - wartość logiczną dla zapisu pliku, FALSE = błąd
+      */
+      bool SavePPM( string file );
+   private:
+      /*!
+         \brief Szerokość bufora ramki.
+      */
+      int Width = 0;
+      /*!
+         \brief Wysokość bufora ramki.
+      */
+      int Height = 0;
+      /*!
+         \brief Identyfikator bufora ramki (FBO).
+      */
+      GLuint Framebuffer = 0;
+      /*!
+         \brief Identyfikator bufora koloru.
+      */
+      GLuint ColorBuffer = 0;
+      /*!
+         \brief Identyfikator bufora głębokości.
+      */
+      GLuint DepthBuffer = 0;
+#ifndef _WIN32
+      /*!
+         \brief Wyświetlacz EGL.
+      */
+      EGLDisplay Display = EGL_NO_DISPLAY;
+      /*!
+         \brief Kontekst EGL.
+      */
+      EGLContext Context = EGL_NO_CONTEXT;
+      /*!
+         \brief Powierzchnia EGL (tylko gdy sterownik nie wspiera kontekstu bez powierzchni).
+      */
+      EGLSurface Surface = EGL_NO_SURFACE;
+#endif
+};
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+Headless::Headless(){
+}
+
+Headless::~Headless(){
+   if( this->Framebuffer != 0 ){
+      glBindFramebuffer( GL_FRAMEBUFFER, 0 );
+      glDeleteFramebuffers( 1, &this->Framebuffer );
+      glDeleteRenderbuffers( 1, &this->ColorBuffer );
+      glDeleteRenderbuffers( 1, &this->DepthBuffer );
+   }
+#ifndef _WIN32
+   if( this->Display != EGL_NO_DISPLAY ){
+      eglMakeCurrent( this->Display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT );
+      if( this->Surface != EGL_NO_SURFACE ){
+         eglDestroySurface( this->Display, this->Surface );
+      }
+      if( this->Context != EGL_NO_CONTEXT ){
+         eglDestroyContext( this->Display, this->Context );
+      }
+      eglTerminate( this->Display );
+   }
+#endif
+}
+
+bool Headless::CreateContext(){
+#ifdef _WIN32
+   cout<<"Headless: EGL is not supported on Windows\n";
+   return false;
+#else
+   /*
+      Wyświetlacz bez okna (surfaceless) z Mesa, a gdy jest niedostępny to domyślny wyświetlacz EGL.
+   */
+   PFNEGLGETPLATFORMDISPLAYEXTPROC GetPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress( "eglGetPlatformDisplayEXT" );
+   if( GetPlatformDisplay != NULL ){
+      this->Display = GetPlatformDisplay( EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL );
+   }
+   if( this->Display == EGL_NO_DISPLAY ){
+      this->Display = eglGetDisplay( EGL_DEFAULT_DISPLAY );
+   }
+   EGLint major, minor;
+   if( this->Display == EGL_NO_DISPLAY or ! eglInitialize( this->Display, &major, &minor ) ){
+      cout<<"eglInitialize: "<<eglGetError()<<"\n";
+      this->Display = EGL_NO_DISPLAY;
+      return false;
+   }
+   /*
+      Pełny OpenGL (nie OpenGL ES).
+   */
+   if( ! eglBindAPI( EGL_OPENGL_API ) ){
+      cout<<"eglBindAPI: "<<eglGetError()<<"\n";
+      return false;
+   }
+   EGLint ConfigAttributes[] = {
+      EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+      EGL_NONE
+   };
+   EGLConfig Config;
+   EGLint ConfigCount = 0;
+   if( ! eglChooseConfig( this->Display, ConfigAttributes, &Config, 1, &ConfigCount ) or ConfigCount == 0 ){
+      cout<<"eglChooseConfig: "<<eglGetError()<<"\n";
+      return false;
+   }
+   /*
+      Tak samo jak dla okna: OpenGL 3.3, profil Core.
+   */
+   EGLint ContextAttributes[] = {
+      EGL_CONTEXT_MAJOR_VERSION, 3,
+      EGL_CONTEXT_MINOR_VERSION, 3,
+      EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+      EGL_NONE
+   };
+   this->Context = eglCreateContext( this->Display, Config, EGL_NO_CONTEXT, ContextAttributes );
+   if( this->Context == EGL_NO_CONTEXT ){
+      cout<<"eglCreateContext: "<<eglGetError()<<"\n";
+      return false;
+   }
+   /*
+      Kontekst bez powierzchni (EGL_KHR_surfaceless_context), w przeciwnym wypadku mała powierzchnia pbuffer.
+      Rysowanie i tak odbywa się do bufora ramki (FBO).
+   */
+   if( ! eglMakeCurrent( this->Display, EGL_NO_SURFACE, EGL_NO_SURFACE, this->Context ) ){
+      EGLint SurfaceAttributes[] = {
+         EGL_WIDTH, 1,
+         EGL_HEIGHT, 1,
+         EGL_NONE
+      };
+      this->Surface = eglCreatePbufferSurface( this->Display, Config, SurfaceAttributes );
+      if( this->Surface == EGL_NO_SURFACE or ! eglMakeCurrent( this->Display, this->Surface, this->Surface, this->Context ) ){
+         cout<<"eglMakeCurrent: "<<eglGetError()<<"\n";
+         return false;
+      }
+   }
+   return true;
+#endif
+}
+
+bool Headless::CreateFramebuffer( int width, int height ){
+   this->Width = width;
+   this->Height = height;
+   /*
+      Bufor koloru i bufor głębokości.
+   */
+   glGenRenderbuffers( 1, &this->ColorBuffer );
+   glBindRenderbuffer( GL_RENDERBUFFER, this->ColorBuffer );
+   glRenderbufferStorage( GL_RENDERBUFFER, GL_RGBA8, this->Width, this->Height );
+   glGenRenderbuffers( 1, &this->DepthBuffer );
+   glBindRenderbuffer( GL_RENDERBUFFER, this->DepthBuffer );
+   glRenderbufferStorage( GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, this->Width, this->Height );
+   glBindRenderbuffer( GL_RENDERBUFFER, 0 );
+   /*
+      Bufor ramki z dołączonymi buforami koloru i głębokości.
+   */
+   glGenFramebuffers( 1, &this->Framebuffer );
+   glBindFramebuffer( GL_FRAMEBUFFER, this->Framebuffer );
+   glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->ColorBuffer );
+   glFramebufferRenderbuffer( GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->DepthBuffer );
+   GLenum Status = glCheckFramebufferStatus( GL_FRAMEBUFFER );
+   if( Status != GL_FRAMEBUFFER_COMPLETE ){
+      cout<<"glCheckFramebufferStatus: "<<Status<<"\n";
+      return false;
+   }
+   /*
+      Bufor ramki zostaje przypięty na stałe, cała scena rysowana jest do niego.
+   */
+   glViewport( 0, 0, this->Width, this->Height );
+   return true;
+}
+
+bool Headless::SavePPM( string file ){
+   vector <unsigned char> Pixels( this->Width * this->Height * 3 );
+   glPixelStorei( GL_PACK_ALIGNMENT, 1 );
+   glReadPixels( 0, 0, this->Width, this->Height, GL_RGB, GL_UNSIGNED_BYTE, &Pixels[0] );
+   fstream output;
+   output.open( file.c_str(), ios::out | ios::binary );
+   if( ! output.good() ){
+      cout<<"File error: "<<file<<"\n";
+      return false;
+   }
+   output<<"P6\n"<<this->Width<<" "<<this->Height<<"\n255\n";
+   /*
+      OpenGL zwraca wiersze od dołu, a PPM zapisuje je od góry.
+   */
+   for( int row = this->Height - 1; row >= 0; --row ){
+      output.write( (const char *)&Pixels[ row * this->Width * 3 ], this->Width * 3 );
+   }
+   output.close();
+   return true;
+}
+
+#endif
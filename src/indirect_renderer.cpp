@@ -0,0 +1,441 @@
+/*!
+   \file indirect_renderer.cpp
+   \brief Plik odpowiedzialny za rysowanie wszystkich obiektów przez glMultiDrawElementsIndirect.
+*/
+#ifndef __indirect_renderer_hpp__
+#define __indirect_renderer_hpp__
+
+/*!
+   \brief Ilość texeli (vec4) danych jednego obiektu w buforze tekstury: 4 kolumny macierzy model-widok-projekcja, 4 kolumny macierzy modelu,
+   3 kolumny macierzy normalnych, skala i przesunięcie pozycji.
+*/
+#define INDIRECT_OBJECT_TEXELS 13
+
+/*!
+   \brief Jednostka tekstury dla bufora danych obiektów (0 i 1 to tekstury materiału).
+*/
+#define INDIRECT_OBJECT_UNIT 2
+
+/*!
+   \brief Polecenie rysowania w buforze GL_DRAW_INDIRECT_BUFFER (układ wymagany przez OpenGL).
+*/
+struct DrawElementsIndirectCommand{
+   /*!
+      \brief Ilość indeksów.
+   */
+   GLuint Count;
+   /*!
+      \brief Ilość instancji obiektu.
+   */
+   GLuint InstanceCount;
+   /*!
+      \brief Pierwszy indeks (w indeksach, nie w bajtach).
+   */
+   GLuint FirstIndex;
+   /*!
+      \brief Pierwszy wierzchołek.
+   */
+   GLint BaseVertex;
+   /*!
+      \brief Numer pierwszej instancji obiektu w buforze danych obiektów (odczytywany przez atrybut z dzielnikiem 1).
+   */
+   GLuint BaseInstance;
+};
+
+/*!
+   \brief Polecenie rysowania razem ze stanem, od którego zależy podział na wywołania.
+*/
+struct IndirectDraw{
+   /*!
+      \brief Typ indeksów: GL_UNSIGNED_INT lub GL_UNSIGNED_SHORT.
+   */
+   GLenum IndexType;
+   /*!
+      \brief Identyfikator głównej tekstury.
+   */
+   GLuint Texture;
+   /*!
+      \brief Identyfikator spektralnej tekstury.
+   */
+   GLuint TextureSpecular;
+   /*!
+      \brief Zapytanie o zasłonięcie dla glBeginConditionalRender ( \link OcclusionCuller::ReturnConditional() \endlink ), 0 = rysowanie bez warunku.
+   */
+   GLuint Query;
+   /*!
+      \brief Polecenie rysowania.
+   */
+   DrawElementsIndirectCommand Command;
+};
+
+/*!
+   \brief Klasa odpowiedzialna za rysowanie wszystkich obiektów z bufora poleceń (glMultiDrawElementsIndirect).
+
+   Macierze model-widok-projekcja, modelu i normalnych (każdej instancji, liczone na CPU) i kwantyzacja pozycji wszystkich obiektów trafiają raz na klatkę do bufora tekstury (samplerBuffer ObjectData),
+   shader odczytuje je według numeru obiektu z atrybutu 3 (BaseInstance polecenia, shader kompilowany z "#define INDIRECT").
+   Polecenia są sortowane według tekstur i typu indeksów, jedno wywołanie rysuje wszystkie części z tymi samymi teksturami.
+   Bez ARB_multi_draw_indirect i ARB_base_instance każde polecenie rysowane jest przez glDrawElementsBaseVertex,
+   a numer obiektu przekazywany jest jako stała wartość atrybutu 3 (bez macierzy i tekstur dla każdego obiektu).\n
+   Polecenia zasłoniętej instancji z niegotowym wynikiem zapytania rysowane są osobnymi wywołaniami wewnątrz glBeginConditionalRender.
+*/
+class IndirectRenderer{
+   public:
+      /*!
+         \brief Konstruktor domyślny.
+      */
+      IndirectRenderer();
+      /*!
+         \brief Tworzy bufory i ustala jednostkę tekstury dla danych obiektów.
+
+         \param program - program shaderów skompilowany z "#define INDIRECT"
+      */
+      void Init( GLuint program );
+      /*!
+         \brief Rysuje wszystkie wczytane obiekty.
+
+         \param items - obiekty
+         \param view_projection - iloczyn macierzy projekcji i widoku kamery
+         \param culler - widoczność instancji (po \link FrustumCuller::Cull() \endlink )
+         \param lods - poziom szczegółowości instancji (po \link LodSelector::Select() \endlink )
+         \param clusters - widoczne grupy trójkątów (po \link ClusterCuller::Cull() \endlink ), polecenie na każdy zakres grup
+         \param occlusion - instancje rysowane warunkowo (po \link OcclusionCuller::Filter() \endlink )
+         \param stats - liczniki klatki (wywołania rysowania i trójkąty)
+
+         Wymaga użytego programu shaderów.
+      */
+      void Draw( const vector <Mesh> &items, const mat4 &view_projection, const FrustumCuller &culler, const LodSelector &lods, const ClusterCuller &clusters, const OcclusionCuller &occlusion, FrameStats &stats );
+      /*!
+         \brief Usuwa bufory (przed usunięciem kontekstu OpenGL).
+      */
+      void Destroy();
+      /*!
+         \brief Zwraca TRUE, gdy polecenia rysowane są przez glMultiDrawElementsIndirect.
+      */
+      bool IsMultiDraw() const;
+   private:
+      /*!
+         \brief Dodaje dane instancji obiektu do \link Objects \endlink.
+
+         \param item - obiekt
+         \param instance - numer instancji
+         \param view_projection - iloczyn macierzy projekcji i widoku kamery
+      */
+      void AddObject( const Mesh &item, GLsizei instance, const mat4 &view_projection );
+      /*!
+         \brief TRUE = glMultiDrawElementsIndirect, FALSE = glDrawElementsBaseVertex dla każdego polecenia.
+      */
+      bool MultiDraw = false;
+      /*!
+         \brief Bufor danych obiektów.
+      */
+      GLuint ObjectBuffer = 0;
+      /*!
+         \brief Tekstura (GL_TEXTURE_BUFFER, GL_RGBA32F) dla \link ObjectBuffer \endlink.
+      */
+      GLuint ObjectTexture = 0;
+      /*!
+         \brief Bufor poleceń rysowania (GL_DRAW_INDIRECT_BUFFER).
+      */
+      GLuint CommandBuffer = 0;
+      /*!
+         \brief Bufor kolejnych numerów (0, 1, 2, ...) dla atrybutu 3 z dzielnikiem 1.
+      */
+      GLuint DrawIDBuffer = 0;
+      /*!
+         \brief Ilość numerów w \link DrawIDBuffer \endlink.
+      */
+      GLuint DrawIDCount = 0;
+      /*!
+         \brief Dane obiektów aktualnej klatki.
+      */
+      vector <vec4> Objects;
+      /*!
+         \brief Polecenia rysowania aktualnej klatki.
+      */
+      vector <IndirectDraw> Draws;
+      /*!
+         \brief Polecenia rysowania aktualnej klatki w kolejności \link Draws \endlink (dla bufora poleceń).
+      */
+      vector <DrawElementsIndirectCommand> Commands;
+};
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+IndirectRenderer::IndirectRenderer(){
+}
+
+void IndirectRenderer::Init( GLuint program ){
+   this->MultiDraw = GLEW_ARB_multi_draw_indirect and GLEW_ARB_base_instance;
+   glGenBuffers( 1, &this->ObjectBuffer );
+   glGenBuffers( 1, &this->CommandBuffer );
+   glGenBuffers( 1, &this->DrawIDBuffer );
+   /*
+      Tekstura odczytuje bufor danych obiektów, bufor może zmieniać wielkość.
+   */
+   glBindBuffer( GL_TEXTURE_BUFFER, this->ObjectBuffer );
+   glBufferData( GL_TEXTURE_BUFFER, sizeof( vec4 ) * INDIRECT_OBJECT_TEXELS, NULL, GL_STREAM_DRAW );
+   glGenTextures( 1, &this->ObjectTexture );
+   glBindTexture( GL_TEXTURE_BUFFER, this->ObjectTexture );
+   glTexBuffer( GL_TEXTURE_BUFFER, GL_RGBA32F, this->ObjectBuffer );
+   glBindTexture( GL_TEXTURE_BUFFER, 0 );
+   glBindBuffer( GL_TEXTURE_BUFFER, 0 );
+   glUseProgram( program );
+   glUniform1i( glGetUniformLocation( program, "ObjectData" ), INDIRECT_OBJECT_UNIT );
+   glUseProgram( 0 );
+   cout<<"Indirect: "<<( this->MultiDraw ? "glMultiDrawElementsIndirect" : "glDrawElementsBaseVertex (no ARB_multi_draw_indirect)" )<<"\n";
+}
+
+void IndirectRenderer::Draw( const vector <Mesh> &items, const mat4 &view_projection, const FrustumCuller &culler, const LodSelector &lods, const ClusterCuller &clusters, const OcclusionCuller &occlusion, FrameStats &stats ){
+   PROFILE_SCOPE( "IndirectRenderer::Draw" );
+   this->Objects.clear();
+   this->Draws.clear();
+   /*
+      Dane obiektów i polecenia dla wszystkich części.
+   */
+   GLuint Object = 0;
+   for( unsigned int i = 0; i < items.size(); ++i ){
+      const Mesh &Item = items[i];
+      if( ! Item.IsLoaded() or Item.ReturnGeometry() == 0 or culler.ReturnVisibleCount( i ) == 0 ){
+         continue;
+      }
+      GLuint IndexSize = ( Item.ReturnIndexType() == GL_UNSIGNED_SHORT ) ? sizeof( uint16_t ) : sizeof( GLuint );
+      GLuint FirstIndex = GeometryArena::ReturnIndexOffset( Item.ReturnGeometry() ) / IndexSize;
+      GLint BaseVertex = GeometryArena::ReturnBaseVertex( Item.ReturnGeometry() );
+      const vector <MeshPart> &Parts = Item.ReturnParts();
+      const vector <MeshLod> &Lods = Item.ReturnLods();
+      GLuint LastLod = Lods.size() - 1;
+      /*
+         Widoczne instancje obiektu z tym samym poziomem szczegółowości to kolejne obiekty w buforze, polecenie rysuje je wszystkie (InstanceCount).
+      */
+      for( GLuint Level = 0; Level <= LastLod; ++Level ){
+         GLsizei Instances = 0;
+         for( GLsizei k = 0; k < Item.ReturnInstanceCount(); ++k ){
+            if( ! culler.IsVisible( i, k ) or std::min( lods.ReturnLevel( i, k ), LastLod ) != Level ){
+               continue;
+            }
+            this->AddObject( Item, k, view_projection );
+            ++Instances;
+         }
+         if( Instances == 0 ){
+            continue;
+         }
+         /*
+            Obiekt z grupami (jedna instancja, poziom 0): polecenie na każdy zakres widocznych grup części.
+         */
+         if( clusters.IsActive( i ) ){
+            for( GLuint j = 0; j < Lods[0].PartCount; ++j ){
+               const ClusterRanges &Ranges = clusters.ReturnRanges( i, j );
+               for( unsigned int k = 0; k < Ranges.Counts.size(); ++k ){
+                  IndirectDraw Draw;
+                  Draw.IndexType = Item.ReturnIndexType();
+                  Draw.Texture = Item.ReturnTexture( Parts[j].Material );
+                  Draw.TextureSpecular = Item.ReturnTextureSpecular( Parts[j].Material );
+                  Draw.Query = 0;
+                  Draw.Command.Count = Ranges.Counts[k];
+                  Draw.Command.InstanceCount = 1;
+                  Draw.Command.FirstIndex = FirstIndex + Ranges.FirstIndices[k];
+                  Draw.Command.BaseVertex = Ranges.BaseVertices[k];
+                  Draw.Command.BaseInstance = Object;
+                  this->Draws.push_back( Draw );
+               }
+               stats.Add( COUNTER_TRIANGLES, Ranges.Triangles );
+            }
+            stats.Add( COUNTER_INSTANCES, Instances );
+            Object += Instances;
+            continue;
+         }
+         for( GLuint j = Lods[ Level ].FirstPart; j < Lods[ Level ].FirstPart + Lods[ Level ].PartCount; ++j ){
+            if( Parts[j].IndexCount == 0 ){
+               continue;
+            }
+            IndirectDraw Draw;
+            Draw.IndexType = Item.ReturnIndexType();
+            Draw.Texture = Item.ReturnTexture( Parts[j].Material );
+            Draw.TextureSpecular = Item.ReturnTextureSpecular( Parts[j].Material );
+            Draw.Query = 0;
+            Draw.Command.Count = Parts[j].IndexCount;
+            Draw.Command.InstanceCount = Instances;
+            Draw.Command.FirstIndex = FirstIndex + Parts[j].FirstIndex;
+            Draw.Command.BaseVertex = BaseVertex + Parts[j].BaseVertex;
+            Draw.Command.BaseInstance = Object;
+            this->Draws.push_back( Draw );
+         }
+         stats.Add( COUNTER_TRIANGLES, Item.ReturnTriangles( Level ) * Instances );
+         stats.Add( COUNTER_INSTANCES, Instances );
+         Object += Instances;
+      }
+   }
+   /*
+      Ukryte instancje z niegotowym wynikiem zapytania: całe części poziomu z ostatniej klatki, w której instancja była widoczna, z zapytaniem.
+   */
+   const vector <BVHHit> &Conditional = occlusion.ReturnConditional();
+   for( unsigned int i = 0; i < Conditional.size(); ++i ){
+      const Mesh &Item = items[ Conditional[i].Item ];
+      if( ! Item.IsLoaded() or Item.ReturnGeometry() == 0 ){
+         continue;
+      }
+      GLuint IndexSize = ( Item.ReturnIndexType() == GL_UNSIGNED_SHORT ) ? sizeof( uint16_t ) : sizeof( GLuint );
+      GLuint FirstIndex = GeometryArena::ReturnIndexOffset( Item.ReturnGeometry() ) / IndexSize;
+      GLint BaseVertex = GeometryArena::ReturnBaseVertex( Item.ReturnGeometry() );
+      const vector <MeshPart> &Parts = Item.ReturnParts();
+      const vector <MeshLod> &Lods = Item.ReturnLods();
+      GLuint Level = std::min( lods.ReturnLevel( Conditional[i].Item, Conditional[i].Instance ), (GLuint)Lods.size() - 1 );
+      this->AddObject( Item, Conditional[i].Instance, view_projection );
+      for( GLuint j = Lods[ Level ].FirstPart; j < Lods[ Level ].FirstPart + Lods[ Level ].PartCount; ++j ){
+         if( Parts[j].IndexCount == 0 ){
+            continue;
+         }
+         IndirectDraw Draw;
+         Draw.IndexType = Item.ReturnIndexType();
+         Draw.Texture = Item.ReturnTexture( Parts[j].Material );
+         Draw.TextureSpecular = Item.ReturnTextureSpecular( Parts[j].Material );
+         Draw.Query = occlusion.ReturnQuery( Conditional[i].Item, Conditional[i].Instance );
+         Draw.Command.Count = Parts[j].IndexCount;
+         Draw.Command.InstanceCount = 1;
+         Draw.Command.FirstIndex = FirstIndex + Parts[j].FirstIndex;
+         Draw.Command.BaseVertex = BaseVertex + Parts[j].BaseVertex;
+         Draw.Command.BaseInstance = Object;
+         this->Draws.push_back( Draw );
+      }
+      stats.Add( COUNTER_TRIANGLES, Item.ReturnTriangles( Level ) );
+      stats.Add( COUNTER_INSTANCES, 1 );
+      ++Object;
+   }
+   if( this->Draws.empty() ){
+      return;
+   }
+   /*
+      Polecenia bez warunku, potem polecenia każdego zapytania, w nich te same tekstury i typ indeksów obok siebie.
+   */
+   stable_sort( this->Draws.begin(), this->Draws.end(), []( const IndirectDraw &a, const IndirectDraw &b ){
+      if( a.Query != b.Query ){
+         return a.Query < b.Query;
+      }
+      if( a.Texture != b.Texture ){
+         return a.Texture < b.Texture;
+      }
+      if( a.TextureSpecular != b.TextureSpecular ){
+         return a.TextureSpecular < b.TextureSpecular;
+      }
+      return a.IndexType < b.IndexType;
+   } );
+   /*
+      Dane obiektów (nowy bufor co klatkę, bez czekania na GPU).
+   */
+   glBindBuffer( GL_TEXTURE_BUFFER, this->ObjectBuffer );
+   glBufferData( GL_TEXTURE_BUFFER, this->Objects.size() * sizeof( vec4 ), this->Objects.data(), GL_STREAM_DRAW );
+   glBindBuffer( GL_TEXTURE_BUFFER, 0 );
+   glActiveTexture( GL_TEXTURE0 + INDIRECT_OBJECT_UNIT );
+   glBindTexture( GL_TEXTURE_BUFFER, this->ObjectTexture );
+   GeometryArena::Bind();
+   if( this->MultiDraw ){
+      /*
+         Kolejne numery dla atrybutu 3, BaseInstance polecenia wybiera numer obiektu.
+      */
+      if( Object > this->DrawIDCount ){
+         this->DrawIDCount = std::max( Object, 2 * this->DrawIDCount );
+         vector <GLuint> DrawIDs( this->DrawIDCount );
+         for( GLuint i = 0; i < this->DrawIDCount; ++i ){
+            DrawIDs[i] = i;
+         }
+         glBindBuffer( GL_ARRAY_BUFFER, this->DrawIDBuffer );
+         glBufferData( GL_ARRAY_BUFFER, DrawIDs.size() * sizeof( GLuint ), DrawIDs.data(), GL_STATIC_DRAW );
+      }
+      glBindBuffer( GL_ARRAY_BUFFER, this->DrawIDBuffer );
+      glVertexAttribIPointer( 3, 1, GL_UNSIGNED_INT, 0, (GLvoid *)0 );
+      glVertexAttribDivisor( 3, 1 );
+      glEnableVertexAttribArray( 3 );
+      glBindBuffer( GL_ARRAY_BUFFER, 0 );
+      this->Commands.resize( this->Draws.size() );
+      for( unsigned int i = 0; i < this->Draws.size(); ++i ){
+         this->Commands[i] = this->Draws[i].Command;
+      }
+      glBindBuffer( GL_DRAW_INDIRECT_BUFFER, this->CommandBuffer );
+      glBufferData( GL_DRAW_INDIRECT_BUFFER, this->Commands.size() * sizeof( DrawElementsIndirectCommand ), this->Commands.data(), GL_STREAM_DRAW );
+   }
+   else{
+      glDisableVertexAttribArray( 3 );
+   }
+   /*
+      Jedno wywołanie na grupę poleceń z tymi samymi teksturami (i tym samym zapytaniem).
+   */
+   for( unsigned int Begin = 0, End = 0; Begin < this->Draws.size(); Begin = End ){
+      const IndirectDraw &First = this->Draws[ Begin ];
+      End = Begin + 1;
+      while( End < this->Draws.size() and this->Draws[ End ].Texture == First.Texture and this->Draws[ End ].TextureSpecular == First.TextureSpecular
+             and this->Draws[ End ].IndexType == First.IndexType and this->Draws[ End ].Query == First.Query ){
+         ++End;
+      }
+      glActiveTexture( GL_TEXTURE0 );
+      glBindTexture( GL_TEXTURE_2D, First.Texture );
+      glActiveTexture( GL_TEXTURE1 );
+      glBindTexture( GL_TEXTURE_2D, First.TextureSpecular );
+      /*
+         Zapytanie wysłane w jednej z poprzednich klatek jest już zakończone na GPU, CPU nie czeka na wynik.
+      */
+      if( First.Query != 0 ){
+         glBeginConditionalRender( First.Query, GL_QUERY_WAIT );
+      }
+      if( this->MultiDraw ){
+         glMultiDrawElementsIndirect( GL_TRIANGLES, First.IndexType, (GLvoid *)( Begin * sizeof( DrawElementsIndirectCommand ) ), End - Begin, 0 );
+         stats.Add( COUNTER_DRAWS, 1 );
+         if( First.Query != 0 ){
+            glEndConditionalRender();
+         }
+         continue;
+      }
+      GLuint IndexSize = ( First.IndexType == GL_UNSIGNED_SHORT ) ? sizeof( uint16_t ) : sizeof( GLuint );
+      /*
+         Bez BaseInstance każda instancja osobno.
+      */
+      for( unsigned int i = Begin; i < End; ++i ){
+         const DrawElementsIndirectCommand &Command = this->Draws[i].Command;
+         for( GLuint k = 0; k < Command.InstanceCount; ++k ){
+            glVertexAttribI1ui( 3, Command.BaseInstance + k );
+            glDrawElementsBaseVertex( GL_TRIANGLES, Command.Count, First.IndexType, (GLvoid *)( (GLintptr)Command.FirstIndex * IndexSize ), Command.BaseVertex );
+            stats.Add( COUNTER_DRAWS, 1 );
+         }
+      }
+      if( First.Query != 0 ){
+         glEndConditionalRender();
+      }
+   }
+   if( this->MultiDraw ){
+      glBindBuffer( GL_DRAW_INDIRECT_BUFFER, 0 );
+   }
+}
+
+void IndirectRenderer::AddObject( const Mesh &item, GLsizei instance, const mat4 &view_projection ){
+   mat4 Model = item.ReturnInstanceMatrix( instance );
+   mat4 ModelViewProjection = view_projection * Model;
+   mat3 Normal = item.ReturnInstanceNormalMatrix( instance );
+   for( int j = 0; j < 4; ++j ){
+      this->Objects.push_back( ModelViewProjection[j] );
+   }
+   for( int j = 0; j < 4; ++j ){
+      this->Objects.push_back( Model[j] );
+   }
+   for( int j = 0; j < 3; ++j ){
+      this->Objects.push_back( vec4( Normal[j], 0.0f ) );
+   }
+   this->Objects.push_back( vec4( item.ReturnQuantization().Scale, 0.0f ) );
+   this->Objects.push_back( vec4( item.ReturnQuantization().Offset, 0.0f ) );
+}
+
+void IndirectRenderer::Destroy(){
+   glDeleteTextures( 1, &this->ObjectTexture );
+   glDeleteBuffers( 1, &this->ObjectBuffer );
+   glDeleteBuffers( 1, &this->CommandBuffer );
+   glDeleteBuffers( 1, &this->DrawIDBuffer );
+   this->ObjectTexture = this->ObjectBuffer = this->CommandBuffer = this->DrawIDBuffer = 0;
+}
+
+bool IndirectRenderer::IsMultiDraw() const{
+   return this->MultiDraw;
+}
+
+#endif
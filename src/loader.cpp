@@ -0,0 +1,170 @@
+/*!
+   \file loader.cpp
+   \brief Plik odpowiedzialny za równoległe wczytywanie obiektów 3D.
+*/
+#ifndef __loader_hpp__
+#define __loader_hpp__
+
+/*!
+   \brief Klasa odpowiedzialna za wczytywanie wszystkich obiektów z użyciem puli wątków.
+
+   Część CPU ( \link Mesh::LoadCPU() \endlink ) wykonywana jest w wątkach roboczych, a gotowe obiekty trafiają do kolejki.\n
+   Wątek główny (z kontekstem OpenGL) pobiera obiekty z kolejki i wykonuje \link Mesh::LoadGPU() \endlink:
+   w każdej klatce przez \link Pump() \endlink (w ramach budżetu czasu) albo od razu wszystkie przez \link Finish() \endlink.
+*/
+class Loader{
+   public:
+      /*!
+         \brief Konstruktor domyślny.
+      */
+      Loader();
+      /*!
+         \brief Dodaje do puli wątków wczytywanie wszystkich obiektów.
+
+         \param pool - pula wątków
+         \param items - wektor obiektów, nie może zmieniać wielkości do zakończenia wczytywania
+      */
+      void Start( ThreadPool &pool, vector <Mesh> &items );
+      /*!
+         \brief Przekazuje do OpenGL gotowe obiekty, wywoływane raz na klatkę.
+
+         \param uploader - bufory pikseli dla tekstur
+         \param budget - budżet czasu w milisekundach, po jego przekroczeniu obiekt jest dokończony w kolejnej klatce (sprawdzany przed każdą teksturą)
+         \return - ilość obiektów przekazanych w tej klatce
+
+         Nie czeka na wątki robocze, gdy brak gotowych obiektów lub wolnych buforów pikseli, kończy się od razu.
+      */
+      unsigned int Pump( TextureUploader *uploader, double budget );
+      /*!
+         \brief Czeka na wszystkie obiekty i przekazuje je do OpenGL (w kolejności zakończenia wczytywania).
+
+         Wywoływać tylko w wątku z kontekstem OpenGL.
+      */
+      void Finish();
+      /*!
+         \brief Zwraca TRUE, gdy wszystkie obiekty zostały przekazane do OpenGL.
+      */
+      bool IsFinished() const;
+   private:
+      /*!
+         \brief Zwiększa licznik przekazanych obiektów, po ostatnim obiekcie wypisuje podsumowanie tekstur.
+      */
+      void ItemUploaded();
+      /*!
+         \brief Wczytywane obiekty.
+      */
+      vector <Mesh> *Items = NULL;
+      /*!
+         \brief Numery obiektów wczytanych przez CPU, czekających na przekazanie do OpenGL.
+      */
+      deque <unsigned int> Ready;
+      /*!
+         \brief Ilość obiektów przekazanych do OpenGL.
+      */
+      unsigned int Uploaded = 0;
+      /*!
+         \brief Numer obiektu częściowo przekazanego do OpenGL (czeka na wolny bufor pikseli). -1 = brak.
+      */
+      int Current = -1;
+      /*!
+         \brief Blokada dla kolejki \link Ready \endlink.
+      */
+      mutex Lock;
+      /*!
+         \brief Sygnał nowego obiektu w kolejce \link Ready \endlink.
+      */
+      condition_variable ItemReady;
+};
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+Loader::Loader(){
+}
+
+void Loader::Start( ThreadPool &pool, vector <Mesh> &items ){
+   this->Items = &items;
+   this->Uploaded = 0;
+   this->Current = -1;
+   this->Ready.clear();
+   for( unsigned int i = 0; i < items.size(); ++i ){
+      pool.Add( [ this, i ](){
+         ( *this->Items )[i].LoadCPU();
+         {
+            lock_guard <mutex> Guard( this->Lock );
+            this->Ready.push_back( i );
+         }
+         this->ItemReady.notify_one();
+      } );
+   }
+}
+
+unsigned int Loader::Pump( TextureUploader *uploader, double budget ){
+   if( this->IsFinished() ){
+      return 0;
+   }
+   PROFILE_SCOPE( "Loader::Pump" );
+   double Frequency = SDL_GetPerformanceFrequency();
+   Uint64 Start = SDL_GetPerformanceCounter();
+   Uint64 Deadline = Start + (Uint64)( budget * Frequency / 1000.0 );
+   unsigned int Count = 0;
+   while( ! this->IsFinished() ){
+      if( this->Current < 0 ){
+         lock_guard <mutex> Guard( this->Lock );
+         if( this->Ready.empty() ){
+            break;
+         }
+         this->Current = this->Ready.front();
+         this->Ready.pop_front();
+      }
+      /*
+         Brak wolnego bufora pikseli lub koniec budżetu (sprawdzany także pomiędzy teksturami obiektu), obiekt dokończony zostanie w kolejnej klatce.
+      */
+      if( ! ( *this->Items )[ this->Current ].LoadGPU( uploader, Deadline ) ){
+         break;
+      }
+      this->Current = -1;
+      this->ItemUploaded();
+      ++Count;
+      if( SDL_GetPerformanceCounter() >= Deadline ){
+         break;
+      }
+   }
+   return Count;
+}
+
+void Loader::Finish(){
+   PROFILE_SCOPE( "Loader::Finish" );
+   while( ! this->IsFinished() ){
+      if( this->Current < 0 ){
+         unique_lock <mutex> Guard( this->Lock );
+         while( this->Ready.empty() ){
+            this->ItemReady.wait( Guard );
+         }
+         this->Current = this->Ready.front();
+         this->Ready.pop_front();
+      }
+      /*
+         Błędy wczytywania wypisuje sam obiekt, obiekt z błędem nie jest rysowany.
+      */
+      ( *this->Items )[ this->Current ].LoadGPU();
+      this->Current = -1;
+      this->ItemUploaded();
+   }
+}
+
+void Loader::ItemUploaded(){
+   ++this->Uploaded;
+   if( this->IsFinished() ){
+      cout<<"Textures: "<<TextureCache::ReturnTextures()<<" (shared: "<<TextureCache::ReturnShared()<<").\n";
+   }
+}
+
+bool Loader::IsFinished() const{
+   return this->Items == NULL or this->Uploaded >= this->Items->size();
+}
+
+#endif
@@ -0,0 +1,152 @@
+/*!
+   \file lod_selector.cpp
+   \brief Plik odpowiedzialny za wybór poziomu szczegółowości (LOD) każdej instancji według wielkości na ekranie.
+*/
+#ifndef __lod_selector_hpp__
+#define __lod_selector_hpp__
+
+/*!
+   \brief Względna szerokość pasa histerezy: poziom zmienia się na prostszy dopiero przy błędzie poniżej progu * ( 1 - wartość ),
+   na dokładniejszy przy błędzie powyżej progu * ( 1 + wartość ).
+*/
+#define LOD_SELECTOR_HYSTERESIS 0.25f
+
+/*!
+   \brief Klasa odpowiedzialna za wybór poziomu szczegółowości każdej widocznej instancji.
+
+   Błąd poziomu ( \link MeshLod::Error \endlink, we współrzędnych obiektu) przeliczany jest na piksele:
+   skala instancji (promień sfery w świecie / promień sfery obiektu) * wysokość ekranu / ( 2 * tan( pole widzenia / 2 ) ) / odległość od sfery.
+   Wybierany jest najprostszy poziom z błędem nie większym niż \link Threshold \endlink pikseli, z histerezą \link LOD_SELECTOR_HYSTERESIS \endlink
+   (instancja na granicy nie przełącza się co klatkę).
+*/
+class LodSelector{
+   public:
+      /*!
+         \brief Konstruktor domyślny.
+      */
+      LodSelector();
+      /*!
+         \brief Ustala, czy poziomy są wybierane. FALSE = zawsze poziom 0.
+
+         \param enabled - TRUE = wybór włączony
+      */
+      void SetEnabled( bool enabled );
+      /*!
+         \brief Ustala największy dopuszczalny błąd na ekranie.
+
+         \param threshold - błąd w pikselach
+      */
+      void SetThreshold( GLfloat threshold );
+      /*!
+         \brief Wybiera poziom szczegółowości każdej widocznej instancji (po \link FrustumCuller::Cull() \endlink ).
+
+         \param items - obiekty
+         \param camera - kamera (pozycja i macierz projekcji)
+         \param height - wysokość ekranu w pikselach
+         \param culler - widoczność instancji
+         \param stats - liczniki klatki (zmiany poziomu)
+      */
+      void Select( const vector <Mesh> &items, Camera &camera, int height, const FrustumCuller &culler, FrameStats &stats );
+      /*!
+         \brief Zwraca poziom szczegółowości instancji (po \link Select() \endlink ).
+
+         \param item - numer obiektu
+         \param instance - numer instancji
+      */
+      GLuint ReturnLevel( GLuint item, GLsizei instance ) const;
+   private:
+      /*!
+         \brief TRUE = wybór włączony.
+      */
+      bool Enabled = true;
+      /*!
+         \brief Największy dopuszczalny błąd w pikselach.
+      */
+      GLfloat Threshold = 1.0f;
+      /*!
+         \brief Poziom każdej instancji każdego obiektu (zapamiętany między klatkami dla histerezy).
+      */
+      vector < vector <uint8_t> > Levels;
+};
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+LodSelector::LodSelector(){
+}
+
+void LodSelector::SetEnabled( bool enabled ){
+   this->Enabled = enabled;
+}
+
+void LodSelector::SetThreshold( GLfloat threshold ){
+   this->Threshold = threshold;
+}
+
+void LodSelector::Select( const vector <Mesh> &items, Camera &camera, int height, const FrustumCuller &culler, FrameStats &stats ){
+   PROFILE_SCOPE( "LodSelector::Select" );
+   if( ! this->Enabled ){
+      return;
+   }
+   if( this->Levels.size() < items.size() ){
+      this->Levels.resize( items.size() );
+   }
+   /*
+      Piksele na jednostkę w odległości 1: połowa wysokości ekranu * cot( pole widzenia / 2 ).
+   */
+   GLfloat ProjectionScale = 0.5f * height * camera.ReturnProjectionMatrix()[1][1];
+   vec3 Position = camera.ReturnPosition();
+   GLfloat Coarser = this->Threshold * ( 1.0f - LOD_SELECTOR_HYSTERESIS );
+   GLfloat Finer = this->Threshold * ( 1.0f + LOD_SELECTOR_HYSTERESIS );
+   unsigned long Switches = 0;
+   for( unsigned int i = 0; i < items.size(); ++i ){
+      const Mesh &Item = items[i];
+      const vector <MeshLod> &Lods = Item.ReturnLods();
+      if( culler.ReturnVisibleCount( i ) == 0 or Lods.size() <= 1 ){
+         continue;
+      }
+      vector <uint8_t> &ItemLevels = this->Levels[i];
+      if( ItemLevels.size() < (size_t)Item.ReturnInstanceCount() ){
+         ItemLevels.resize( Item.ReturnInstanceCount(), 0 );
+      }
+      GLfloat Radius = Item.ReturnBounds().Radius;
+      for( GLsizei k = 0; k < Item.ReturnInstanceCount(); ++k ){
+         if( ! culler.IsVisible( i, k ) ){
+            continue;
+         }
+         const MeshBounds &Bounds = Item.ReturnWorldBounds( k );
+         GLfloat Scale = ( Radius > 0.0f ) ? Bounds.Radius / Radius : 1.0f;
+         /*
+            Odległość od sfery (kamera w sferze: bardzo mała odległość, czyli poziom 0).
+         */
+         GLfloat Distance = std::max( length( Bounds.Center - Position ) - Bounds.Radius, 0.001f );
+         GLfloat Pixels = Scale * ProjectionScale / Distance;
+         GLuint Level = std::min( (GLuint)ItemLevels[k], (GLuint)Lods.size() - 1 ), Previous = Level;
+         if( Lods[ Level ].Error * Pixels > Finer ){
+            while( Level > 0 and Lods[ Level ].Error * Pixels > this->Threshold ){
+               --Level;
+            }
+         }
+         else{
+            while( Level + 1 < Lods.size() and Lods[ Level + 1 ].Error * Pixels <= Coarser ){
+               ++Level;
+            }
+         }
+         ItemLevels[k] = Level;
+         Switches += Level != Previous;
+      }
+   }
+   stats.Add( COUNTER_LOD_SWITCHES, Switches );
+}
+
+GLuint LodSelector::ReturnLevel( GLuint item, GLsizei instance ) const{
+   if( ! this->Enabled or item >= this->Levels.size() or (size_t)instance >= this->Levels[ item ].size() ){
+      return 0;
+   }
+   return this->Levels[ item ][ instance ];
+}
+
+#endif
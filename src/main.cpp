@@ -9,10 +9,42 @@
    W plik main.cpp znajduje się \link main() \endlink oraz klasa \link Gra \endlink.
 */
 #include "header.hpp"
+#include "profiler.cpp"
+#include "thread_pool.cpp"
+#include "mesh_cache.cpp"
 #include "common.cpp"
+#include "texture_cook.cpp"
+#include "texture_uploader.cpp"
+#include "texture_cache.cpp"
+#include "vertex.cpp"
+#include "mesh_optimizer.cpp"
+#include "geometry_arena.cpp"
 #include "camera.cpp"
 #include "mesh.cpp"
+#include "loader.cpp"
 #include "light.cpp"
+#include "headless.cpp"
+#include "stats.cpp"
+#include "scene_bvh.cpp"
+#include "frustum_culler.cpp"
+#include "lod_selector.cpp"
+#include "cluster_culler.cpp"
+#include "state_cache.cpp"
+#include "occlusion_culler.cpp"
+#include "indirect_renderer.cpp"
+#include "gpu_profiler.cpp"
+#include "render_queue.cpp"
+#include "frame_uniforms.cpp"
+#include "benchmark.cpp"
+
+/*!
+   \brief Najdłuższe oczekiwanie (w milisekundach) na zdarzenie, gdy klatka nie jest rysowana (okno nieaktywne lub scena bez zmian).
+*/
+#define GRA_IDLE_WAIT 250
+/*!
+   \brief Ilość klatek rysowanych po zmianie sceny w trybie --on-demand (wyniki zapytań o zasłonięcie przychodzą z opóźnieniem).
+*/
+#define GRA_ON_DEMAND_FRAMES ( OCCLUSION_CULLER_VISIBLE_INTERVAL + OCCLUSION_CULLER_HYSTERESIS + 2 )
 
 /*!
    \brief Główna klasa, w której gromadzone są wszystkich informacje potrzebne do uruchomienia aplikacji.
@@ -31,8 +63,11 @@ class Gra{
          Tworzy okno oraz kontekst dla OpenGL 3.3.\n
          Ładuje shader wierzchołków i fragmentu oraz ustala uniformy.\n
          Wczytuje wszystkie obiekty z plików .obj z teksturami.
+
+         \param argc - ilość parametrów uruchomienia
+         \param argv - parametry uruchomienia (patrz \link ParseArguments() \endlink)
       */
-      Gra();
+      Gra( int argc, char* argv[] );
       /*!
       \brief Czyści zaalokowaną pamięć.
 
@@ -52,6 +87,70 @@ class Gra{
          Rysowanie wszystkich obiektów.\n
       */
       void Update();
+      /*!
+         \brief Wyświetla narysowaną klatkę.
+
+         W oknie zamienia bufory, w trybie headless czeka na zakończenie rysowania.
+      */
+      void Present();
+      /*!
+         \brief Zwraca TRUE, gdy klatka ma być narysowana.
+
+         Okno nieaktywne: FALSE. W trybie \link OnDemand \endlink klatka rysowana jest tylko po zmianie kamery, sceny (wczytane obiekty, bryły otaczające)
+         lub okna od ostatniej narysowanej klatki ( \link MarkDrawn() \endlink ), oraz przez \link GRA_ON_DEMAND_FRAMES \endlink kolejnych klatek.
+      */
+      bool NeedsRedraw() const;
+      /*!
+         \brief Zapamiętuje wersje kamery i sceny narysowanej klatki (tryb \link OnDemand \endlink ).
+
+         Po zmianie od poprzedniej klatki rysowanych jest jeszcze \link GRA_ON_DEMAND_FRAMES \endlink klatek
+         (odrzucanie zasłoniętych obiektów korzysta z wyników poprzednich klatek).
+      */
+      void MarkDrawn();
+      /*!
+         \brief Odczytuje parametry uruchomienia.
+
+         \param argc - ilość parametrów uruchomienia
+         \param argv - parametry uruchomienia
+
+         Dostępne parametry:\n
+         <ul>
+         <li>--headless - rysowanie bez okna do bufora ramki (FBO)</li>
+         <li>--frames N - ilość klatek rysowanych w trybie headless, domyślnie 1</li>
+         <li>--output PLIK - zapis ostatniej klatki trybu headless do pliku .ppm</li>
+         <li>--width N - szerokość okna lub bufora ramki</li>
+         <li>--height N - wysokość okna lub bufora ramki</li>
+         <li>--bench N - pomiar czasu N klatek z ustaloną ścieżką kamery</li>
+         <li>--bench-output PLIK - plik JSON z wynikami pomiaru, domyślnie ./bench.json</li>
+         <li>--trace PLIK - zapis pomiarów profilera do pliku JSON (Chrome Trace), wymaga kompilacji z PROFILER=1</li>
+         <li>--no-cache - wczytywanie plików .obj bez pamięci podręcznej (katalog ./cache/)</li>
+         <li>--gpu-profile - pomiar czasu GPU (czyszczenie ekranu, każdy obiekt, wyświetlenie klatki)</li>
+         <li>--threads N - ilość wątków wczytujących obiekty, domyślnie 0 = ilość rdzeni procesora</li>
+         <li>--vertex-format FORMAT - format wierzchołków: float (32 bajty, domyślnie) lub packed (16 bajtów, kwantyzowany)</li>
+         <li>--no-texture-compress - przygotowane tekstury (pamięć podręczna) bez kompresji BC1/BC3</li>
+         <li>--texture-hash - tekstury o tej samej zawartości z różnych plików są współdzielone (suma kontrolna pikseli)</li>
+         <li>--stream-budget MS - czas na klatkę (w milisekundach) na przekazywanie wczytanych obiektów do OpenGL, domyślnie 2</li>
+         <li>--indirect - rysowanie wszystkich obiektów z bufora poleceń (glMultiDrawElementsIndirect), dane obiektów w buforze tekstury</li>
+         <li>--no-cull - rysowanie wszystkich obiektów, bez odrzucania obiektów poza ostrosłupem widzenia kamery</li>
+         <li>--no-bvh - odrzucanie przez test sfer wszystkich instancji, bez drzewa brył otaczających</li>
+         <li>--occlusion - odrzucanie instancji zasłoniętych przez inne obiekty (zapytania o zasłonięcie z poprzednich klatek)</li>
+         <li>--no-lod - rysowanie wszystkich obiektów z pełną dokładnością (poziom szczegółowości 0)</li>
+         <li>--lod-threshold PX - największy błąd uproszczonego poziomu szczegółowości na ekranie (w pikselach), domyślnie 1</li>
+         <li>--no-clusters - rysowanie obiektów całymi częściami, bez odrzucania grup trójkątów (meshletów)</li>
+         <li>--on-demand - rysowanie klatki tylko po zmianie kamery lub sceny, bez zmian aplikacja czeka na zdarzenia</li>
+         </ul>
+      */
+      void ParseArguments( int argc, char* argv[] );
+      /*!
+         \brief Zapisuje pomiary profilera do pliku \link TraceFile \endlink (gdy jest ustalony).
+
+         Najpierw czeka na zadania wątków roboczych (okno mogło zostać zamknięte w trakcie wczytywania obiektów).
+      */
+      void SaveTrace();
+      /*!
+         \brief Przekazuje odczytane czasy GPU do trybu benchmark oraz do profilera.
+      */
+      void CollectGpuTimes();
       /*!
          \brief Poprawność zainicjalizowanych wszystkich elementów. FALSE = Błąd.
       */
@@ -72,10 +171,144 @@ class Gra{
          \brief Wskaźnik dla kontekstu Opengl dla okna SDL2.
       */
       SDL_GLContext Kontekst = NULL;
+      /*!
+         \brief Rysowanie bez okna (tryb headless). TRUE = brak okna.
+      */
+      bool HeadlessMode = false;
+      /*!
+         \brief Kontekst OpenGL i bufor ramki dla trybu headless.
+      */
+      Headless headless;
+      /*!
+         \brief Ilość klatek rysowanych w trybie headless, domyślnie 1.
+      */
+      int Frames = 1;
+      /*!
+         \brief Ścieżka do pliku .ppm z ostatnią klatką trybu headless. Pusta = brak zapisu.
+      */
+      string OutputFile;
+      //Benchmark:
+      /*!
+         \brief Ilość mierzonych klatek w trybie benchmark. 0 = brak pomiaru.
+      */
+      int BenchFrames = 0;
+      /*!
+         \brief Ścieżka do pliku JSON z wynikami trybu benchmark.
+      */
+      string BenchOutput = "./bench.json";
+      /*!
+         \brief Tryb benchmark (ścieżka kamery i pomiar czasu klatek).
+      */
+      Benchmark benchmark;
+      /*!
+         \brief Liczniki aktualnej klatki.
+      */
+      FrameStats Stats;
+      /*!
+         \brief Czas zakończenia poprzedniej klatki (SDL_GetPerformanceCounter). 0 = brak poprzedniej klatki.
+      */
+      Uint64 LastFrameEnd = 0;
+      /*!
+         \brief Ścieżka do pliku JSON (Chrome Trace) z pomiarami profilera. Pusta = brak pomiarów.
+      */
+      string TraceFile;
+      /*!
+         \brief Pomiar czasu GPU. TRUE = włączony.
+      */
+      bool GpuProfile = false;
+      /*!
+         \brief Pomiar czasu GPU (zapytania GL_TIMESTAMP).
+      */
+      GpuProfiler gpuProfiler;
+      //Loading:
+      /*!
+         \brief Ilość wątków wczytujących obiekty. 0 = ilość rdzeni procesora.
+      */
+      int Threads = 0;
+      /*!
+         \brief Pula wątków roboczych.
+      */
+      ThreadPool pool;
+      /*!
+         \brief Równoległe wczytywanie obiektów.
+      */
+      Loader loader;
+      /*!
+         \brief Bufory pikseli dla tekstur przekazywanych w trakcie rysowania klatek.
+      */
+      TextureUploader uploader;
+      /*!
+         \brief Kompresja BC1/BC3 przygotowanych tekstur (gdy obsługiwana przez kartę graficzną). TRUE = włączona.
+      */
+      bool TextureCompress = true;
+      /*!
+         \brief Czas na klatkę (w milisekundach) na przekazywanie wczytanych obiektów do OpenGL, domyślnie 2.
+      */
+      double StreamBudget = 2.0;
+      /*!
+         \brief Rysowanie przez \link IndirectRenderer \endlink. TRUE = włączone.
+      */
+      bool Indirect = false;
+      /*!
+         \brief Rysowanie wszystkich obiektów z bufora poleceń (gdy \link Indirect \endlink ).
+      */
+      IndirectRenderer indirectRenderer;
+      /*!
+         \brief Odrzucanie instancji obiektów poza ostrosłupem widzenia kamery (przed rysowaniem każdej klatki).
+      */
+      FrustumCuller culler;
+      /*!
+         \brief Drzewo brył otaczających instancji obiektów (odrzucanie i zapytania przestrzenne).
+      */
+      SceneBVH bvh;
+      /*!
+         \brief Odrzucanie z drzewem \link bvh \endlink. FALSE = test wszystkich sfer.
+      */
+      bool UseBVH = true;
+      /*!
+         \brief Odrzucanie instancji zasłoniętych przez inne obiekty (zapytania o zasłonięcie z poprzednich klatek).
+      */
+      bool Occlusion = false;
+      /*!
+         \brief Odrzucanie zasłoniętych instancji (gdy \link Occlusion \endlink ).
+      */
+      OcclusionCuller occlusion;
+      /*!
+         \brief Wybór poziomu szczegółowości widocznych instancji według wielkości na ekranie.
+      */
+      LodSelector lods;
+      /*!
+         \brief Odrzucanie grup trójkątów (meshletów) obiektów rysowanych z pełną dokładnością.
+      */
+      ClusterCuller clusters;
+      /*!
+         \brief Kolejka rysowania posortowana według stanu OpenGL (gdy nie \link Indirect \endlink ).
+      */
+      RenderQueue queue;
+      /*!
+         \brief Ostatni stan OpenGL, pomija powtórzone zmiany stanu w trakcie rysowania klatki.
+      */
+      StateCache state;
       /*!
          \brief Skupienie się na oknie, czy myszka jest w okno. FALSE = okno jest nie aktywne.
       */
       bool Focus = true;
+      /*!
+         \brief Rysowanie na żądanie (tylko po zmianie kamery lub sceny). TRUE = włączone.
+      */
+      bool OnDemand = false;
+      /*!
+         \brief Ilość klatek do narysowania w trybie \link OnDemand \endlink niezależnie od zmian.
+      */
+      int RedrawFrames = GRA_ON_DEMAND_FRAMES;
+      /*!
+         \brief Wersja kamery ostatnio narysowanej klatki ( \link MarkDrawn() \endlink ).
+      */
+      unsigned long DrawnCamera = 0;
+      /*!
+         \brief Wersja sceny ( \link Mesh::ReturnSceneVersion() \endlink ) ostatnio narysowanej klatki.
+      */
+      unsigned long DrawnScene = 0;
       /*!
          \brief Typ zdarzenia (SDL2).
       */
@@ -99,57 +332,33 @@ class Gra{
       */
       GLuint UniformModel;
       /*!
-         \brief Uniform dla macierzy widoku.
-      */
-      GLuint UniformView;
-      /*!
-         \brief Uniform dla macierzy projekcji.
-      */
-      GLuint UniformProjection;
-      /*!
-         \brief Uniform dla tekstury głównej obiektu.
-      */
-      GLuint UniformTexture;
-      /*!
-         \brief Uniform dla tekstury spektralnej obiektu.
-      */
-      GLuint UniformTextureSpecular;
-      /*!
-         \brief Uniform dla pozycji kamery.
-      */
-      GLuint UniformViewPos;
-      /*!
-         \brief Uniform dla pozycji światła numer 1.
+         \brief Uniform dla macierzy model-widok-projekcja (liczonej na CPU).
       */
-      GLuint UniformLightPosition_1;
+      GLuint UniformModelViewProjection;
       /*!
-         \brief Uniform dla wartości Ambient światła numer 1.
+         \brief Uniform dla macierzy normalnych (liczonej na CPU).
       */
-      GLuint UniformLightAmbient_1;
+      GLuint UniformNormal;
       /*!
-         \brief Uniform dla wartości Diffuse światła numer 1.
+         \brief Uniform dla skali kwantyzowanej pozycji obiektu.
       */
-      GLuint UniformLightDiffuse_1;
+      GLuint UniformPositionScale;
       /*!
-         \brief Uniform dla wartości Specular światła numer 1.
+         \brief Uniform dla przesunięcia kwantyzowanej pozycji obiektu.
       */
-      GLuint UniformLightSpecular_1;
+      GLuint UniformPositionOffset;
       /*!
-         \brief Uniform dla pozycji światła numer 2.
-      */
-      GLuint UniformLightPosition_2;
-      /*!
-         \brief Uniform dla wartości Ambient światła numer 2.
+         \brief Uniform dla tekstury głównej obiektu.
       */
-      GLuint UniformLightAmbient_2;
+      GLuint UniformTexture;
       /*!
-         \brief Uniform dla wartości Diffuse światła numer 2.
+         \brief Uniform dla tekstury spektralnej obiektu.
       */
-      GLuint UniformLightDiffuse_2;
+      GLuint UniformTextureSpecular;
       /*!
-         \brief Uniform dla wartości Specular światła numer 2.
+         \brief Bufor uniformów klatki (macierze kamery, pozycja kamery, światła).
       */
-      GLuint UniformLightSpecular_2;
+      FrameUniforms frameUniforms;
       //Camera:
       /*!
          \brief Kamera, miejsce z którego będzie przetwarzana cała scena OpenGL.
@@ -193,7 +402,7 @@ int main( int argc, char* argv[] ){
    /*
       Stworzenie klasy.
    */
-   Gra gra;
+   Gra gra( argc, argv );
    /*
       Uruchomienie aplikacji.
    */
@@ -201,13 +410,35 @@ int main( int argc, char* argv[] ){
    return 0;
 }
 
-Gra::Gra(){
+Gra::Gra( int argc, char* argv[] ){
+   /*
+      Parametry uruchomienia.
+   */
+   this->ParseArguments( argc, argv );
+   if( ! this->CheckInit ){
+      return;
+   }
+   /*
+      Pomiary profilera.
+   */
+   if( ! this->TraceFile.empty() ){
+#ifdef PROFILER
+      Profiler::Enable( true );
+      PROFILE_THREAD( "main" );
+#else
+      cout<<"Trace: build with PROFILER=1\n";
+#endif
+   }
+   PROFILE_SCOPE( "Gra::Gra" );
    //SDL2:
    /*
       Inicjalizuje bibliotekę SDL2.
       SDL_INIT_EVERYTHING - uruchamia wszystkie moduły biblioteki SDL2.
+      W trybie headless tylko licznik czasu, bez obsługi okien.
    */
-   if( SDL_Init( SDL_INIT_EVERYTHING ) < 0 ){
+   {
+   PROFILE_SCOPE( "SDL_Init" );
+   if( SDL_Init( this->HeadlessMode ? SDL_INIT_TIMER : SDL_INIT_EVERYTHING ) < 0 ){
       /*
          Wyświetl błąd, gdy jest mniejszy od 0.
       */
@@ -215,56 +446,87 @@ Gra::Gra(){
       this->CheckInit = false;
       return;
    }
-   /*
-      Ustalenie wersji OpenGL dla SDL2, w tym przypadku jest to OpenGL 3.3
-   */
-   SDL_GL_SetAttribute( SDL_GL_CONTEXT_MAJOR_VERSION, 3 );
-   SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, 3 );
-   /*
-      Profil Core dla OpenGL.
-   */
-   SDL_GL_SetAttribute( SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE );
+   }
    /*
       Profil Core OpenGL dla biblioteki GLEW.
    */
    glewExperimental = true;
-   /*
-      Stworzenie okna o tytule: OpenGL
-      Okna na pozycji 0,0
-      Wielkość okna Szerokosc x Wysokosc
-      SDL_WINDOW_OPENGL - flaga dla okna, aby wiedział że to jest okno dla OpenGL
-   */
-   this->Okno = SDL_CreateWindow( "OpenGL", 0, 0, this->Szerokosc, this->Wysokosc, SDL_WINDOW_OPENGL );
-   if( this->Okno == NULL ){
+   {
+   PROFILE_SCOPE( "CreateContext" );
+   if( this->HeadlessMode ){
       /*
-         W razie błędu wypisz go.
+         Kontekst OpenGL bez okna (EGL).
       */
-      cout<<"SDL_CreateWindow: "<<SDL_GetError()<<"\n";
-      this->CheckInit = false;
-      return;
+      if( ! this->headless.CreateContext() ){
+         this->CheckInit = false;
+         return;
+      }
    }
-   /*
-      Tryb Relative Mouse Mode - ukrycie myszki.
-   */
-   SDL_SetRelativeMouseMode( SDL_TRUE );
-   /*
-      Utworzenie kontekstu dla OpenGL dla okna w SDL2.
-   */
-   this->Kontekst = SDL_GL_CreateContext( this->Okno );
-   if( this->Kontekst == NULL ){
+   else{
       /*
-         W razie błędu wypisz go.
+         Ustalenie wersji OpenGL dla SDL2, w tym przypadku jest to OpenGL 3.3
       */
-      cout<<"SDL_GL_CreateContext: "<<SDL_GetError()<<"\n";
-      this->CheckInit = false;
-      return;
+      SDL_GL_SetAttribute( SDL_GL_CONTEXT_MAJOR_VERSION, 3 );
+      SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, 3 );
+      /*
+         Profil Core dla OpenGL.
+      */
+      SDL_GL_SetAttribute( SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE );
+      /*
+         Stworzenie okna o tytule: OpenGL
+         Okna na pozycji 0,0
+         Wielkość okna Szerokosc x Wysokosc
+         SDL_WINDOW_OPENGL - flaga dla okna, aby wiedział że to jest okno dla OpenGL
+      */
+      this->Okno = SDL_CreateWindow( "OpenGL", 0, 0, this->Szerokosc, this->Wysokosc, SDL_WINDOW_OPENGL );
+      if( this->Okno == NULL ){
+         /*
+            W razie błędu wypisz go.
+         */
+         cout<<"SDL_CreateWindow: "<<SDL_GetError()<<"\n";
+         this->CheckInit = false;
+         return;
+      }
+      /*
+         Tryb Relative Mouse Mode - ukrycie myszki.
+      */
+      SDL_SetRelativeMouseMode( SDL_TRUE );
+      /*
+         Utworzenie kontekstu dla OpenGL dla okna w SDL2.
+      */
+      this->Kontekst = SDL_GL_CreateContext( this->Okno );
+      if( this->Kontekst == NULL ){
+         /*
+            W razie błędu wypisz go.
+         */
+         cout<<"SDL_GL_CreateContext: "<<SDL_GetError()<<"\n";
+         this->CheckInit = false;
+         return;
+      }
+      /*
+         Podczas pomiaru czasu klatek wyłączona jest synchronizacja pionowa.
+      */
+      if( this->BenchFrames > 0 ){
+         SDL_GL_SetSwapInterval( 0 );
+      }
+   }
    }
 
    //GLEW:
    /*
       Inicjalizuje bibliotekę GLEW.
    */
-   GLenum GL_Error = glewInit();
+   GLenum GL_Error;
+   {
+   PROFILE_SCOPE( "glewInit" );
+   GL_Error = glewInit();
+   }
+   /*
+      W trybie headless nie ma wyświetlacza X11, więc GLEW nie załaduje rozszerzeń GLX (funkcje OpenGL są już załadowane).
+   */
+   if( this->HeadlessMode and GL_Error == GLEW_ERROR_NO_GLX_DISPLAY ){
+      GL_Error = GLEW_OK;
+   }
    if( GL_Error != GLEW_OK  ){
       /*
          W razie błędu wypisz go.
@@ -273,6 +535,27 @@ Gra::Gra(){
       this->CheckInit = false;
       return;
    }
+   /*
+      Przygotowane tekstury kompresowane są tylko, gdy karta graficzna obsługuje format S3TC (BC1/BC3).
+   */
+   TextureCook::SetCompression( this->TextureCompress and GLEW_EXT_texture_compression_s3tc );
+   /*
+      W trybie headless rysowanie odbywa się do bufora ramki (FBO).
+   */
+   if( this->HeadlessMode and ! this->headless.CreateFramebuffer( this->Szerokosc, this->Wysokosc ) ){
+      this->CheckInit = false;
+      return;
+   }
+   /*
+      Proporcje projekcji kamery zgodne z wielkością okna (bufora ramki).
+   */
+   this->camera.SetAspect( (GLfloat)this->Szerokosc / this->Wysokosc );
+   /*
+      Pomiar czasu GPU, wyniki odczytywane są po 3 klatkach.
+   */
+   if( this->GpuProfile ){
+      this->gpuProfiler.Init( 3 );
+   }
    /*
       Włącz Z-buffor (bufor głębokości).
    */
@@ -290,6 +573,8 @@ Gra::Gra(){
    */
    glClearColor( 0.0f, 0.0f, 0.0f, 0.0f );
    //DevIL
+   {
+   PROFILE_SCOPE( "DevIL" );
    /*
       Inicjalizuje DevIL.
    */
@@ -298,6 +583,7 @@ Gra::Gra(){
       Inicjalizuje pomocniczą bibliotekę dla DevIL (w celu wyświetlania tekstowych błędów).
    */
    iluInit();
+   }
    ILenum IL_Error;
    while( ( IL_Error = ilGetError() ) != IL_NO_ERROR ){
       /*
@@ -311,7 +597,10 @@ Gra::Gra(){
    /*
       Tworzy program z shaderami.
    */
-   this->ProgramID = CreateShader( vertex, fragment );
+   {
+   PROFILE_SCOPE( "CreateShader" );
+   this->ProgramID = CreateShader( vertex, fragment, this->Indirect ? "#define INDIRECT\n" : "" );
+   }
    if( this->ProgramID <= 0 ){
       /*
          W razie błędu wypisz go.
@@ -327,19 +616,33 @@ Gra::Gra(){
       "model" - nazwa uniformu
    */
    this->UniformModel = glGetUniformLocation( this->ProgramID, "model" );
-   this->UniformView = glGetUniformLocation( this->ProgramID, "view" );
-   this->UniformProjection = glGetUniformLocation( this->ProgramID, "projection" );
-   this->UniformTexture = glGetUniformLocation( this->ProgramID, "Model.Texture" );
-   this->UniformTextureSpecular = glGetUniformLocation( this->ProgramID, "Model.Texture_specular" );
-   this->UniformViewPos = glGetUniformLocation( this->ProgramID, "ViewPos" );
-   this->UniformLightPosition_1 = glGetUniformLocation( this->ProgramID, "DirectionalLight[0].Position" );
-   this->UniformLightAmbient_1 = glGetUniformLocation( this->ProgramID, "DirectionalLight[0].Ambient" );
-   this->UniformLightDiffuse_1 = glGetUniformLocation( this->ProgramID, "DirectionalLight[0].Diffuse" );
-   this->UniformLightSpecular_1 = glGetUniformLocation( this->ProgramID, "DirectionalLight[0].Specular" );
-   this->UniformLightPosition_2 = glGetUniformLocation( this->ProgramID, "DirectionalLight[1].Position" );
-   this->UniformLightAmbient_2 = glGetUniformLocation( this->ProgramID, "DirectionalLight[1].Ambient" );
-   this->UniformLightDiffuse_2 = glGetUniformLocation( this->ProgramID, "DirectionalLight[1].Diffuse" );
-   this->UniformLightSpecular_2 = glGetUniformLocation( this->ProgramID, "DirectionalLight[1].Specular" );
+   this->UniformModelViewProjection = glGetUniformLocation( this->ProgramID, "modelViewProjection" );
+   this->UniformNormal = glGetUniformLocation( this->ProgramID, "normalMatrix" );
+   this->UniformPositionScale = glGetUniformLocation( this->ProgramID, "PositionScale" );
+   this->UniformPositionOffset = glGetUniformLocation( this->ProgramID, "PositionOffset" );
+   this->UniformTexture = glGetUniformLocation( this->ProgramID, "Material.Texture" );
+   this->UniformTextureSpecular = glGetUniformLocation( this->ProgramID, "Material.Texture_specular" );
+   /*
+      Numery tekstur w uniformach są stałe: 0 = główna tekstura, 1 = spektralna tekstura.
+   */
+   glUseProgram( this->ProgramID );
+   glUniform1i( this->UniformTexture, 0 );
+   glUniform1i( this->UniformTextureSpecular, 1 );
+   glUseProgram( 0 );
+   if( ! this->frameUniforms.Init( this->ProgramID ) ){
+      this->CheckInit = false;
+      return;
+   }
+   if( this->Indirect ){
+      this->indirectRenderer.Init( this->ProgramID );
+   }
+   else{
+      this->queue.Init( this->ProgramID, this->UniformModel, this->UniformModelViewProjection, this->UniformNormal, this->UniformPositionScale, this->UniformPositionOffset );
+   }
+   if( this->Occlusion and ! this->occlusion.Init( "./data/Occlusion.vert", "./data/Occlusion.frag" ) ){
+      this->CheckInit = false;
+      return;
+   }
 
    //Data:
    /*
@@ -370,6 +673,23 @@ Gra::Gra(){
             Dodanie tesktu do strumienia.
          */
          tmp_stream.str( tmp_string );
+         /*
+            Linia "+ X Y Z [KĄT_Y [SKALA]]" dodaje instancję poprzedniego obiektu.
+         */
+         if( ! tmp_string.empty() and tmp_string[0] == '+' ){
+            if( this->Item.empty() ){
+               cout<<"Instance without item: "<<tmp_string<<"\n";
+               continue;
+            }
+            tmp_stream.ignore( 1 );
+            GLfloat tmp_angle = 0.0f, tmp_scale = 1.0f;
+            tmp_stream >> tmp_vector_vec3.x >> tmp_vector_vec3.y >> tmp_vector_vec3.z;
+            if( tmp_stream >> tmp_angle ){
+               tmp_stream >> tmp_scale;
+            }
+            this->Item.back().AddInstance( scale( rotate( translate( mat4( 1.0f ), tmp_vector_vec3 ), radians( tmp_angle ), vec3( 0.0f, 1.0f, 0.0f ) ), vec3( tmp_scale ) ) );
+            continue;
+         }
          /*
             Stworzenie tymczasowego obiektu.
          */
@@ -421,10 +741,19 @@ Gra::Gra(){
       }
       /*
          Załadowanie wszystkich wczytanych danych do pamięcie.
-         Wykorzystane są iteratory dla wektora.
+         Pliki wczytywane są równolegle w puli wątków, dane do OpenGL przekazuje wątek główny.
+         W oknie obiekty pojawiają się w trakcie rysowania klatek (patrz Update),
+         w trybie headless i benchmark klatki rysowane są dopiero po wczytaniu całej sceny.
       */
-      for( this->It_Item = this->Item.begin(); this->It_Item != this->Item.end(); ++this->It_Item ){
-         this->It_Item->LoadData();
+      PROFILE_SCOPE( "LoadItems" );
+      this->pool.Start( this->Threads );
+      this->clusters.Start( this->Threads );
+      this->loader.Start( this->pool, this->Item );
+      if( this->HeadlessMode or this->BenchFrames > 0 ){
+         this->loader.Finish();
+      }
+      else{
+         this->uploader.Init( 4 );
       }
    }
    else{
@@ -446,19 +775,44 @@ Gra::Gra(){
    */
    tmp_vector_vec3 = vec3( 15.0f, 0.0f, 15.0f );
    this->light2.SetPosition( tmp_vector_vec3 );
+   //Benchmark:
+   if( this->BenchFrames > 0 ){
+      this->benchmark.Start( this->BenchFrames );
+   }
 }
 
 Gra::~Gra(){
+   /*
+      Wątki robocze mogą jeszcze wczytywać obiekty (zamknięcie okna w trakcie wczytywania).
+   */
+   this->pool.Wait();
    /*
       Usunięcie programu z shaderami z pamięci.
    */
    glDeleteProgram( this->ProgramID );
-   SDL_SetRelativeMouseMode( SDL_FALSE );
    /*
-      Usunięcie kontekstu i okna.
+      Usunięcie obiektów (zwalniają tekstury i miejsce w buforach geometrii), potem wspólnych buforów geometrii, wszystko przed usunięciem kontekstu.
+   */
+   this->Item.clear();
+   GeometryArena::Destroy();
+   this->frameUniforms.Destroy();
+   this->occlusion.Destroy();
+   this->gpuProfiler.Destroy();
+   this->uploader.Destroy();
+   if( this->Indirect ){
+      this->indirectRenderer.Destroy();
+   }
+   else{
+      this->queue.Destroy();
+   }
+   /*
+      Usunięcie kontekstu i okna (kontekst trybu headless usuwany jest przez \link Headless \endlink).
    */
-   SDL_GL_DeleteContext( this->Kontekst );
-   SDL_DestroyWindow( this->Okno );
+   if( this->Okno != NULL ){
+      SDL_SetRelativeMouseMode( SDL_FALSE );
+      SDL_GL_DeleteContext( this->Kontekst );
+      SDL_DestroyWindow( this->Okno );
+   }
    /*
       Deaktywowanie SDL2.
    */
@@ -466,6 +820,19 @@ Gra::~Gra(){
 }
 
 void Gra::Start(){
+   /*
+      W trybie headless nie ma zdarzeń, rysowana jest ustalona ilość klatek.
+   */
+   if( this->HeadlessMode ){
+      for( int i = 0; this->CheckInit and ( i < this->Frames or this->benchmark.IsRunning() ); ++i ){
+         this->Update();
+      }
+      if( this->CheckInit and ! this->OutputFile.empty() ){
+         this->headless.SavePPM( this->OutputFile );
+      }
+      this->SaveTrace();
+      return;
+   }
    /*
       Gry wszystko jest załadowane, to zacznij odbierać sygnały zdarzeń w SDL2 (klawiatury i myszy).
    */
@@ -473,6 +840,14 @@ void Gra::Start(){
       /*
          Wykonuj dopóki jest jakieś zdarzenie w SDL2.
       */
+      {
+      PROFILE_SCOPE( "Events" );
+      /*
+         Bez klatki do narysowania wątek czeka na zdarzenie (NULL = zdarzenie zostaje w kolejce) zamiast obciążać rdzeń.
+      */
+      if( ! this->NeedsRedraw() ){
+         SDL_WaitEventTimeout( NULL, GRA_IDLE_WAIT );
+      }
       while( SDL_PollEvent( & this->Event ) ){
          /*
             Podział na typt zdarzeń w SDL2.
@@ -563,11 +938,18 @@ void Gra::Start(){
                   case SDL_WINDOWEVENT_FOCUS_GAINED:
                      SDL_SetRelativeMouseMode( SDL_TRUE );
                      this->Focus = true;
+                     this->RedrawFrames = GRA_ON_DEMAND_FRAMES;
                      break;
                   case SDL_WINDOWEVENT_FOCUS_LOST:
                      SDL_SetRelativeMouseMode( SDL_FALSE );
                      this->Focus = false;
                      break;
+                  /*
+                     Zawartość okna do odświeżenia (np. po odsłonięciu).
+                  */
+                  case SDL_WINDOWEVENT_EXPOSED:
+                     this->RedrawFrames = GRA_ON_DEMAND_FRAMES;
+                     break;
                   default:
                      break;
                }
@@ -576,94 +958,324 @@ void Gra::Start(){
                break;
          }
       }
+      }
       //Update:
       /*
          Rysowanie wszystkich elementów.
       */
       this->Update();
+      /*
+         Po zakończeniu pomiaru czasu klatek aplikacja jest zamykana.
+      */
+      if( this->benchmark.IsFinished() ){
+         this->CheckInit = false;
+      }
    }
+   this->SaveTrace();
 }
 
 void Gra::Update(){
-   if( this->Focus ){
+   if( this->NeedsRedraw() ){
+   /*
+      Początek pomiaru czasu klatki.
+   */
+   Uint64 FrameStart = SDL_GetPerformanceCounter();
+   PROFILE_SCOPE( "Gra::Update" );
+   this->Stats.Reset();
+   /*
+      Początek pomiaru czasu GPU i odczyt wyników sprzed kilku klatek.
+   */
+   this->gpuProfiler.BeginFrame();
+   if( this->benchmark.IsRunning() ){
+      this->benchmark.SetGpuFrame( this->gpuProfiler.ReturnFrame() );
+   }
+   this->CollectGpuTimes();
+   /*
+      Przekazanie do OpenGL obiektów wczytanych w tle (w ramach budżetu czasu klatki).
+   */
+   if( ! this->loader.IsFinished() ){
+      this->Stats.Add( COUNTER_UPLOADS, this->loader.Pump( &this->uploader, this->StreamBudget ) );
+      this->gpuProfiler.Mark( "Upload" );
+   }
+   /*
+      W trybie benchmark kamera porusza się po ustalonej ścieżce.
+   */
+   if( this->benchmark.IsRunning() ){
+      this->benchmark.MoveCamera( this->camera );
+   }
    /*
       Wyczyszczenie ekranu.
    */
+   {
+   PROFILE_SCOPE( "Clear" );
    glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+   this->gpuProfiler.Mark( "Clear" );
+   }
 
    /*
-      Użycie programu shadera.
+      Użycie programu shadera (stan zapamiętany od początku klatki).
    */
-   glUseProgram( this->ProgramID );
+   this->state.Reset();
+   this->state.UseProgram( this->ProgramID );
    /*
-      Przekazanie wartości do uniformów.
-
-      value_ptr - zwraca wskaźnik do każdego typu danych
-
-      W kolejności:
-      - macierz widoku
-      - macierz projekcji
-
-      - pozycja światła 1
-      - wartość Ambient światła 1
-      - wartość Diffuse światła 1
-      - wartość Specular światła 1
-
-      - pozycja światła 2
-      - wartość Ambient światła 2
-      - wartość Diffuse światła 2
-      - wartość Specular światła 2
-
-      - pozycja kamery
+      Dane klatki (kamera i światła) jednym przekazaniem do bufora uniformów.
    */
-   glUniformMatrix4fv( this->UniformView, 1, GL_FALSE, value_ptr( this->camera.ReturnViewMatrix() ) );
-   glUniformMatrix4fv( this->UniformProjection, 1, GL_FALSE, value_ptr( this->camera.ReturnProjectionMatrix() ) );
-
-   glUniform3fv( this->UniformLightPosition_1, 1, value_ptr( this->light1.ReturnPosition() ) );
-   glUniform3fv( this->UniformLightAmbient_1, 1, value_ptr( this->light1.ReturnAmbient() ) );
-   glUniform3fv( this->UniformLightDiffuse_1, 1, value_ptr( this->light1.ReturnDiffuse() ) );
-   glUniform3fv( this->UniformLightSpecular_1, 1, value_ptr( this->light1.ReturnSpecular() ) );
-
-   glUniform3fv( this->UniformLightPosition_2, 1, value_ptr( this->light2.ReturnPosition() ) );
-   glUniform3fv( this->UniformLightAmbient_2, 1, value_ptr( this->light2.ReturnAmbient() ) );
-   glUniform3fv( this->UniformLightDiffuse_2, 1, value_ptr( this->light2.ReturnDiffuse() ) );
-   glUniform3fv( this->UniformLightSpecular_2, 1, value_ptr( this->light2.ReturnSpecular() ) );
-
-   glUniform3fv( this->UniformViewPos, 1, value_ptr( this->camera.ReturnPosition() ) );
+   this->frameUniforms.SetCamera( this->camera );
+   this->frameUniforms.SetLight( 0, this->light1 );
+   this->frameUniforms.SetLight( 1, this->light2 );
+   this->frameUniforms.Upload();
+   this->gpuProfiler.Mark( "Uniforms" );
 
    /*
       Rysowanie wszystkich obiektów
    */
-   for( this->It_Item = this->Item.begin(); this->It_Item != this->Item.end(); ++this->It_Item ){
+   {
+   PROFILE_SCOPE( "DrawItems" );
+   /*
+      Widoczność instancji obiektów (drzewo instancji lub sfery otaczające z ostrosłupem widzenia kamery),
+      następnie bez instancji zasłoniętych według zapytań z poprzednich klatek.
+   */
+   Uint64 CullStart = SDL_GetPerformanceCounter();
+   if( this->UseBVH ){
+      this->bvh.Update( this->Item );
+   }
+   this->culler.Cull( this->Item, this->camera, this->UseBVH ? &this->bvh : NULL, this->Stats );
+   if( this->occlusion.IsEnabled() ){
+      this->occlusion.Filter( this->Item, this->culler, this->camera.ReturnPosition(), this->Stats );
+   }
+   this->Stats.Add( COUNTER_CULL_MICROSECONDS, ( SDL_GetPerformanceCounter() - CullStart ) * 1000000 / SDL_GetPerformanceFrequency() );
+   /*
+      Poziom szczegółowości widocznych instancji (błąd uproszczenia w pikselach).
+   */
+   this->lods.Select( this->Item, this->camera, this->Wysokosc, this->culler, this->Stats );
+   /*
+      Grupy trójkątów obiektów rysowanych z pełną dokładnością: poza ostrosłupem widzenia i zwrócone tyłem do kamery są odrzucane.
+   */
+   CullStart = SDL_GetPerformanceCounter();
+   this->clusters.Cull( this->Item, this->camera, this->culler, this->lods, this->Stats );
+   this->Stats.Add( COUNTER_CULL_MICROSECONDS, ( SDL_GetPerformanceCounter() - CullStart ) * 1000000 / SDL_GetPerformanceFrequency() );
+   /*
+      Wszystkie obiekty z bufora poleceń (dane obiektów w buforze tekstury).
+   */
+   if( this->Indirect ){
+      this->indirectRenderer.Draw( this->Item, this->frameUniforms.ReturnViewProjection(), this->culler, this->lods, this->clusters, this->occlusion, this->Stats );
+      this->gpuProfiler.Mark( "Draw" );
+   }
+   else{
       /*
-         Przekazanie macierzy modelu.
+         Wszystkie części obiektów posortowane według programu, VAO, tekstur i odległości, zmiany stanu tylko gdy są potrzebne.
       */
-      glUniformMatrix4fv( this->UniformModel, 1, GL_FALSE, value_ptr( this->It_Item->ReturnModelMatrix() ) );
+      this->queue.Build( this->Item, this->camera.ReturnPosition(), this->culler, this->lods, this->occlusion );
+      this->queue.Submit( this->Item, this->frameUniforms.ReturnViewProjection(), this->state, this->clusters, this->gpuProfiler, this->Stats );
+      this->gpuProfiler.Mark( "Draw" );
+   }
+   /*
+      Zapytania o zasłonięcie prostopadłościanów instancji z buforem głębi narysowanej klatki (wyniki w kolejnych klatkach).
+   */
+   if( this->occlusion.IsEnabled() ){
+      this->occlusion.Issue( this->Item, this->frameUniforms.ReturnViewProjection(), this->state, this->Stats );
+      this->gpuProfiler.Mark( "Occlusion" );
+   }
+   this->Stats.Add( COUNTER_STATE_CALLS, this->state.ReturnIssued() );
+   this->Stats.Add( COUNTER_STATE_SKIPPED, this->state.ReturnSkipped() );
+   }
+
+   Uint64 UpdateEnd = SDL_GetPerformanceCounter();
+   /*
+      Odświeżenie okna.
+   */
+   this->Present();
+   this->gpuProfiler.Mark( "Present" );
+   Uint64 FrameEnd = SDL_GetPerformanceCounter();
+   /*
+      Wyniki pomiaru, czas klatki liczony jest od końca poprzedniej klatki (razem z obsługą zdarzeń).
+   */
+   if( this->benchmark.IsRunning() ){
+      double Frequency = SDL_GetPerformanceFrequency();
+      Uint64 PreviousEnd = ( this->LastFrameEnd != 0 ) ? this->LastFrameEnd : FrameStart;
+      this->benchmark.AddFrame( ( UpdateEnd - FrameStart ) * 1000.0 / Frequency, ( FrameEnd - PreviousEnd ) * 1000.0 / Frequency, this->Stats );
+      if( this->benchmark.IsFinished() ){
+         /*
+            Czasy GPU ostatnich klatek nie zostały jeszcze odczytane.
+         */
+         this->gpuProfiler.Flush();
+         this->CollectGpuTimes();
+         this->benchmark.Save( this->BenchOutput, this->Szerokosc, this->Wysokosc, this->HeadlessMode );
+      }
+   }
+   this->LastFrameEnd = FrameEnd;
+   this->MarkDrawn();
+   }
+}
+
+bool Gra::NeedsRedraw() const{
+   if( this->HeadlessMode ){
+      return true;
+   }
+   if( ! this->Focus ){
+      return false;
+   }
+   return ! this->OnDemand or this->benchmark.IsRunning() or ! this->loader.IsFinished() or this->RedrawFrames > 0
+          or this->camera.ReturnVersion() != this->DrawnCamera or Mesh::ReturnSceneVersion() != this->DrawnScene;
+}
+
+void Gra::MarkDrawn(){
+   if( this->camera.ReturnVersion() != this->DrawnCamera or Mesh::ReturnSceneVersion() != this->DrawnScene ){
+      this->DrawnCamera = this->camera.ReturnVersion();
+      this->DrawnScene = Mesh::ReturnSceneVersion();
+      this->RedrawFrames = GRA_ON_DEMAND_FRAMES;
+   }
+   if( this->RedrawFrames > 0 ){
+      --this->RedrawFrames;
+   }
+}
+
+void Gra::Present(){
+   PROFILE_SCOPE( "Present" );
+   if( this->HeadlessMode ){
       /*
-         Wyznaczenie numerów tekstur dla tekstów w uniformach
-         0 = główna tekstura
-         1 = spektralna tekstura
+         Bez okna nie ma zamiany buforów, czekamy aż GPU skończy rysować klatkę.
       */
-      glUniform1i( this->UniformTexture, 0 );
-      glUniform1i( this->UniformTextureSpecular, 1 );
+      glFinish();
+   }
+   else{
+      SDL_GL_SwapWindow( this->Okno );
+   }
+}
+
+void Gra::CollectGpuTimes(){
+   const vector < vector <GpuSection> > &Completed = this->gpuProfiler.ReturnCompleted();
+   const vector <unsigned long> &CompletedFrames = this->gpuProfiler.ReturnCompletedFrames();
+   for( unsigned int i = 0; i < Completed.size(); ++i ){
+      if( this->benchmark.IsRunning() or this->benchmark.IsFinished() ){
+         this->benchmark.AddGpuFrame( Completed[i], CompletedFrames[i] );
+      }
+#ifdef PROFILER
       /*
-         Aktywowanie i przekazanie tekstur do uniformów.
-         - główna tekstura
-         - spektralna tekstura
-      */
-      glActiveTexture( GL_TEXTURE0 );
-      glBindTexture( GL_TEXTURE_2D, this->It_Item->ReturnTexture() );
-      glActiveTexture( GL_TEXTURE1 );
-      glBindTexture( GL_TEXTURE_2D, this->It_Item->ReturnTextureSpecular() );
+         Czas GPU przeliczony na oś czasu CPU (wspólny punkt zapisany w GpuProfiler::Init).
+      */
+      if( Profiler::IsEnabled() ){
+         double Frequency = SDL_GetPerformanceFrequency();
+         for( unsigned int j = 0; j < Completed[i].size(); ++j ){
+            const GpuSection &Section = Completed[i][j];
+            Uint64 Start = this->gpuProfiler.ReturnCpuOrigin() + (Uint64)( ( Section.Start - this->gpuProfiler.ReturnGpuOrigin() ) * Frequency / 1000000000.0 );
+            Uint64 End = Start + (Uint64)( Section.Duration * Frequency / 1000000000.0 );
+            Profiler::AddTrackEvent( "gpu", Section.Name, Section.Detail, Start, End );
+         }
+      }
+#endif
+   }
+   this->gpuProfiler.ClearCompleted();
+}
+
+void Gra::SaveTrace(){
+#ifdef PROFILER
+   if( ! this->TraceFile.empty() ){
       /*
-         Ryosowanie elementu.
+         Bufory zdarzeń wątków czytane są bez blokady, wątki robocze nie mogą już niczego mierzyć.
       */
-      this->It_Item->Draw();
+      this->pool.Wait();
+      this->clusters.Wait();
+      Profiler::Save( this->TraceFile );
    }
+#endif
+}
 
-   /*
-      Odświeżenie okna.
-   */
-   SDL_GL_SwapWindow( this->Okno );
+void Gra::ParseArguments( int argc, char* argv[] ){
+   string Argument;
+   for( int i = 1; i < argc; ++i ){
+      Argument = argv[i];
+      if( Argument == "--headless" ){
+         this->HeadlessMode = true;
+      }
+      /*
+         Parametry z wartością, wartość jest kolejnym parametrem.
+      */
+      else if( i + 1 < argc and Argument == "--frames" ){
+         this->Frames = atoi( argv[++i] );
+      }
+      else if( i + 1 < argc and Argument == "--output" ){
+         this->OutputFile = argv[++i];
+      }
+      else if( i + 1 < argc and Argument == "--width" ){
+         this->Szerokosc = atoi( argv[++i] );
+      }
+      else if( i + 1 < argc and Argument == "--height" ){
+         this->Wysokosc = atoi( argv[++i] );
+      }
+      else if( i + 1 < argc and Argument == "--bench" ){
+         this->BenchFrames = atoi( argv[++i] );
+      }
+      else if( i + 1 < argc and Argument == "--bench-output" ){
+         this->BenchOutput = argv[++i];
+      }
+      else if( Argument == "--no-cache" ){
+         MeshCache::Enable( false );
+      }
+      else if( Argument == "--gpu-profile" ){
+         this->GpuProfile = true;
+      }
+      else if( i + 1 < argc and Argument == "--trace" ){
+         this->TraceFile = argv[++i];
+      }
+      else if( i + 1 < argc and Argument == "--threads" ){
+         this->Threads = atoi( argv[++i] );
+      }
+      else if( i + 1 < argc and Argument == "--vertex-format" ){
+         string Format = argv[++i];
+         if( Format == "float" ){
+            Mesh::SetVertexFormat( VERTEX_FLOAT );
+         }
+         else if( Format == "packed" ){
+            Mesh::SetVertexFormat( VERTEX_PACKED );
+         }
+         else{
+            cout<<"Unknown vertex format: "<<Format<<"\n";
+            this->CheckInit = false;
+            return;
+         }
+      }
+      else if( Argument == "--no-texture-compress" ){
+         this->TextureCompress = false;
+      }
+      else if( Argument == "--texture-hash" ){
+         TextureCache::EnableHash( true );
+      }
+      else if( i + 1 < argc and Argument == "--stream-budget" ){
+         this->StreamBudget = atof( argv[++i] );
+      }
+      else if( Argument == "--indirect" ){
+         this->Indirect = true;
+      }
+      else if( Argument == "--no-cull" ){
+         this->culler.SetEnabled( false );
+      }
+      else if( Argument == "--no-bvh" ){
+         this->UseBVH = false;
+      }
+      else if( Argument == "--occlusion" ){
+         this->Occlusion = true;
+      }
+      else if( Argument == "--no-lod" ){
+         this->lods.SetEnabled( false );
+      }
+      else if( i + 1 < argc and Argument == "--lod-threshold" ){
+         this->lods.SetThreshold( atof( argv[++i] ) );
+      }
+      else if( Argument == "--no-clusters" ){
+         this->clusters.SetEnabled( false );
+      }
+      else if( Argument == "--on-demand" ){
+         this->OnDemand = true;
+      }
+      else{
+         cout<<"Unknown argument: "<<Argument<<"\n";
+         this->CheckInit = false;
+         return;
+      }
+   }
+   if( this->Frames < 1 or this->Szerokosc < 1 or this->Wysokosc < 1 or this->BenchFrames < 0 or this->Threads < 0 or this->StreamBudget < 0.0 ){
+      cout<<"Wrong argument value\n";
+      this->CheckInit = false;
    }
 }
@@ -5,6 +5,105 @@
 #ifndef __mesh_hpp__
 #define __mesh_hpp__
 
+/*!
+   \brief Największa ilość zapamiętanych zmian brył otaczających ( \link Mesh::ReturnChanges() \endlink ), przy większej sprawdzane są wszystkie obiekty.
+*/
+#define MESH_CHANGES_LIMIT 65536
+
+class Mesh;
+
+/*!
+   \brief Zmiana bryły otaczającej jednej instancji wczytanego obiektu.
+*/
+struct MeshChange{
+   /*!
+      \brief Obiekt.
+   */
+   const Mesh *Item;
+   /*!
+      \brief Numer instancji.
+   */
+   GLsizei Instance;
+};
+
+/*!
+   \brief Dane obiektu wczytane przez CPU, czekające na przekazanie do OpenGL.
+*/
+struct MeshStaging{
+   /*!
+      \brief Zmapowany plik pamięci podręcznej (gdy dane pochodzą z niej).
+   */
+   MeshCacheFile Cache;
+   /*!
+      \brief Wierzchołki przeplatane (gdy brak pamięci podręcznej).
+   */
+   vector <Vertex> Vertices;
+   /*!
+      \brief Wierzchołki kwantyzowane (gdy brak pamięci podręcznej i format \link VERTEX_PACKED \endlink ).
+   */
+   vector <PackedVertex> PackedVertices;
+   /*!
+      \brief Indeksy wierzchołków wczytane przez assimp.
+   */
+   vector <GLuint> Indices;
+   /*!
+      \brief Indeksy wierzchołków 16 bitów (gdy każda część obiektu ma najwyżej 65536 wierzchołków).
+   */
+   vector <uint16_t> ShortIndices;
+   /*!
+      \brief Wskaźnik do wierzchołków w formacie \link Mesh::Format \endlink (w pliku cache lub w \link Vertices \endlink / \link PackedVertices \endlink ).
+   */
+   const void *VertexData = NULL;
+   /*!
+      \brief Wskaźnik do indeksów wierzchołków (typu \link IndexType \endlink ).
+   */
+   const void *IndexData = NULL;
+   /*!
+      \brief Typ indeksów wierzchołków: GL_UNSIGNED_INT lub GL_UNSIGNED_SHORT.
+   */
+   GLenum IndexType = GL_UNSIGNED_INT;
+   /*!
+      \brief Przeliczenie kwantyzowanej pozycji.
+   */
+   VertexQuantization Quantization;
+   /*!
+      \brief Bryły otaczające obiekt.
+   */
+   MeshBounds Bounds;
+   /*!
+      \brief Ilość wierzchołków.
+   */
+   uint64_t VertexCount = 0;
+   /*!
+      \brief Ilość indeksów wierzchołków.
+   */
+   uint64_t IndexCount = 0;
+   /*!
+      \brief TRUE = dane pochodzą z pamięci podręcznej.
+   */
+   bool FromCache = false;
+   /*!
+      \brief Części obiektu, \link MeshPart::Material \endlink to numer pary tekstur w \link Mesh::TexturePaths \endlink.
+   */
+   vector <MeshPart> Parts;
+   /*!
+      \brief Poziomy szczegółowości (LOD), części kolejnych poziomów w \link Parts \endlink.
+   */
+   vector <MeshLod> Lods;
+   /*!
+      \brief Grupy trójkątów części poziomu 0.
+   */
+   vector <MeshCluster> Clusters;
+   /*!
+      \brief Materiały obiektu.
+   */
+   vector <MeshMaterial> Materials;
+   /*!
+      \brief Zdekodowane tekstury dla \link Mesh::TexturePaths \endlink (wspólne w \link TextureCache \endlink ), puste gdy tekstura już istnieje.
+   */
+   vector < shared_ptr <const ImageData> > Images;
+};
+
 /*!
    \brief klasa odpowiedzialny zarządzanie obiektami 3D.
 */
@@ -29,17 +128,110 @@ class Mesh{
       */
       Mesh & operator=( const Mesh &mesh );
       /*!
-         \brief Zwraca identyfikator głównej tekstury ( \link Texture \endlink ).
+         \brief Zwraca identyfikator głównej tekstury materiału ( \link Textures \endlink ).
+
+         \param material - numer pary tekstur ( \link MeshPart::Material \endlink ), 0 = tekstura z pliku data.init
+      */
+      GLuint ReturnTexture( GLuint material = 0 ) const;
+      /*!
+         \brief Zwraca identyfikator spektralnej tekstury materiału ( \link Textures \endlink ).
+
+         \param material - numer pary tekstur ( \link MeshPart::Material \endlink ), 0 = tekstura z pliku data.init
+      */
+      GLuint ReturnTextureSpecular( GLuint material = 0 ) const;
+      /*!
+         \brief Zwraca identyfikator geometrii we wspólnych buforach ( \link Geometry \endlink ).
+      */
+      GLuint ReturnGeometry() const;
+      /*!
+         \brief Zwraca części obiektu wszystkich poziomów szczegółowości ( \link Parts \endlink ).
       */
-      GLuint ReturnTexture() const;
+      const vector <MeshPart> & ReturnParts() const;
       /*!
-         \brief Zwraca identyfikator spektralnej tekstury ( \link TextureSpecular \endlink ).
+         \brief Zwraca poziomy szczegółowości ( \link Lods \endlink ), poziom 0 zawsze istnieje dla wczytanego obiektu.
       */
-      GLuint ReturnTextureSpecular() const;
+      const vector <MeshLod> & ReturnLods() const;
+      /*!
+         \brief Zwraca grupy trójkątów części poziomu 0 ( \link Clusters \endlink ).
+      */
+      const vector <MeshCluster> & ReturnClusters() const;
+      /*!
+         \brief Zwraca typ indeksów wierzchołków ( \link IndexType \endlink ).
+      */
+      GLenum ReturnIndexType() const;
       /*!
          \brief Zwraca macierz modelu ( \link ModelMatrix \endlink ).
       */
       mat4 ReturnModelMatrix() const;
+      /*!
+         \brief Zwraca macierz normalnych ( \link NormalMatrix \endlink ).
+      */
+      mat3 ReturnNormalMatrix() const;
+      /*!
+         \brief Zwraca ilość trójkątów obiektu (jednej instancji).
+
+         \param lod - poziom szczegółowości
+      */
+      GLsizei ReturnTriangles( GLuint lod = 0 ) const;
+      /*!
+         \brief Zwraca ilość instancji obiektu (1 + \link Instances \endlink ).
+      */
+      GLsizei ReturnInstanceCount() const;
+      /*!
+         \brief Zwraca macierz modelu instancji.
+
+         \param instance - numer instancji, 0 = \link ModelMatrix \endlink
+      */
+      mat4 ReturnInstanceMatrix( GLsizei instance ) const;
+      /*!
+         \brief Zwraca macierz normalnych instancji.
+
+         \param instance - numer instancji, 0 = \link NormalMatrix \endlink
+      */
+      mat3 ReturnInstanceNormalMatrix( GLsizei instance ) const;
+      /*!
+         \brief Zwraca bryły otaczające obiekt we współrzędnych obiektu ( \link Bounds \endlink ).
+      */
+      const MeshBounds & ReturnBounds() const;
+      /*!
+         \brief Zwraca bryły otaczające instancję w świecie (aktualizowane przy zmianie macierzy modelu).
+
+         \param instance - numer instancji, 0 = \link ModelMatrix \endlink
+      */
+      const MeshBounds & ReturnWorldBounds( GLsizei instance ) const;
+      /*!
+         \brief Zwraca wersję brył otaczających w świecie (zwiększana przy każdej zmianie, np. dla \link SceneBVH \endlink ).
+      */
+      unsigned long ReturnBoundsVersion() const;
+      /*!
+         \brief Zwraca wersję sceny ( \link SceneVersion \endlink ), zwiększaną przy każdej zmianie brył otaczających dowolnego obiektu (również po wczytaniu).
+      */
+      static unsigned long ReturnSceneVersion();
+      /*!
+         \brief Zwraca wersję zbioru instancji ( \link LayoutVersion \endlink ), zwiększaną po wczytaniu obiektu i dodaniu instancji.
+      */
+      static unsigned long ReturnLayoutVersion();
+      /*!
+         \brief Przekazuje zmiany brył otaczających instancji wczytanych obiektów od poprzedniego wywołania (np. dla \link SceneBVH \endlink ) i je czyści.
+
+         \param changes - zmiany (zastępowane)
+         \return - wartość logiczną, FALSE = zmian było więcej niż \link MESH_CHANGES_LIMIT \endlink (lista niepełna, trzeba sprawdzić wszystkie obiekty)
+      */
+      static bool ReturnChanges( vector <MeshChange> &changes );
+      /*!
+         \brief Dodaje instancję obiektu (ta sama geometria i tekstury, inna macierz modelu).
+
+         \param matrix - macierz modelu instancji (w świecie, niezależna od \link ModelMatrix \endlink )
+      */
+      void AddInstance( mat4 matrix );
+      /*!
+         \brief Zwraca ilość wywołań rysowania obiektu (jedno na część poziomu szczegółowości).
+      */
+      GLsizei ReturnDraws() const;
+      /*!
+         \brief Zwraca nazwę obiektu ( \link Name \endlink ).
+      */
+      string ReturnName() const;
       /*!
          \brief Ustala nową ścieżkę dla pliku .obj oraz głównej i spektralnej tekstury.
 
@@ -63,16 +255,72 @@ class Mesh{
       void SetModelMatrix( vec3 vector_translate );
       /*!
          \brief Wczytuje plik .obj, teksture główną i spektralną do pamięci.
+
+         Plik .obj wczytywany jest z pamięci podręcznej ( \link MeshCacheFile \endlink ), gdy jest aktualna.
+         W przeciwnym wypadku wczytywany jest przez assimp i zapisywany do pamięci podręcznej.
       */
       void LoadData();
       /*!
-         \brief Tworzy VAO (Vertex Array Object).
+         \brief Część wczytywania wykonywana przez CPU: plik .obj (pamięć podręczna lub assimp) i dekodowanie tekstur.
+
+         \return - wartość logiczną dla wczytywania, FALSE = błąd
+
+         Nie wywołuje funkcji OpenGL, więc może działać w wątku roboczym. Dane czekają w \link Staging \endlink.
+      */
+      bool LoadCPU();
+      /*!
+         \brief Część wczytywania wykonywana przez OpenGL: tworzy tekstury i kopiuje geometrię do wspólnych buforów z danych \link Staging \endlink.
+
+         \param uploader - bufory pikseli dla tekstur, NULL = tekstury przekazywane bezpośrednio
+         \param deadline - koniec budżetu czasu klatki (SDL_GetPerformanceCounter), 0 = bez ograniczenia
+         \return - TRUE = zakończone (także z błędem), FALSE = brak wolnego bufora pikseli lub koniec budżetu, wywołać ponownie w kolejnej klatce
+
+         Wywoływać tylko w wątku z kontekstem OpenGL, po \link LoadCPU() \endlink.
+         Budżet sprawdzany jest przed każdą teksturą i przed geometrią, po co najmniej jednym kroku w wywołaniu (zawsze jest postęp).
+      */
+      bool LoadGPU( TextureUploader *uploader = NULL, Uint64 deadline = 0 );
+      /*!
+         \brief Zwraca TRUE, gdy obiekt jest wczytany i może być rysowany.
+      */
+      bool IsLoaded() const;
+      /*!
+         \brief Kopiuje wierzchołki i indeksy do wspólnych buforów ( \link GeometryArena \endlink ).
+
+         \param vertices - wskaźnik do wierzchołków w formacie \link Format \endlink
+         \param vertex_count - ilość wierzchołków
+         \param indices - wskaźnik do indeksów wierzchołków
+         \param index_count - ilość indeksów wierzchołków
+         \param index_type - typ indeksów wierzchołków: GL_UNSIGNED_INT lub GL_UNSIGNED_SHORT
+      */
+      void BindGeometry( const void *vertices, GLsizei vertex_count, const void *indices, GLsizei index_count, GLenum index_type );
+      /*!
+         \brief Zwraca przeliczenie kwantyzowanej pozycji ( \link Quantization \endlink ), dla formatu \link VERTEX_FLOAT \endlink skala 1 i przesunięcie 0.
+      */
+      const VertexQuantization & ReturnQuantization() const;
+      /*!
+         \brief Ustala format wierzchołków dla wczytywanych obiektów.
+
+         \param format - format wierzchołków
+      */
+      static void SetVertexFormat( VertexFormat format );
+      /*!
+         \brief Rysuje obiekt (poziom szczegółowości 0).
+
+         \param instances - ilość instancji, powyżej 1 rysowanie przez glDrawElementsInstancedBaseVertex (macierze instancji przypina wywołujący)
+
+         Wymaga przypiętego wspólnego VAO ( \link GeometryArena::Bind() \endlink ).
+         Tekstury (jednostki 0 i 1) zmieniane są tylko przy zmianie materiału.
       */
-      void BindVAO();
+      void Draw( GLsizei instances = 1 );
       /*!
-         \brief Rysuje obiekt.
+         \brief Rysuje jedną część obiektu, bez przypinania tekstur.
+
+         \param part - numer części ( \link Parts \endlink )
+         \param instances - ilość instancji, powyżej 1 rysowanie przez glDrawElementsInstancedBaseVertex
+
+         Wymaga przypiętego wspólnego VAO i tekstur materiału części.
       */
-      void Draw();
+      void DrawPart( GLuint part, GLsizei instances = 1 ) const;
       /*!
          \brief Translacja macierzy modelu ( \link ModelMatrix \endlink ).
 
@@ -94,53 +342,75 @@ class Mesh{
       void Scale( vec3 vector_scale );
    private:
       /*!
-         \brief Nazwa obiektu.
+         \brief Przelicza \link NormalMatrix \endlink po zmianie \link ModelMatrix \endlink.
       */
-      string Name;
+      void UpdateNormalMatrix();
       /*!
-         \brief Wektor Wierzchołków.
+         \brief Przelicza bryły otaczające instancji w świecie ( \link WorldBounds \endlink ).
+
+         \param instance - numer instancji, 0 = \link ModelMatrix \endlink
       */
-      vector <vec3> Vertices;
+      void UpdateWorldBounds( GLsizei instance );
       /*!
-         \brief Wektor UV Map.
+         \brief Optymalizacja obiektu wczytanego przez assimp: łączenie wierzchołków, kolejność trójkątów i wierzchołków, uproszczone poziomy szczegółowości.
+
+         \param vertices - wierzchołki przeplatane
+         \param indices - indeksy wierzchołków
+         \param parts - części obiektu, każda optymalizowana osobno, części uproszczonych poziomów dopisywane są na końcu
+         \param lods - wynik, poziomy szczegółowości
+         \param clusters - wynik, grupy trójkątów części poziomu 0
+
+         Wypisuje ACMR przed i po optymalizacji, ilość trójkątów poziomów i ilość grup.
       */
-      vector <vec2> Uvs;
+      void Optimize( vector <Vertex> &vertices, vector <GLuint> &indices, vector <MeshPart> &parts, vector <MeshLod> &lods, vector <MeshCluster> &clusters );
+      /*!
+         \brief Ustala \link TexturePaths \endlink: para tekstur z pliku data.init, potem pary tekstur materiałów.
+
+         \param data - dane CPU, numery materiałów części zamieniane są na numery par tekstur
+
+         Materiał bez tekstury (lub z nieistniejącym plikiem) używa tekstur z pliku data.init.
+      */
+      void SetMaterials( MeshStaging &data );
+      /*!
+         \brief Nazwa obiektu.
+      */
+      string Name;
       /*!
-         \brief Wektor Normalnych.
+         \brief Ilość Indeksów Wierzchołków.
       */
-      vector <vec3> Normals;
+      GLsizei IndexCount = 0;
       /*!
-         \brief Wektor Indeksów Wierzchołków.
+         \brief Typ Indeksów Wierzchołków: GL_UNSIGNED_INT lub GL_UNSIGNED_SHORT.
       */
-      vector <GLuint> Indices;
+      GLenum IndexType = GL_UNSIGNED_INT;
       /*!
-         \brief Identyfikator VAO (Vertex Array Object).
+         \brief Identyfikator geometrii we wspólnych buforach ( \link GeometryArena \endlink ), 0 = brak.
       */
-      GLuint VAO;
+      GLuint Geometry = 0;
       /*!
-         \brief Identyfikator Wierzchołków.
+         \brief Przeliczenie kwantyzowanej pozycji (dla formatu \link VERTEX_PACKED \endlink ).
       */
-      GLuint VertexBuffer;
+      VertexQuantization Quantization = { vec3( 1.0f ), vec3( 0.0f ) };
       /*!
-         \brief Identyfikator UV Map.
+         \brief Części obiektu we wspólnych buforach: części poziomu 0 posortowane według materiału, potem części kolejnych poziomów szczegółowości.
       */
-      GLuint UvBuffer;
+      vector <MeshPart> Parts;
       /*!
-         \brief Identyfikator Normalnych.
+         \brief Poziomy szczegółowości (LOD).
       */
-      GLuint NormalBuffer;
+      vector <MeshLod> Lods;
       /*!
-         \brief Identyfikator Indeksów Wierzchołków.
+         \brief Grupy trójkątów części poziomu 0 (puste = obiekt rysowany całymi częściami).
       */
-      GLuint IndicesBuffer;
+      vector <MeshCluster> Clusters;
       /*!
-         \brief Identyfikator głównej tekstury.
+         \brief Ścieżki tekstur, po dwie (główna i spektralna) na materiał, para 0 z pliku data.init.
       */
-      GLuint Texture;
+      vector <string> TexturePaths;
       /*!
-         \brief Identyfikator spektralnej tekstury.
+         \brief Identyfikatory tekstur dla \link TexturePaths \endlink.
       */
-      GLuint TextureSpecular;
+      vector <GLuint> Textures;
       /*!
          \brief Ścieżka do pliku .obj.
       */
@@ -157,10 +427,62 @@ class Mesh{
          \brief Macierz modelu.
       */
       mat4 ModelMatrix;
+      /*!
+         \brief Macierze modelu kolejnych instancji (bez pierwszej, którą jest \link ModelMatrix \endlink ).
+      */
+      vector <mat4> Instances;
+      /*!
+         \brief Macierz normalnych: transpozycja odwrotności części 3x3 \link ModelMatrix \endlink (liczona na CPU, nie w shaderze).
+      */
+      mat3 NormalMatrix = mat3( 1.0f );
+      /*!
+         \brief Macierze normalnych kolejnych instancji (dla \link Instances \endlink ).
+      */
+      vector <mat3> InstanceNormals;
+      /*!
+         \brief Bryły otaczające we współrzędnych obiektu (liczone przy wczytaniu, zapisane w pamięci podręcznej).
+      */
+      MeshBounds Bounds = { vec3( 0.0f ), vec3( 0.0f ), vec3( 0.0f ), 0.0f };
+      /*!
+         \brief Bryły otaczające każdej instancji w świecie.
+      */
+      vector <MeshBounds> WorldBounds;
+      /*!
+         \brief Wersja \link WorldBounds \endlink.
+      */
+      unsigned long BoundsVersion = 0;
       /*!
          \brief Poprawność zainicjalizowanych wszystkich elementów. FALSE = Błąd.
       */
       bool Init = false;
+      /*!
+         \brief Obiekt jest w pamięci OpenGL i może być rysowany. TRUE = wczytany.
+      */
+      bool Loaded = false;
+      /*!
+         \brief Dane wczytane przez CPU, czekające na \link LoadGPU() \endlink. NULL = brak.
+      */
+      MeshStaging *Staging = NULL;
+      /*!
+         \brief Format wierzchołków wczytywanych obiektów, domyślnie \link VERTEX_FLOAT \endlink.
+      */
+      static VertexFormat Format;
+      /*!
+         \brief Wersja sceny: suma zmian \link BoundsVersion \endlink wszystkich obiektów (zmiany tylko w wątku głównym).
+      */
+      static unsigned long SceneVersion;
+      /*!
+         \brief Wersja zbioru instancji wczytanych obiektów (zmiany tylko w wątku głównym).
+      */
+      static unsigned long LayoutVersion;
+      /*!
+         \brief Zmiany brył otaczających od ostatniego \link ReturnChanges() \endlink.
+      */
+      static vector <MeshChange> Changes;
+      /*!
+         \brief TRUE = \link Changes \endlink przepełnione (pominięte zmiany).
+      */
+      static bool ChangesOverflow;
 };
 
 /*
@@ -169,70 +491,199 @@ class Mesh{
    ========
 */
 
+VertexFormat Mesh::Format = VERTEX_FLOAT;
+
+unsigned long Mesh::SceneVersion = 0;
+
+unsigned long Mesh::LayoutVersion = 0;
+
+vector <MeshChange> Mesh::Changes;
+
+bool Mesh::ChangesOverflow = false;
+
 Mesh::Mesh(){
 }
 
 Mesh::~Mesh(){
-   glDeleteTextures( 1, &this->Texture );
-   glDeleteTextures( 1, &this->TextureSpecular );
-   glDeleteBuffers( 1, &this->VertexBuffer );
-   glDeleteBuffers( 1, &this->UvBuffer );
-   glDeleteBuffers( 1, &this->NormalBuffer );
-   glDeleteBuffers( 1, &this->IndicesBuffer );
-   glDeleteVertexArrays( 1, &this->VAO );
+   for( unsigned int i = 0; i < this->Textures.size(); ++i ){
+      TextureCache::Release( this->Textures[i] );
+   }
+   GeometryArena::Release( this->Geometry );
+   delete this->Staging;
 }
 
 Mesh::Mesh( const Mesh &mesh ){
    this->Name = mesh.Name;
-   this->Vertices = mesh.Vertices;
-   this->Uvs = mesh.Uvs;
-   this->Normals = mesh.Normals;
-   this->Indices = mesh.Indices;
-   this->VAO = mesh.VAO;
-   this->VertexBuffer = mesh.VertexBuffer;
-   this->UvBuffer = mesh.UvBuffer;
-   this->NormalBuffer = mesh.NormalBuffer;
-   this->IndicesBuffer = mesh.IndicesBuffer;
-   this->Texture = mesh.Texture;
-   this->TextureSpecular = mesh.TextureSpecular;
+   this->IndexCount = mesh.IndexCount;
+   this->IndexType = mesh.IndexType;
+   this->Geometry = mesh.Geometry;
+   GeometryArena::Retain( this->Geometry );
+   this->Quantization = mesh.Quantization;
+   this->Parts = mesh.Parts;
+   this->Lods = mesh.Lods;
+   this->Clusters = mesh.Clusters;
+   this->TexturePaths = mesh.TexturePaths;
+   this->Textures = mesh.Textures;
+   for( unsigned int i = 0; i < this->Textures.size(); ++i ){
+      TextureCache::Retain( this->Textures[i] );
+   }
    this->OBJPathFile = mesh.OBJPathFile;
    this->ImgPathFile = mesh.ImgPathFile;
    this->ImgSpecPathFile = mesh.ImgSpecPathFile;
    this->ModelMatrix = mesh.ModelMatrix;
+   this->Instances = mesh.Instances;
+   this->NormalMatrix = mesh.NormalMatrix;
+   this->InstanceNormals = mesh.InstanceNormals;
+   this->Bounds = mesh.Bounds;
+   this->WorldBounds = mesh.WorldBounds;
+   this->BoundsVersion = mesh.BoundsVersion;
+   this->Init = mesh.Init;
+   this->Loaded = mesh.Loaded;
+   /*
+      Dane CPU nie są kopiowane, istnieją tylko w trakcie wczytywania.
+   */
+   this->Staging = NULL;
 }
 
 Mesh & Mesh::operator=( const Mesh &mesh ){
    this->Name = mesh.Name;
-   this->Vertices = mesh.Vertices;
-   this->Uvs = mesh.Uvs;
-   this->Normals = mesh.Normals;
-   this->Indices = mesh.Indices;
-   this->VAO = mesh.VAO;
-   this->VertexBuffer = mesh.VertexBuffer;
-   this->UvBuffer = mesh.UvBuffer;
-   this->NormalBuffer = mesh.NormalBuffer;
-   this->IndicesBuffer = mesh.IndicesBuffer;
-   this->Texture = mesh.Texture;
-   this->TextureSpecular = mesh.TextureSpecular;
+   this->IndexCount = mesh.IndexCount;
+   this->IndexType = mesh.IndexType;
+   GeometryArena::Retain( mesh.Geometry );
+   GeometryArena::Release( this->Geometry );
+   this->Geometry = mesh.Geometry;
+   this->Quantization = mesh.Quantization;
+   /*
+      Tekstury są wspólne, najpierw zwiększenie licznika nowych (gdy to te same tekstury).
+   */
+   for( unsigned int i = 0; i < mesh.Textures.size(); ++i ){
+      TextureCache::Retain( mesh.Textures[i] );
+   }
+   for( unsigned int i = 0; i < this->Textures.size(); ++i ){
+      TextureCache::Release( this->Textures[i] );
+   }
+   this->Parts = mesh.Parts;
+   this->Lods = mesh.Lods;
+   this->Clusters = mesh.Clusters;
+   this->TexturePaths = mesh.TexturePaths;
+   this->Textures = mesh.Textures;
    this->OBJPathFile = mesh.OBJPathFile;
    this->ImgPathFile = mesh.ImgPathFile;
    this->ImgSpecPathFile = mesh.ImgSpecPathFile;
    this->ModelMatrix = mesh.ModelMatrix;
+   this->Instances = mesh.Instances;
+   this->NormalMatrix = mesh.NormalMatrix;
+   this->InstanceNormals = mesh.InstanceNormals;
+   this->Bounds = mesh.Bounds;
+   this->WorldBounds = mesh.WorldBounds;
+   this->BoundsVersion = mesh.BoundsVersion;
+   this->Init = mesh.Init;
+   this->Loaded = mesh.Loaded;
    return *this;
 }
 
-GLuint Mesh::ReturnTexture() const{
-   return this->Texture;
+GLuint Mesh::ReturnTexture( GLuint material ) const{
+   return this->Textures.size() > 2 * material ? this->Textures[ 2 * material ] : 0;
+}
+
+GLuint Mesh::ReturnTextureSpecular( GLuint material ) const{
+   return this->Textures.size() > 2 * material + 1 ? this->Textures[ 2 * material + 1 ] : 0;
+}
+
+GLuint Mesh::ReturnGeometry() const{
+   return this->Geometry;
+}
+
+const vector <MeshPart> & Mesh::ReturnParts() const{
+   return this->Parts;
 }
 
-GLuint Mesh::ReturnTextureSpecular() const{
-   return this->TextureSpecular;
+const vector <MeshLod> & Mesh::ReturnLods() const{
+   return this->Lods;
+}
+
+const vector <MeshCluster> & Mesh::ReturnClusters() const{
+   return this->Clusters;
+}
+
+GLenum Mesh::ReturnIndexType() const{
+   return this->IndexType;
 }
 
 mat4 Mesh::ReturnModelMatrix() const{
    return this->ModelMatrix;
 }
 
+mat3 Mesh::ReturnNormalMatrix() const{
+   return this->NormalMatrix;
+}
+
+GLsizei Mesh::ReturnTriangles( GLuint lod ) const{
+   if( lod >= this->Lods.size() ){
+      return 0;
+   }
+   GLsizei Indices = 0;
+   for( GLuint i = 0; i < this->Lods[ lod ].PartCount; ++i ){
+      Indices += this->Parts[ this->Lods[ lod ].FirstPart + i ].IndexCount;
+   }
+   return Indices / 3;
+}
+
+GLsizei Mesh::ReturnInstanceCount() const{
+   return 1 + this->Instances.size();
+}
+
+mat4 Mesh::ReturnInstanceMatrix( GLsizei instance ) const{
+   return ( instance == 0 ) ? this->ModelMatrix : this->Instances[ instance - 1 ];
+}
+
+mat3 Mesh::ReturnInstanceNormalMatrix( GLsizei instance ) const{
+   return ( instance == 0 ) ? this->NormalMatrix : this->InstanceNormals[ instance - 1 ];
+}
+
+void Mesh::AddInstance( mat4 matrix ){
+   this->Instances.push_back( matrix );
+   this->InstanceNormals.push_back( transpose( inverse( mat3( matrix ) ) ) );
+   this->UpdateWorldBounds( this->Instances.size() );
+   ++Mesh::LayoutVersion;
+}
+
+const MeshBounds & Mesh::ReturnBounds() const{
+   return this->Bounds;
+}
+
+const MeshBounds & Mesh::ReturnWorldBounds( GLsizei instance ) const{
+   return this->WorldBounds[ instance ];
+}
+
+unsigned long Mesh::ReturnBoundsVersion() const{
+   return this->BoundsVersion;
+}
+
+unsigned long Mesh::ReturnSceneVersion(){
+   return Mesh::SceneVersion;
+}
+
+unsigned long Mesh::ReturnLayoutVersion(){
+   return Mesh::LayoutVersion;
+}
+
+bool Mesh::ReturnChanges( vector <MeshChange> &changes ){
+   bool Complete = ! Mesh::ChangesOverflow;
+   changes.clear();
+   changes.swap( Mesh::Changes );
+   Mesh::ChangesOverflow = false;
+   return Complete;
+}
+
+GLsizei Mesh::ReturnDraws() const{
+   return this->Lods.empty() ? 0 : this->Lods[0].PartCount;
+}
+
+string Mesh::ReturnName() const{
+   return this->Name;
+}
+
 void Mesh::SetString( string name, string obj, string img, string spec ){
    this->Name = name;
    this->OBJPathFile = obj;
@@ -242,157 +693,466 @@ void Mesh::SetString( string name, string obj, string img, string spec ){
 
 void Mesh::SetModelMatrix( mat4 matrix ){
    this->ModelMatrix = matrix;
+   this->UpdateNormalMatrix();
+   this->UpdateWorldBounds( 0 );
 }
 
 void Mesh::SetModelMatrix( vec3 vector_translate ){
    this->ModelMatrix = translate( mat4( 1.0f ), vector_translate );
+   this->NormalMatrix = mat3( 1.0f );
+   this->UpdateWorldBounds( 0 );
 }
 
 void Mesh::LoadData(){
+   PROFILE_SCOPE_DETAIL( "Mesh::LoadData", this->Name );
+   this->LoadCPU();
+   this->LoadGPU();
+}
+
+bool Mesh::LoadCPU(){
+   PROFILE_SCOPE_DETAIL( "Mesh::LoadCPU", this->Name );
    if( OBJPathFile.empty() or ImgPathFile.empty() or ImgSpecPathFile.empty() ){
       cout<<"Set string!";
-      return;
+      return false;
    }
-   else{
-      this->Init = LoadAssimp( this->OBJPathFile.c_str(), this->Vertices, this->Uvs, this->Normals, this->Indices );
-      if( ! this->Init ){
-         return;
-      }
-      this->Init = LoadImg( this->ImgPathFile.c_str(), this->Texture );
-      if( ! this->Init ){
-         return;
+   delete this->Staging;
+   this->Staging = new MeshStaging();
+   MeshStaging &Data = *this->Staging;
+   /*
+      Najpierw pamięć podręczna: dane zostają w zmapowanym pliku i trafiają prosto do glBufferData.
+      Plik zawiera wierzchołki tylko w jednym formacie, inny format oznacza ponowne wczytanie.
+   */
+   bool Packed = Mesh::Format == VERTEX_PACKED;
+   GLsizei Stride = ReturnVertexStride( Mesh::Format );
+   const VertexQuantization *Quantization = NULL;
+   uint64_t QuantizationCount = 0;
+   const MeshPart *Parts = NULL;
+   uint64_t PartCount = 0;
+   const MeshBounds *Bounds = NULL;
+   uint64_t BoundsCount = 0;
+   const MeshLod *Lods = NULL;
+   uint64_t LodCount = 0;
+   const MeshCluster *Clusters = NULL;
+   uint64_t ClusterCount = 0;
+   if( Data.Cache.Open( this->OBJPathFile ) ){
+      Data.VertexData = Data.Cache.ReturnSection( Packed ? MESH_CACHE_PACKED_VERTICES : MESH_CACHE_VERTICES, Stride, Data.VertexCount );
+      Data.IndexData = Data.Cache.ReturnSection( MESH_CACHE_INDICES, sizeof( GLuint ), Data.IndexCount );
+      if( Data.IndexData == NULL ){
+         Data.IndexData = Data.Cache.ReturnSection( MESH_CACHE_INDICES, sizeof( uint16_t ), Data.IndexCount );
+         Data.IndexType = GL_UNSIGNED_SHORT;
       }
-      this->Init = LoadImg( this->ImgSpecPathFile.c_str(), this->TextureSpecular );
-      if( ! this->Init ){
-         return;
+      if( Packed ){
+         Quantization = (const VertexQuantization *)Data.Cache.ReturnSection( MESH_CACHE_QUANTIZATION, sizeof( VertexQuantization ), QuantizationCount );
       }
-      this->BindVAO();
-      cout<<"Name: \""<<this->Name<<"\" success load.\n";
-   }
-}
-
-void Mesh::BindVAO(){
-   if( this->Init ){
-      /*
-         Stworzenie identyfikator dla AVO
-      */
-      glGenVertexArrays( 1, &this->VAO );
-      /*
-         Stworzenie identyfikator dla wierzchołków
-      */
-      glGenBuffers( 1, &this->VertexBuffer );
-      /*
-         Stworzenie identyfikator dla UV Map
-      */
-      glGenBuffers( 1, &this->UvBuffer );
-      /*
-         Stworzenie identyfikator dla Normalnych
-      */
-      glGenBuffers( 1, &this->NormalBuffer );
-      /*
-         Stworzenie identyfikator dla kolejności trójkątów
-      */
-      glGenBuffers( 1, &this->IndicesBuffer );
-
-      //Vertex:
-      /*
-         Przygotowanie buffora.
-      */
-      glBindBuffer( GL_ARRAY_BUFFER, this->VertexBuffer );
+      Parts = (const MeshPart *)Data.Cache.ReturnSection( MESH_CACHE_PARTS, sizeof( MeshPart ), PartCount );
+      Bounds = (const MeshBounds *)Data.Cache.ReturnSection( MESH_CACHE_BOUNDS, sizeof( MeshBounds ), BoundsCount );
+      Lods = (const MeshLod *)Data.Cache.ReturnSection( MESH_CACHE_LODS, sizeof( MeshLod ), LodCount );
+      Clusters = (const MeshCluster *)Data.Cache.ReturnSection( MESH_CACHE_CLUSTERS, sizeof( MeshCluster ), ClusterCount );
       /*
-         Wypełnienie bufora danymi z wierzchołków.
+         Części muszą mieścić się w buforach, a ich indeksy wskazywać wierzchołki części (uszkodzony plik = ponowne wczytanie).
+         Suma kontrolna nie obejmuje danych sekcji, indeksy są czytane raz przy wczytaniu (grupy i poziomy leżą w częściach).
       */
-      glBufferData( GL_ARRAY_BUFFER, this->Vertices.size() * sizeof( vec3 ), &this->Vertices[0], GL_STATIC_DRAW );
-
-      //Uv:
+      for( uint64_t i = 0; i < PartCount and Parts != NULL; ++i ){
+         if( (uint64_t)Parts[i].FirstIndex + Parts[i].IndexCount > Data.IndexCount
+             or (uint64_t)Parts[i].BaseVertex + Parts[i].VertexCount > Data.VertexCount
+             or ( Parts[i].IndexCount > 0 and ReturnMaxIndex( Data.IndexData, Data.IndexType, Parts[i].FirstIndex, Parts[i].IndexCount ) >= Parts[i].VertexCount ) ){
+            Parts = NULL;
+         }
+      }
       /*
-         Przygotowanie buffora.
+         Poziomy szczegółowości muszą wskazywać istniejące części.
       */
-      glBindBuffer( GL_ARRAY_BUFFER, this->UvBuffer );
+      for( uint64_t i = 0; i < LodCount and Lods != NULL; ++i ){
+         if( (uint64_t)Lods[i].FirstPart + Lods[i].PartCount > PartCount ){
+            Lods = NULL;
+         }
+      }
       /*
-         Wypełnienie bufora danymi z uv mapami.
+         Grupy muszą leżeć w częściach poziomu 0.
       */
-      glBufferData( GL_ARRAY_BUFFER, this->Uvs.size() * sizeof( vec2 ), &this->Uvs[0], GL_STATIC_DRAW );
-
-      //Normal:
+      for( uint64_t i = 0; i < ClusterCount and Clusters != NULL and Parts != NULL and Lods != NULL and LodCount > 0; ++i ){
+         if( Clusters[i].Part >= Lods[0].PartCount
+             or Clusters[i].FirstIndex < Parts[ Clusters[i].Part ].FirstIndex
+             or (uint64_t)Clusters[i].FirstIndex + Clusters[i].IndexCount > (uint64_t)Parts[ Clusters[i].Part ].FirstIndex + Parts[ Clusters[i].Part ].IndexCount ){
+            Clusters = NULL;
+         }
+      }
+   }
+   Data.FromCache = Data.VertexData != NULL and Data.IndexData != NULL and Parts != NULL and PartCount > 0
+                    and Bounds != NULL and BoundsCount == 1 and Lods != NULL and LodCount > 0 and Clusters != NULL
+                    and ( ! Packed or ( Quantization != NULL and QuantizationCount == 1 ) );
+   if( Data.FromCache and Packed ){
+      Data.Quantization = *Quantization;
+   }
+   if( Data.FromCache ){
+      Data.Parts.assign( Parts, Parts + PartCount );
+      Data.Bounds = *Bounds;
+      Data.Lods.assign( Lods, Lods + LodCount );
+      Data.Clusters.assign( Clusters, Clusters + ClusterCount );
       /*
-         Przygotowanie buffora.
+         Ścieżki tekstur materiałów: po dwie na materiał, każda zakończona znakiem '\0'.
       */
-      glBindBuffer( GL_ARRAY_BUFFER, this->NormalBuffer );
+      uint64_t MaterialSize = 0;
+      const char *Materials = (const char *)Data.Cache.ReturnSection( MESH_CACHE_MATERIALS, 1, MaterialSize );
+      vector <string> Strings;
+      for( uint64_t i = 0, Begin = 0; Materials != NULL and i < MaterialSize; ++i ){
+         if( Materials[i] == '\0' ){
+            Strings.push_back( string( Materials + Begin, i - Begin ) );
+            Begin = i + 1;
+         }
+      }
+      for( unsigned int i = 0; i + 1 < Strings.size(); i += 2 ){
+         MeshMaterial Material;
+         Material.Texture = Strings[i];
+         Material.TextureSpecular = Strings[i + 1];
+         Data.Materials.push_back( Material );
+      }
+   }
+   /*
+      Brak pamięci podręcznej: wczytanie przez assimp i zapis do pamięci podręcznej.
+   */
+   if( ! Data.FromCache ){
+      vector <vec3> Positions, Normals;
+      vector <vec2> Uvs;
+      this->Init = LoadAssimp( this->OBJPathFile.c_str(), Positions, Uvs, Normals, Data.Indices, Data.Parts, Data.Materials, Data.Bounds );
+      if( ! this->Init ){
+         return false;
+      }
+      InterleaveVertices( Positions, Uvs, Normals, Data.Vertices );
+      this->Optimize( Data.Vertices, Data.Indices, Data.Parts, Data.Lods, Data.Clusters );
+      Data.VertexData = Data.Vertices.data();
+      if( Packed ){
+         PackVertices( Data.Vertices, Data.PackedVertices, Data.Quantization );
+         Data.VertexData = Data.PackedVertices.data();
+      }
+      Data.IndexData = Data.Indices.data();
+      Data.IndexType = GL_UNSIGNED_INT;
       /*
-         Wypełnienie bufora danymi z normalnymi.
+         Indeksy 16 bitów, gdy wierzchołki każdej części się mieszczą (indeksy liczone są od początku części).
       */
-      glBufferData( GL_ARRAY_BUFFER, this->Normals.size() * sizeof( vec3 ), &this->Normals[0], GL_STATIC_DRAW );
+      bool Short = true;
+      for( unsigned int i = 0; i < Data.Parts.size(); ++i ){
+         Short = Short and Data.Parts[i].VertexCount <= 65536;
+      }
+      if( Short ){
+         Data.ShortIndices.assign( Data.Indices.begin(), Data.Indices.end() );
+         Data.IndexData = Data.ShortIndices.data();
+         Data.IndexType = GL_UNSIGNED_SHORT;
+      }
+      Data.VertexCount = Data.Vertices.size();
+      Data.IndexCount = Data.Indices.size();
+      if( MeshCache::IsEnabled() ){
+         MeshCache Writer;
+         Writer.Add( Packed ? MESH_CACHE_PACKED_VERTICES : MESH_CACHE_VERTICES, Data.VertexData, Data.VertexCount, Stride );
+         Writer.Add( MESH_CACHE_INDICES, Data.IndexData, Data.IndexCount, ( Data.IndexType == GL_UNSIGNED_SHORT ) ? sizeof( uint16_t ) : sizeof( GLuint ) );
+         if( Packed ){
+            Writer.Add( MESH_CACHE_QUANTIZATION, &Data.Quantization, 1, sizeof( VertexQuantization ) );
+         }
+         Writer.Add( MESH_CACHE_PARTS, Data.Parts.data(), Data.Parts.size(), sizeof( MeshPart ) );
+         Writer.Add( MESH_CACHE_BOUNDS, &Data.Bounds, 1, sizeof( MeshBounds ) );
+         Writer.Add( MESH_CACHE_LODS, Data.Lods.data(), Data.Lods.size(), sizeof( MeshLod ) );
+         Writer.Add( MESH_CACHE_CLUSTERS, Data.Clusters.data(), Data.Clusters.size(), sizeof( MeshCluster ) );
+         string Materials;
+         for( unsigned int i = 0; i < Data.Materials.size(); ++i ){
+            Materials += Data.Materials[i].Texture;
+            Materials.push_back( '\0' );
+            Materials += Data.Materials[i].TextureSpecular;
+            Materials.push_back( '\0' );
+         }
+         Writer.Add( MESH_CACHE_MATERIALS, Materials.data(), Materials.size(), 1 );
+         Writer.Save( this->OBJPathFile );
+      }
+   }
+   this->SetMaterials( Data );
+   /*
+      Dekodowanie tekstur (każdy plik tylko raz, wspólny dla wszystkich obiektów).
+   */
+   Data.Images.resize( this->TexturePaths.size() );
+   for( unsigned int i = 0; i < this->TexturePaths.size(); ++i ){
+      this->Init = TextureCache::Decode( this->TexturePaths[i], Data.Images[i] );
+      if( ! this->Init ){
+         return false;
+      }
+   }
+   return this->Init;
+}
 
-      //VAO:
-      /*
-         Przygotowanie VAO
-      */
-      glBindVertexArray( this->VAO );
+void Mesh::SetMaterials( MeshStaging &data ){
+   this->TexturePaths.clear();
+   this->TexturePaths.push_back( this->ImgPathFile );
+   this->TexturePaths.push_back( this->ImgSpecPathFile );
+   /*
+      Numer pary tekstur dla każdego materiału, 0 = tekstury z pliku data.init.
+   */
+   vector <GLuint> Pairs( data.Materials.size(), 0 );
+   for( unsigned int i = 0; i < data.Materials.size(); ++i ){
+      const MeshMaterial &Material = data.Materials[i];
+      if( Material.Texture.empty() ){
+         continue;
+      }
+      if( ! ifstream( Material.Texture.c_str() ).good() ){
+         cout<<"Texture error: "<<Material.Texture<<"\n";
+         continue;
+      }
+      Pairs[i] = this->TexturePaths.size() / 2;
+      this->TexturePaths.push_back( Material.Texture );
+      if( ! Material.TextureSpecular.empty() and ifstream( Material.TextureSpecular.c_str() ).good() ){
+         this->TexturePaths.push_back( Material.TextureSpecular );
+      }
+      else{
+         this->TexturePaths.push_back( this->ImgSpecPathFile );
+      }
+   }
+   for( unsigned int i = 0; i < data.Parts.size(); ++i ){
+      data.Parts[i].Material = ( data.Parts[i].Material < Pairs.size() ) ? Pairs[ data.Parts[i].Material ] : 0;
+   }
+}
 
-      //Vertex:
+bool Mesh::LoadGPU( TextureUploader *uploader, Uint64 deadline ){
+   PROFILE_SCOPE_DETAIL( "Mesh::LoadGPU", this->Name );
+   if( this->Staging == NULL ){
+      return true;
+   }
+   MeshStaging &Data = *this->Staging;
+   /*
+      Tekstury po kolei, tekstura już utworzona (identyfikator różny od 0) jest pomijana przy ponownym wywołaniu.
+   */
+   this->Textures.resize( this->TexturePaths.size(), 0 );
+   bool Uploaded = false;
+   for( unsigned int i = 0; i < this->TexturePaths.size() and this->Init; ++i ){
+      const string &Path = this->TexturePaths[i];
+      const ImageData *Image = ( i < Data.Images.size() ) ? Data.Images[i].get() : NULL;
+      if( this->Textures[i] != 0 ){
+         continue;
+      }
       /*
-         Przypinanie do VAO.
+         Tekstura utworzona już dla innego obiektu (lub innego materiału tego obiektu).
       */
-      glBindBuffer( GL_ARRAY_BUFFER, this->VertexBuffer );
-      glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, 0, (GLvoid *)0 );
+      if( TextureCache::Find( Path, Image, this->Textures[i] ) ){
+         continue;
+      }
       /*
-         Identyfikator wejścia 0
+         Tekstura istniała podczas dekodowania, ale została już usunięta.
       */
-      glEnableVertexAttribArray( 0 );
-      //Uv:
-      glBindBuffer( GL_ARRAY_BUFFER, this->UvBuffer );
-      glVertexAttribPointer( 1, 2, GL_FLOAT, GL_FALSE, 0, (GLvoid *)0 );
+      if( Image == NULL ){
+         cout<<"Texture error: "<<Path<<"\n";
+         this->Init = false;
+         break;
+      }
       /*
-         Identyfikator wejścia 1
+         Koniec budżetu klatki: kolejna tekstura w następnej klatce.
       */
-      glEnableVertexAttribArray( 1 );
-      //Normal:
-      glBindBuffer( GL_ARRAY_BUFFER, this->NormalBuffer );
-      glVertexAttribPointer( 2, 3, GL_FLOAT, GL_FALSE, 0, (GLvoid *)0 );
+      if( Uploaded and deadline != 0 and SDL_GetPerformanceCounter() >= deadline ){
+         return false;
+      }
+      Uploaded = true;
+      if( uploader != NULL and uploader->IsEnabled() ){
+         if( ! uploader->IsReady() ){
+            return false;
+         }
+         this->Init = uploader->Upload( Path.c_str(), *Image, this->Textures[i] );
+      }
+      else{
+         this->Init = UploadImg( Path.c_str(), *Image, this->Textures[i] );
+      }
+      if( this->Init ){
+         TextureCache::Insert( Path, *Image, this->Textures[i] );
+      }
+   }
+   if( this->Init and Uploaded and deadline != 0 and SDL_GetPerformanceCounter() >= deadline ){
+      return false;
+   }
+   if( this->Init ){
+      if( Mesh::Format == VERTEX_PACKED ){
+         this->Quantization = Data.Quantization;
+      }
+      this->BindGeometry( Data.VertexData, Data.VertexCount, Data.IndexData, Data.IndexCount, Data.IndexType );
+      this->Parts = Data.Parts;
+      this->Lods = Data.Lods;
+      this->Clusters = Data.Clusters;
       /*
-         Identyfikator wejścia 2
+         Bryły otaczające w świecie dla wszystkich instancji (macierze mogły być ustalone przed wczytaniem).
       */
-      glEnableVertexAttribArray( 2 );
+      this->Bounds = Data.Bounds;
+      for( GLsizei i = 0; i < this->ReturnInstanceCount(); ++i ){
+         this->UpdateWorldBounds( i );
+      }
+      this->Loaded = true;
+      ++Mesh::LayoutVersion;
+      cout<<"Name: \""<<this->Name<<"\" success load"<<( Data.FromCache ? " (cache)" : "" )<<".\n";
+   }
+   /*
+      Dane CPU nie są już potrzebne (zamyka też zmapowany plik).
+   */
+   delete this->Staging;
+   this->Staging = NULL;
+   return true;
+}
 
-      //Indicies:
-      /*
-         Przypięcie do VAO danych o kolejności rysowania trójkątów.
-      */
-      glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, this->IndicesBuffer );
-      glBufferData( GL_ELEMENT_ARRAY_BUFFER, this->Indices.size() * sizeof(GLuint), &this->Indices[0], GL_STATIC_DRAW );
+bool Mesh::IsLoaded() const{
+   return this->Loaded;
+}
 
+void Mesh::BindGeometry( const void *vertices, GLsizei vertex_count, const void *indices, GLsizei index_count, GLenum index_type ){
+   if( this->Init ){
       /*
-         Odpięcie VAO.
+         Wierzchołki (pozycja, UV Mapa i normalna) i kolejność trójkątów we wspólnych buforach, bez własnego VAO.
       */
-      glBindVertexArray( 0 );
+      GeometryArena::Release( this->Geometry );
+      this->Geometry = GeometryArena::Allocate( vertices, vertex_count, indices, index_count * ( ( index_type == GL_UNSIGNED_SHORT ) ? sizeof( uint16_t ) : sizeof( GLuint ) ) );
+      this->IndexCount = index_count;
+      this->IndexType = index_type;
    }
    else{
       cout<<"Load files before bind!\n";
    }
 }
 
-void Mesh::Draw(){
+void Mesh::Optimize( vector <Vertex> &vertices, vector <GLuint> &indices, vector <MeshPart> &parts, vector <MeshLod> &lods, vector <MeshCluster> &clusters ){
+   PROFILE_SCOPE_DETAIL( "Mesh::Optimize", this->Name );
+   unsigned int ImportedVertices = vertices.size();
+   /*
+      Każda część osobno (własne indeksy od początku części), ACMR ważone ilością trójkątów.
+   */
+   GLfloat MissesBefore = 0.0f, MissesAfter = 0.0f;
+   vector <Vertex> Vertices;
+   vector <GLuint> Indices;
+   Vertices.reserve( vertices.size() );
+   Indices.reserve( indices.size() );
+   for( unsigned int i = 0; i < parts.size(); ++i ){
+      MeshPart &Part = parts[i];
+      vector <Vertex> PartVertices( vertices.begin() + Part.BaseVertex, vertices.begin() + Part.BaseVertex + Part.VertexCount );
+      vector <GLuint> PartIndices( indices.begin() + Part.FirstIndex, indices.begin() + Part.FirstIndex + Part.IndexCount );
+      GLfloat Triangles = PartIndices.size() / 3;
+      MissesBefore += ReturnACMR( PartIndices, PartVertices.size(), MESH_OPTIMIZER_CACHE_SIZE ) * Triangles;
+      WeldVertices( PartVertices, PartIndices );
+      OptimizeTriangleOrder( PartVertices, PartIndices, MESH_OPTIMIZER_CACHE_SIZE );
+      OptimizeVertexFetch( PartVertices, PartIndices );
+      MissesAfter += ReturnACMR( PartIndices, PartVertices.size(), MESH_OPTIMIZER_CACHE_SIZE ) * Triangles;
+      Part.FirstIndex = Indices.size();
+      Part.BaseVertex = Vertices.size();
+      Part.VertexCount = PartVertices.size();
+      Vertices.insert( Vertices.end(), PartVertices.begin(), PartVertices.end() );
+      Indices.insert( Indices.end(), PartIndices.begin(), PartIndices.end() );
+   }
+   vertices.swap( Vertices );
+   indices.swap( Indices );
+   GLfloat Triangles = indices.size() / 3;
+   /*
+      Uproszczone poziomy szczegółowości z tych samych wierzchołków (indeksy i części na końcu).
+   */
+   BuildLods( vertices, indices, parts, lods, MESH_OPTIMIZER_LODS );
+   /*
+      Grupy trójkątów poziomu 0 w kolejności po optymalizacji (sąsiednie trójkąty w jednej grupie).
+   */
+   BuildClusters( vertices, indices, parts, lods[0].PartCount, clusters );
+   /*
+      Cały wiersz naraz, obiekty optymalizowane są w kilku wątkach.
+   */
+   stringstream Report;
+   Report<<fixed<<setprecision( 3 );
+   Report<<"Name: \""<<this->Name<<"\" parts: "<<lods[0].PartCount<<", vertices: "<<ImportedVertices<<" -> "<<vertices.size()
+         <<", ACMR: "<<MissesBefore / Triangles<<" -> "<<MissesAfter / Triangles<<", LOD triangles:";
+   for( unsigned int i = 0; i < lods.size(); ++i ){
+      GLuint LodIndices = 0;
+      for( GLuint k = 0; k < lods[i].PartCount; ++k ){
+         LodIndices += parts[ lods[i].FirstPart + k ].IndexCount;
+      }
+      Report<<" "<<LodIndices / 3<<" (error "<<lods[i].Error<<")";
+   }
+   Report<<", clusters: "<<clusters.size();
+   Report<<"\n";
+   cout<<Report.str();
+}
+
+const VertexQuantization & Mesh::ReturnQuantization() const{
+   return this->Quantization;
+}
+
+void Mesh::SetVertexFormat( VertexFormat format ){
+   Mesh::Format = format;
+   GeometryArena::SetVertexFormat( format );
+}
+
+void Mesh::Draw( GLsizei instances ){
+   PROFILE_SCOPE( "Mesh::Draw" );
+   if( this->Geometry == 0 ){
+      return;
+   }
    /*
-      Przypięcie VAO do rysowania.
+      Rysowanie części, tekstury zmieniane tylko przy zmianie materiału (części są posortowane według materiału).
    */
-   glBindVertexArray( this->VAO );
+   GLuint Material = (GLuint)-1;
+   for( GLuint i = 0; i < (GLuint)this->ReturnDraws(); ++i ){
+      if( this->Parts[i].Material != Material ){
+         Material = this->Parts[i].Material;
+         glActiveTexture( GL_TEXTURE0 );
+         glBindTexture( GL_TEXTURE_2D, this->Textures[ 2 * Material ] );
+         glActiveTexture( GL_TEXTURE1 );
+         glBindTexture( GL_TEXTURE_2D, this->Textures[ 2 * Material + 1 ] );
+      }
+      this->DrawPart( i, instances );
+   }
+}
+
+void Mesh::DrawPart( GLuint part, GLsizei instances ) const{
    /*
-      Rysowanie.
+      Położenie obiektu we wspólnych buforach (może się zmienić po kompaktowaniu).
    */
-   glDrawElements( GL_TRIANGLES, this->Indices.size(), GL_UNSIGNED_INT, (GLvoid *)0 );
+   const MeshPart &Part = this->Parts[ part ];
+   GLsizeiptr IndexSize = ( this->IndexType == GL_UNSIGNED_SHORT ) ? sizeof( uint16_t ) : sizeof( GLuint );
+   const GLvoid *Indices = (const GLvoid *)( GeometryArena::ReturnIndexOffset( this->Geometry ) + Part.FirstIndex * IndexSize );
+   GLint BaseVertex = GeometryArena::ReturnBaseVertex( this->Geometry ) + Part.BaseVertex;
+   if( instances > 1 ){
+      glDrawElementsInstancedBaseVertex( GL_TRIANGLES, Part.IndexCount, this->IndexType, Indices, instances, BaseVertex );
+   }
+   else{
+      glDrawElementsBaseVertex( GL_TRIANGLES, Part.IndexCount, this->IndexType, Indices, BaseVertex );
+   }
 }
 
 void Mesh::Translate( vec3 vector_translate ){
+   /*
+      Przesunięcie nie zmienia części 3x3 macierzy modelu, macierz normalnych pozostaje bez zmian.
+   */
    this->ModelMatrix = translate( this->ModelMatrix, vector_translate );
+   this->UpdateWorldBounds( 0 );
 }
 
 void Mesh::Rotate( GLfloat angle_rotate, vec3 vector_rotate ){
    this->ModelMatrix = rotate( this->ModelMatrix, radians( angle_rotate ), vector_rotate );
+   this->UpdateNormalMatrix();
+   this->UpdateWorldBounds( 0 );
 }
 
 void Mesh::Scale( vec3 vector_scale ){
    this->ModelMatrix = scale( this->ModelMatrix, vector_scale );
+   this->UpdateNormalMatrix();
+   this->UpdateWorldBounds( 0 );
+}
+
+void Mesh::UpdateNormalMatrix(){
+   this->NormalMatrix = transpose( inverse( mat3( this->ModelMatrix ) ) );
+}
+
+void Mesh::UpdateWorldBounds( GLsizei instance ){
+   this->WorldBounds.resize( this->ReturnInstanceCount() );
+   this->WorldBounds[ instance ] = TransformBounds( this->Bounds, this->ReturnInstanceMatrix( instance ) );
+   ++this->BoundsVersion;
+   ++Mesh::SceneVersion;
+   /*
+      Niewczytany obiekt nie ma jeszcze instancji w drzewie (wczytanie zmienia zbiór instancji).
+   */
+   if( ! this->Loaded ){
+      return;
+   }
+   if( Mesh::Changes.size() < MESH_CHANGES_LIMIT ){
+      MeshChange Change = { this, instance };
+      Mesh::Changes.push_back( Change );
+   }
+   else{
+      Mesh::ChangesOverflow = true;
+   }
 }
 
 #endif
@@ -0,0 +1,521 @@
+/*!
+   \file mesh_cache.cpp
+   \brief Plik odpowiedzialny za binarną pamięć podręczną (cache) obiektów 3D.
+
+   Po pierwszym wczytaniu pliku .obj przez assimp dane zapisywane są w katalogu \link MeshCache::Directory \endlink,
+   a przy kolejnych uruchomieniach plik cache jest mapowany do pamięci (mmap) i przekazywany bezpośrednio do glBufferData.
+*/
+#ifndef __mesh_cache_hpp__
+#define __mesh_cache_hpp__
+
+#include <sys/stat.h>
+#ifdef _WIN32
+   #include <direct.h>
+#else
+   #include <sys/mman.h>
+   #include <fcntl.h>
+   #include <unistd.h>
+#endif
+
+/*!
+   \brief Wersja formatu pliku cache, zmiana wersji unieważnia wszystkie zapisane pliki.
+*/
+#define MESH_CACHE_VERSION 8
+
+/*!
+   \brief Wyrównanie (w bajtach) początku każdej sekcji pliku cache.
+*/
+#define MESH_CACHE_ALIGNMENT 16
+
+/*!
+   \brief Rodzaje sekcji w pliku cache.
+*/
+enum MeshCacheSectionType{
+   /*!
+      \brief Wierzchołki przeplatane ( \link Vertex \endlink ).
+   */
+   MESH_CACHE_VERTICES = 1,
+   /*!
+      \brief Wierzchołki kwantyzowane ( \link PackedVertex \endlink ).
+   */
+   MESH_CACHE_PACKED_VERTICES = 2,
+   /*!
+      \brief Przeliczenie kwantyzowanej pozycji ( \link VertexQuantization \endlink ).
+   */
+   MESH_CACHE_QUANTIZATION = 3,
+   /*!
+      \brief Indeksy wierzchołków (GLuint lub uint16_t, według wielkości elementu).
+   */
+   MESH_CACHE_INDICES = 4,
+   /*!
+      \brief Opis przygotowanej tekstury ( \link TextureCookInfo \endlink ).
+   */
+   MESH_CACHE_TEXTURE_INFO = 5,
+   /*!
+      \brief Części obiektu ( \link MeshPart \endlink ).
+   */
+   MESH_CACHE_PARTS = 6,
+   /*!
+      \brief Ścieżki tekstur materiałów (po dwie na materiał, zakończone znakiem '\\0').
+   */
+   MESH_CACHE_MATERIALS = 7,
+   /*!
+      \brief Bryły otaczające obiekt ( \link MeshBounds \endlink ).
+   */
+   MESH_CACHE_BOUNDS = 8,
+   /*!
+      \brief Poziomy szczegółowości obiektu ( \link MeshLod \endlink ).
+   */
+   MESH_CACHE_LODS = 9,
+   /*!
+      \brief Grupy trójkątów poziomu 0 ( \link MeshCluster \endlink ).
+   */
+   MESH_CACHE_CLUSTERS = 10,
+   /*!
+      \brief Poziom 0 przygotowanej tekstury, kolejne poziomy mipmapy mają kolejne numery.
+   */
+   MESH_CACHE_TEXTURE_LEVEL = 16
+};
+
+/*!
+   \brief Nagłówek pliku cache (początek pliku). Wszystkie wartości w kolejności bajtów komputera, który zapisał plik.
+*/
+struct MeshCacheHeader{
+   /*!
+      \brief Identyfikator formatu: "SOGM".
+   */
+   char Magic[4];
+   /*!
+      \brief Wersja formatu ( \link MESH_CACHE_VERSION \endlink ).
+   */
+   uint32_t Version;
+   /*!
+      \brief Wielkość pliku źródłowego (.obj) w chwili zapisu.
+   */
+   uint64_t SourceSize;
+   /*!
+      \brief Czas modyfikacji pliku źródłowego (.obj) w chwili zapisu.
+   */
+   int64_t SourceTime;
+   /*!
+      \brief Wielkość całego pliku cache.
+   */
+   uint64_t FileSize;
+   /*!
+      \brief Ilość sekcji (tablica sekcji znajduje się zaraz za nagłówkiem).
+   */
+   uint32_t SectionCount;
+   /*!
+      \brief Suma kontrolna (FNV-1a) nagłówka (bez tego pola) i tablicy sekcji ( \link MeshCache::ReturnTableChecksum() \endlink ).
+
+      Dane sekcji nie są sprawdzane: odczyt całego pliku przy każdym wczytaniu zniweczyłby mapowanie pliku (strony wczytywane przy dostępie).
+      Nieaktualność względem pliku źródłowego wykrywają wielkość i czas modyfikacji.
+   */
+   uint32_t Checksum;
+};
+
+/*!
+   \brief Opis jednej sekcji pliku cache.
+*/
+struct MeshCacheSection{
+   /*!
+      \brief Rodzaj sekcji ( \link MeshCacheSectionType \endlink ).
+   */
+   uint32_t Type;
+   /*!
+      \brief Wielkość jednego elementu w bajtach.
+   */
+   uint32_t Stride;
+   /*!
+      \brief Ilość elementów.
+   */
+   uint64_t Count;
+   /*!
+      \brief Położenie danych od początku pliku (wyrównane do \link MESH_CACHE_ALIGNMENT \endlink).
+   */
+   uint64_t Offset;
+};
+
+/*!
+   \brief Klasa odpowiedzialna za ścieżki plików cache oraz zapis nowych plików.
+*/
+class MeshCache{
+   public:
+      /*!
+         \brief Konstruktor domyślny.
+      */
+      MeshCache();
+      /*!
+         \brief Dodaje sekcję do zapisu. Dane nie są kopiowane, muszą istnieć do wywołania \link Save() \endlink.
+
+         \param type - rodzaj sekcji
+         \param data - wskaźnik do danych
+         \param count - ilość elementów
+         \param stride - wielkość jednego elementu w bajtach
+      */
+      void Add( MeshCacheSectionType type, const void *data, uint64_t count, uint32_t stride );
+      /*!
+         \brief Zapisuje plik cache dla pliku źródłowego.
+
+         \param source - ścieżka do pliku źródłowego (.obj lub tekstura)
+         \param extension - rozszerzenie pliku cache
+         \return - wartość logiczną dla zapisu pliku, FALSE = błąd
+
+         Plik zapisywany jest pod tymczasową nazwą i zamieniany na docelowy dopiero po zapisaniu całości,
+         więc może być wywoływana z wielu wątków.
+      */
+      bool Save( string source, string extension = ".mesh" );
+      /*!
+         \brief Włącza lub wyłącza używanie plików cache.
+
+         \param enable - TRUE = pliki cache są odczytywane i zapisywane
+      */
+      static void Enable( bool enable );
+      /*!
+         \brief Zwraca TRUE, gdy pliki cache są używane.
+      */
+      static bool IsEnabled();
+      /*!
+         \brief Zwraca ścieżkę pliku cache dla pliku źródłowego.
+
+         \param source - ścieżka do pliku źródłowego
+         \param extension - rozszerzenie pliku cache
+      */
+      static string ReturnPath( string source, string extension );
+      /*!
+         \brief Zwraca wielkość i czas modyfikacji pliku.
+
+         \param file - ścieżka do pliku
+         \param size - wielkość pliku
+         \param time - czas modyfikacji pliku
+         \return - wartość logiczną, FALSE = plik nie istnieje
+      */
+      static bool ReturnFileInfo( string file, uint64_t &size, int64_t &time );
+      /*!
+         \brief Liczy sumę kontrolną FNV-1a.
+
+         \param data - wskaźnik do danych
+         \param size - wielkość danych w bajtach
+         \param hash - poprzednia wartość sumy (dla liczenia w częściach)
+      */
+      static uint32_t Checksum( const void *data, uint64_t size, uint32_t hash = 2166136261u );
+      /*!
+         \brief Liczy sumę kontrolną nagłówka (bez \link MeshCacheHeader::Checksum \endlink ) i tablicy sekcji.
+
+         \param header - nagłówek
+         \param sections - tablica \link MeshCacheHeader::SectionCount \endlink sekcji
+      */
+      static uint32_t ReturnTableChecksum( const MeshCacheHeader &header, const MeshCacheSection *sections );
+      /*!
+         \brief Katalog z plikami cache.
+      */
+      static const char *Directory;
+   private:
+      /*!
+         \brief Sekcje do zapisu.
+      */
+      vector <MeshCacheSection> Sections;
+      /*!
+         \brief Dane każdej sekcji do zapisu.
+      */
+      vector <const void *> Data;
+      /*!
+         \brief TRUE = pliki cache są używane.
+      */
+      static bool Enabled;
+};
+
+/*!
+   \brief Klasa odpowiedzialna za odczyt pliku cache zmapowanego do pamięci.
+*/
+class MeshCacheFile{
+   public:
+      /*!
+         \brief Konstruktor domyślny.
+      */
+      MeshCacheFile();
+      /*!
+         \brief Zmapowany plik nie może być kopiowany.
+      */
+      MeshCacheFile( const MeshCacheFile & ) = delete;
+      /*!
+         \brief Zmapowany plik nie może być kopiowany.
+      */
+      MeshCacheFile & operator=( const MeshCacheFile & ) = delete;
+      /*!
+         \brief Destruktor.
+
+         Usuwa mapowanie pliku.
+      */
+      ~MeshCacheFile();
+      /*!
+         \brief Mapuje plik cache do pamięci i sprawdza jego poprawność.
+
+         \param source - ścieżka do pliku źródłowego (.obj lub tekstura)
+         \param extension - rozszerzenie pliku cache
+         \return - wartość logiczną, FALSE = brak pliku, plik nieaktualny (zmieniony plik źródłowy lub wersja formatu) albo uszkodzony
+      */
+      bool Open( string source, string extension = ".mesh" );
+      /*!
+         \brief Zwraca wskaźnik do danych sekcji w zmapowanym pliku.
+
+         \param type - rodzaj sekcji
+         \param stride - oczekiwana wielkość jednego elementu w bajtach
+         \param count - ilość elementów sekcji
+         \return - wskaźnik do danych, NULL = brak sekcji
+      */
+      const void * ReturnSection( MeshCacheSectionType type, uint32_t stride, uint64_t &count ) const;
+   private:
+      /*!
+         \brief Zwalnia zmapowany plik.
+      */
+      void Close();
+      /*!
+         \brief Wskaźnik do początku zmapowanego pliku.
+      */
+      const unsigned char *Memory = NULL;
+      /*!
+         \brief Wielkość zmapowanego pliku.
+      */
+      uint64_t Size = 0;
+#ifdef _WIN32
+      /*!
+         \brief Zawartość pliku (bez mmap plik jest wczytywany do pamięci).
+      */
+      vector <unsigned char> Buffer;
+#endif
+};
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+bool MeshCache::Enabled = true;
+const char *MeshCache::Directory = "./cache/";
+
+MeshCache::MeshCache(){
+}
+
+void MeshCache::Add( MeshCacheSectionType type, const void *data, uint64_t count, uint32_t stride ){
+   MeshCacheSection Section;
+   Section.Type = type;
+   Section.Stride = stride;
+   Section.Count = count;
+   Section.Offset = 0;
+   this->Sections.push_back( Section );
+   this->Data.push_back( data );
+}
+
+bool MeshCache::Save( string source, string extension ){
+   MeshCacheHeader Header;
+   memcpy( Header.Magic, "SOGM", 4 );
+   Header.Version = MESH_CACHE_VERSION;
+   if( ! MeshCache::ReturnFileInfo( source, Header.SourceSize, Header.SourceTime ) ){
+      return false;
+   }
+   Header.SectionCount = this->Sections.size();
+   /*
+      Położenie sekcji: za nagłówkiem i tablicą sekcji, każda wyrównana do MESH_CACHE_ALIGNMENT.
+   */
+   uint64_t Offset = sizeof( MeshCacheHeader ) + this->Sections.size() * sizeof( MeshCacheSection );
+   for( unsigned int i = 0; i < this->Sections.size(); ++i ){
+      Offset = ( Offset + MESH_CACHE_ALIGNMENT - 1 ) / MESH_CACHE_ALIGNMENT * MESH_CACHE_ALIGNMENT;
+      this->Sections[i].Offset = Offset;
+      Offset += this->Sections[i].Count * this->Sections[i].Stride;
+   }
+   Header.FileSize = Offset;
+   /*
+      Cały plik składany jest w pamięci i zapisywany jednym wywołaniem.
+   */
+   vector <unsigned char> File( Header.FileSize, 0 );
+   if( ! this->Sections.empty() ){
+      memcpy( &File[ sizeof( MeshCacheHeader ) ], &this->Sections[0], this->Sections.size() * sizeof( MeshCacheSection ) );
+   }
+   for( unsigned int i = 0; i < this->Sections.size(); ++i ){
+      if( this->Sections[i].Count > 0 ){
+         memcpy( &File[ this->Sections[i].Offset ], this->Data[i], this->Sections[i].Count * this->Sections[i].Stride );
+      }
+   }
+   Header.Checksum = MeshCache::ReturnTableChecksum( Header, this->Sections.data() );
+   memcpy( &File[0], &Header, sizeof( MeshCacheHeader ) );
+   /*
+      Utworzenie katalogu (gdy już istnieje, błąd jest pomijany).
+   */
+#ifdef _WIN32
+   _mkdir( MeshCache::Directory );
+#else
+   mkdir( MeshCache::Directory, 0755 );
+#endif
+   string Path = MeshCache::ReturnPath( source, extension );
+   /*
+      Nazwa tymczasowa zależna od wątku, ten sam plik .obj może być zapisywany przez kilka wątków naraz.
+   */
+   stringstream Temporary_stream;
+   Temporary_stream<<Path<<".tmp"<<hash <thread::id>()( this_thread::get_id() );
+   string Temporary = Temporary_stream.str();
+   fstream output;
+   output.open( Temporary.c_str(), ios::out | ios::binary );
+   if( ! output.good() ){
+      cout<<"File error: "<<Temporary<<"\n";
+      return false;
+   }
+   output.write( (const char *)&File[0], File.size() );
+   output.close();
+#ifdef _WIN32
+   remove( Path.c_str() );
+#endif
+   if( rename( Temporary.c_str(), Path.c_str() ) != 0 ){
+      cout<<"File error: "<<Path<<"\n";
+      remove( Temporary.c_str() );
+      return false;
+   }
+   return true;
+}
+
+void MeshCache::Enable( bool enable ){
+   MeshCache::Enabled = enable;
+}
+
+bool MeshCache::IsEnabled(){
+   return MeshCache::Enabled;
+}
+
+string MeshCache::ReturnPath( string source, string extension ){
+   /*
+      Ścieżka pliku źródłowego bez "./", znaki '/' i '\' zamienione na '_', np. ./data/cat.obj -> ./cache/data_cat.obj.mesh
+   */
+   if( source.compare( 0, 2, "./" ) == 0 ){
+      source = source.substr( 2 );
+   }
+   for( unsigned int i = 0; i < source.size(); ++i ){
+      if( source[i] == '/' or source[i] == '\\' or source[i] == ':' ){
+         source[i] = '_';
+      }
+   }
+   return string( MeshCache::Directory ) + source + extension;
+}
+
+bool MeshCache::ReturnFileInfo( string file, uint64_t &size, int64_t &time ){
+   struct stat Info;
+   if( stat( file.c_str(), &Info ) != 0 ){
+      return false;
+   }
+   size = Info.st_size;
+   time = Info.st_mtime;
+   return true;
+}
+
+uint32_t MeshCache::Checksum( const void *data, uint64_t size, uint32_t hash ){
+   const unsigned char *Bytes = (const unsigned char *)data;
+   for( uint64_t i = 0; i < size; ++i ){
+      hash ^= Bytes[i];
+      hash *= 16777619u;
+   }
+   return hash;
+}
+
+uint32_t MeshCache::ReturnTableChecksum( const MeshCacheHeader &header, const MeshCacheSection *sections ){
+   uint32_t Hash = MeshCache::Checksum( &header, offsetof( MeshCacheHeader, Checksum ) );
+   return MeshCache::Checksum( sections, (uint64_t)header.SectionCount * sizeof( MeshCacheSection ), Hash );
+}
+
+MeshCacheFile::MeshCacheFile(){
+}
+
+MeshCacheFile::~MeshCacheFile(){
+   this->Close();
+}
+
+bool MeshCacheFile::Open( string source, string extension ){
+   this->Close();
+   if( ! MeshCache::IsEnabled() ){
+      return false;
+   }
+   string Path = MeshCache::ReturnPath( source, extension );
+   uint64_t FileSize;
+   int64_t FileTime;
+   if( ! MeshCache::ReturnFileInfo( Path, FileSize, FileTime ) or FileSize < sizeof( MeshCacheHeader ) ){
+      return false;
+   }
+#ifdef _WIN32
+   fstream input;
+   input.open( Path.c_str(), ios::in | ios::binary );
+   if( ! input.good() ){
+      return false;
+   }
+   this->Buffer.resize( FileSize );
+   input.read( (char *)&this->Buffer[0], FileSize );
+   input.close();
+   this->Memory = &this->Buffer[0];
+#else
+   /*
+      Mapowanie pliku tylko do odczytu, system wczytuje strony dopiero przy dostępie.
+   */
+   int Descriptor = open( Path.c_str(), O_RDONLY );
+   if( Descriptor < 0 ){
+      return false;
+   }
+   void *Mapping = mmap( NULL, FileSize, PROT_READ, MAP_PRIVATE, Descriptor, 0 );
+   close( Descriptor );
+   if( Mapping == MAP_FAILED ){
+      return false;
+   }
+   this->Memory = (const unsigned char *)Mapping;
+#endif
+   this->Size = FileSize;
+   /*
+      Sprawdzenie nagłówka, aktualności względem pliku źródłowego i sumy kontrolnej nagłówka i tablicy sekcji (dane sekcji nie są czytane).
+   */
+   const MeshCacheHeader *Header = (const MeshCacheHeader *)this->Memory;
+   uint64_t SourceSize;
+   int64_t SourceTime;
+   if( memcmp( Header->Magic, "SOGM", 4 ) != 0
+       or Header->Version != MESH_CACHE_VERSION
+       or Header->FileSize != this->Size
+       or sizeof( MeshCacheHeader ) + (uint64_t)Header->SectionCount * sizeof( MeshCacheSection ) > this->Size
+       or ! MeshCache::ReturnFileInfo( source, SourceSize, SourceTime )
+       or Header->SourceSize != SourceSize
+       or Header->SourceTime != SourceTime ){
+      this->Close();
+      return false;
+   }
+   if( MeshCache::ReturnTableChecksum( *Header, (const MeshCacheSection *)( this->Memory + sizeof( MeshCacheHeader ) ) ) != Header->Checksum ){
+      cout<<"Mesh cache checksum error: "<<Path<<"\n";
+      this->Close();
+      return false;
+   }
+   return true;
+}
+
+const void * MeshCacheFile::ReturnSection( MeshCacheSectionType type, uint32_t stride, uint64_t &count ) const{
+   count = 0;
+   if( this->Memory == NULL ){
+      return NULL;
+   }
+   const MeshCacheHeader *Header = (const MeshCacheHeader *)this->Memory;
+   const MeshCacheSection *Sections = (const MeshCacheSection *)( this->Memory + sizeof( MeshCacheHeader ) );
+   for( uint32_t i = 0; i < Header->SectionCount; ++i ){
+      if( Sections[i].Type == (uint32_t)type and Sections[i].Stride == stride
+          and Sections[i].Offset + Sections[i].Count * Sections[i].Stride <= this->Size ){
+         count = Sections[i].Count;
+         return this->Memory + Sections[i].Offset;
+      }
+   }
+   return NULL;
+}
+
+void MeshCacheFile::Close(){
+   if( this->Memory != NULL ){
+#ifdef _WIN32
+      this->Buffer.clear();
+#else
+      munmap( (void *)this->Memory, this->Size );
+#endif
+   }
+   this->Memory = NULL;
+   this->Size = 0;
+}
+
+#endif
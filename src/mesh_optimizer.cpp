@@ -0,0 +1,665 @@
+/*!
+   \file mesh_optimizer.cpp
+   \brief Plik odpowiedzialny za optymalizację obiektów 3D przy wczytywaniu (łączenie wierzchołków, kolejność trójkątów i wierzchołków).
+*/
+#ifndef __mesh_optimizer_hpp__
+#define __mesh_optimizer_hpp__
+
+/*!
+   \brief Wielkość symulowanej pamięci podręcznej wierzchołków po transformacji (FIFO), dla optymalizacji i raportu ACMR.
+*/
+#define MESH_OPTIMIZER_CACHE_SIZE 16
+/*!
+   \brief Największa ilość poziomów szczegółowości (LOD) obiektu, razem z poziomem 0.
+*/
+#define MESH_OPTIMIZER_LODS 4
+/*!
+   \brief Największa ilość przebiegów upraszczania jednego poziomu.
+*/
+#define MESH_OPTIMIZER_SIMPLIFY_PASSES 32
+/*!
+   \brief Największa ilość trójkątów grupy ( \link MeshCluster \endlink ).
+*/
+#define MESH_OPTIMIZER_CLUSTER_TRIANGLES 124
+/*!
+   \brief Największa ilość różnych wierzchołków grupy ( \link MeshCluster \endlink ).
+*/
+#define MESH_OPTIMIZER_CLUSTER_VERTICES 64
+
+/*!
+   \brief Łączy identyczne wierzchołki (porównanie wszystkich bajtów \link Vertex \endlink ) i poprawia indeksy.
+
+   \param vertices - wierzchołki przeplatane
+   \param indices - indeksy wierzchołków
+*/
+void WeldVertices( vector <Vertex> &vertices, vector <GLuint> &indices );
+
+/*!
+   \brief Zmienia kolejność trójkątów dla pamięci podręcznej wierzchołków (Tipsify) i mniejszego overdraw.
+
+   \param vertices - wierzchołki przeplatane (dla położenia i normalnych grup trójkątów)
+   \param indices - indeksy wierzchołków
+   \param cache_size - wielkość pamięci podręcznej wierzchołków
+
+   Algorytm Tipsify (Sander, Nehab, Barczak 2007) dzieli trójkąty na grupy w miejscach skoku do niesąsiadującego wierzchołka.
+   Grupy sortowane są tak, aby najpierw rysowane były grupy leżące na zewnątrz obiektu i zwrócone na zewnątrz
+   (zasłaniają pozostałe, więc mniej fragmentów jest liczonych niepotrzebnie).
+*/
+void OptimizeTriangleOrder( const vector <Vertex> &vertices, vector <GLuint> &indices, int cache_size );
+
+/*!
+   \brief Zmienia kolejność wierzchołków na kolejność pierwszego użycia w indeksach (lepsza lokalność odczytu), usuwa nieużywane wierzchołki.
+
+   \param vertices - wierzchołki przeplatane
+   \param indices - indeksy wierzchołków
+*/
+void OptimizeVertexFetch( vector <Vertex> &vertices, vector <GLuint> &indices );
+
+/*!
+   \brief Zwraca ACMR (średnia ilość transformowanych wierzchołków na trójkąt) dla pamięci podręcznej FIFO.
+
+   \param indices - indeksy wierzchołków
+   \param vertex_count - ilość wierzchołków
+   \param cache_size - wielkość pamięci podręcznej wierzchołków
+*/
+GLfloat ReturnACMR( const vector <GLuint> &indices, unsigned int vertex_count, int cache_size );
+
+/*!
+   \brief Upraszcza obiekt przez łączenie krawędzi (błąd kwadryk, Garland i Heckbert 1997), wierzchołek łączony jest z sąsiednim istniejącym wierzchołkiem.
+
+   \param vertices - wierzchołki przeplatane (bez zmian, wynik używa tych samych wierzchołków)
+   \param indices - indeksy wierzchołków
+   \param target_index_count - docelowa ilość indeksów
+   \param result - indeksy uproszczonego obiektu
+   \return - błąd uproszczenia (pierwiastek największego błędu kwadryki wykonanego łączenia, we współrzędnych obiektu)
+
+   Wierzchołki na brzegach i szwach (ta sama pozycja w kilku wierzchołkach, np. inna UV Mapa) nie są przesuwane, więc obiekt nie pęka.
+   W jednym przebiegu łączone są krawędzie od najmniejszego błędu, każdy wierzchołek i jego sąsiedzi najwyżej raz;
+   łączenie odwracające trójkąt jest pomijane. Wynik może mieć więcej indeksów niż docelowo (zablokowane wierzchołki).
+*/
+GLfloat SimplifyMesh( const vector <Vertex> &vertices, const vector <GLuint> &indices, unsigned int target_index_count, vector <GLuint> &result );
+
+/*!
+   \brief Dodaje uproszczone poziomy szczegółowości (LOD) do obiektu.
+
+   \param vertices - wierzchołki przeplatane (wspólne dla wszystkich poziomów)
+   \param indices - indeksy wierzchołków, indeksy kolejnych poziomów dopisywane są na końcu
+   \param parts - części poziomu 0, części kolejnych poziomów dopisywane są na końcu
+   \param lods - wynik, poziom 0 i uproszczone poziomy
+   \param count - największa ilość poziomów (razem z poziomem 0)
+
+   Poziom n ma około 1 / 2^n trójkątów poziomu 0 (każda część upraszczana osobno).
+   Poziomy kończą się, gdy uproszczenie usuwa mniej niż 20% trójkątów poprzedniego poziomu.
+*/
+void BuildLods( const vector <Vertex> &vertices, vector <GLuint> &indices, vector <MeshPart> &parts, vector <MeshLod> &lods, int count );
+
+/*!
+   \brief Dzieli trójkąty części poziomu 0 na grupy (meshlety) kolejnych trójkątów.
+
+   \param vertices - wierzchołki przeplatane
+   \param indices - indeksy wierzchołków (po \link OptimizeTriangleOrder() \endlink sąsiednie trójkąty leżą obok siebie)
+   \param parts - części obiektu
+   \param part_count - ilość części poziomu 0
+   \param clusters - wynik
+
+   Grupa ma najwyżej \link MESH_OPTIMIZER_CLUSTER_TRIANGLES \endlink trójkątów i \link MESH_OPTIMIZER_CLUSTER_VERTICES \endlink różnych wierzchołków,
+   kolejność indeksów się nie zmienia (grupa to zakres indeksów części).
+*/
+void BuildClusters( const vector <Vertex> &vertices, const vector <GLuint> &indices, const vector <MeshPart> &parts, GLuint part_count, vector <MeshCluster> &clusters );
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+/*!
+   \brief Hash wierzchołka (FNV-1a ze wszystkich bajtów) dla \link WeldVertices() \endlink.
+*/
+struct VertexHash{
+   size_t operator()( const Vertex &vertex ) const{
+      return MeshCache::Checksum( &vertex, sizeof( Vertex ) );
+   }
+};
+
+/*!
+   \brief Porównanie wszystkich bajtów wierzchołka dla \link WeldVertices() \endlink.
+*/
+struct VertexEqual{
+   bool operator()( const Vertex &a, const Vertex &b ) const{
+      return memcmp( &a, &b, sizeof( Vertex ) ) == 0;
+   }
+};
+
+void WeldVertices( vector <Vertex> &vertices, vector <GLuint> &indices ){
+   PROFILE_SCOPE( "WeldVertices" );
+   unordered_map <Vertex, GLuint, VertexHash, VertexEqual> Unique;
+   Unique.reserve( vertices.size() );
+   vector <GLuint> Remap( vertices.size() );
+   vector <Vertex> Welded;
+   Welded.reserve( vertices.size() );
+   for( unsigned int i = 0; i < vertices.size(); ++i ){
+      pair < unordered_map <Vertex, GLuint, VertexHash, VertexEqual>::iterator, bool > It = Unique.insert( make_pair( vertices[i], (GLuint)Welded.size() ) );
+      if( It.second ){
+         Welded.push_back( vertices[i] );
+      }
+      Remap[i] = It.first->second;
+   }
+   for( unsigned int i = 0; i < indices.size(); ++i ){
+      indices[i] = Remap[ indices[i] ];
+   }
+   vertices.swap( Welded );
+}
+
+void OptimizeTriangleOrder( const vector <Vertex> &vertices, vector <GLuint> &indices, int cache_size ){
+   PROFILE_SCOPE( "OptimizeTriangleOrder" );
+   unsigned int VertexCount = vertices.size();
+   unsigned int TriangleCount = indices.size() / 3;
+   if( TriangleCount == 0 ){
+      return;
+   }
+   /*
+      Trójkąty każdego wierzchołka (Offsets + Adjacency) i ilość jeszcze nie wypisanych trójkątów (Live).
+   */
+   vector <unsigned int> Live( VertexCount, 0 );
+   for( unsigned int i = 0; i < TriangleCount * 3; ++i ){
+      ++Live[ indices[i] ];
+   }
+   vector <unsigned int> Offsets( VertexCount + 1, 0 );
+   for( unsigned int i = 0; i < VertexCount; ++i ){
+      Offsets[ i + 1 ] = Offsets[i] + Live[i];
+   }
+   vector <unsigned int> Adjacency( TriangleCount * 3 );
+   vector <unsigned int> Fill( Offsets.begin(), Offsets.end() - 1 );
+   for( unsigned int i = 0; i < TriangleCount * 3; ++i ){
+      Adjacency[ Fill[ indices[i] ]++ ] = i / 3;
+   }
+   /*
+      Tipsify: wachlarze trójkątów wokół kolejnych wierzchołków, czas wejścia do pamięci podręcznej (Cache)
+      i stos wierzchołków (DeadEnd) na wypadek braku sąsiada.
+   */
+   vector <int> Cache( VertexCount, 0 );
+   vector <bool> Emitted( TriangleCount, false );
+   vector <unsigned int> DeadEnd;
+   vector <unsigned int> Candidates;
+   vector <GLuint> Output;
+   Output.reserve( indices.size() );
+   vector <unsigned int> Clusters;
+   int Time = cache_size + 1;
+   unsigned int Cursor = 0;
+   int Fan = 0;
+   Clusters.push_back( 0 );
+   while( Fan >= 0 ){
+      Candidates.clear();
+      for( unsigned int i = Offsets[ Fan ]; i < Offsets[ Fan + 1 ]; ++i ){
+         unsigned int Triangle = Adjacency[i];
+         if( Emitted[ Triangle ] ){
+            continue;
+         }
+         for( int j = 0; j < 3; ++j ){
+            GLuint V = indices[ Triangle * 3 + j ];
+            Output.push_back( V );
+            DeadEnd.push_back( V );
+            Candidates.push_back( V );
+            --Live[V];
+            if( Time - Cache[V] > cache_size ){
+               Cache[V] = Time;
+               ++Time;
+            }
+         }
+         Emitted[ Triangle ] = true;
+      }
+      /*
+         Kolejny wierzchołek: sąsiad, który nadal będzie w pamięci podręcznej po wypisaniu jego trójkątów (najstarszy z nich).
+      */
+      int Next = -1;
+      int Best = -1;
+      for( unsigned int i = 0; i < Candidates.size(); ++i ){
+         unsigned int V = Candidates[i];
+         if( Live[V] == 0 ){
+            continue;
+         }
+         int Priority = 0;
+         if( Time - Cache[V] + 2 * (int)Live[V] <= cache_size ){
+            Priority = Time - Cache[V];
+         }
+         if( Priority > Best ){
+            Best = Priority;
+            Next = V;
+         }
+      }
+      if( Next < 0 ){
+         /*
+            Brak sąsiada: ostatnio użyte wierzchołki ze stosu, potem kolejne w kolejności. Nowa grupa trójkątów.
+         */
+         while( ! DeadEnd.empty() and Next < 0 ){
+            unsigned int V = DeadEnd.back();
+            DeadEnd.pop_back();
+            if( Live[V] > 0 ){
+               Next = V;
+            }
+         }
+         while( Cursor < VertexCount and Next < 0 ){
+            if( Live[ Cursor ] > 0 ){
+               Next = Cursor;
+            }
+            ++Cursor;
+         }
+         if( Next >= 0 and Output.size() / 3 != Clusters.back() ){
+            Clusters.push_back( Output.size() / 3 );
+         }
+      }
+      Fan = Next;
+   }
+   Clusters.push_back( TriangleCount );
+   /*
+      Overdraw: środek i normalna każdej grupy, grupy dalej od środka obiektu w kierunku swojej normalnej rysowane są najpierw.
+   */
+   vec3 Center = vec3( 0.0f );
+   for( unsigned int i = 0; i < VertexCount; ++i ){
+      Center += vertices[i].Position;
+   }
+   Center /= (GLfloat)std::max( VertexCount, 1u );
+   vector < pair <GLfloat, unsigned int> > Order;
+   for( unsigned int c = 0; c + 1 < Clusters.size(); ++c ){
+      vec3 ClusterCenter = vec3( 0.0f ), ClusterNormal = vec3( 0.0f );
+      GLfloat Area = 0.0f;
+      for( unsigned int t = Clusters[c]; t < Clusters[ c + 1 ]; ++t ){
+         const vec3 &A = vertices[ Output[ t * 3 ] ].Position;
+         const vec3 &B = vertices[ Output[ t * 3 + 1 ] ].Position;
+         const vec3 &C = vertices[ Output[ t * 3 + 2 ] ].Position;
+         vec3 Normal = cross( B - A, C - A );
+         GLfloat TriangleArea = length( Normal );
+         ClusterCenter += ( A + B + C ) * ( TriangleArea / 3.0f );
+         ClusterNormal += Normal;
+         Area += TriangleArea;
+      }
+      GLfloat Metric = 0.0f;
+      GLfloat NormalLength = length( ClusterNormal );
+      if( Area > 0.0f and NormalLength > 0.0f ){
+         Metric = dot( ClusterCenter / Area - Center, ClusterNormal / NormalLength );
+      }
+      Order.push_back( make_pair( -Metric, c ) );
+   }
+   stable_sort( Order.begin(), Order.end() );
+   indices.clear();
+   for( unsigned int i = 0; i < Order.size(); ++i ){
+      unsigned int c = Order[i].second;
+      indices.insert( indices.end(), Output.begin() + Clusters[c] * 3, Output.begin() + Clusters[ c + 1 ] * 3 );
+   }
+}
+
+void OptimizeVertexFetch( vector <Vertex> &vertices, vector <GLuint> &indices ){
+   PROFILE_SCOPE( "OptimizeVertexFetch" );
+   const GLuint Unused = 0xFFFFFFFFu;
+   vector <GLuint> Remap( vertices.size(), Unused );
+   vector <Vertex> Ordered;
+   Ordered.reserve( vertices.size() );
+   for( unsigned int i = 0; i < indices.size(); ++i ){
+      GLuint &Target = Remap[ indices[i] ];
+      if( Target == Unused ){
+         Target = Ordered.size();
+         Ordered.push_back( vertices[ indices[i] ] );
+      }
+      indices[i] = Target;
+   }
+   vertices.swap( Ordered );
+}
+
+GLfloat ReturnACMR( const vector <GLuint> &indices, unsigned int vertex_count, int cache_size ){
+   if( indices.size() < 3 ){
+      return 0.0f;
+   }
+   /*
+      Pamięć podręczna FIFO: wierzchołek jest w niej, gdy wszedł mniej niż cache_size chybień temu.
+   */
+   vector <long> Entered( vertex_count, -( cache_size + 1L ) );
+   long Misses = 0;
+   for( unsigned int i = 0; i < indices.size(); ++i ){
+      if( Misses - Entered[ indices[i] ] > cache_size ){
+         Entered[ indices[i] ] = Misses;
+         ++Misses;
+      }
+   }
+   return (GLfloat)Misses / ( indices.size() / 3 );
+}
+
+/*!
+   \brief Kwadryka błędu (symetryczna macierz 4x4): suma kwadratów odległości od płaszczyzn trójkątów.
+*/
+struct Quadric{
+   /*!
+      \brief Elementy: aa, ab, ac, ad, bb, bc, bd, cc, cd, dd (płaszczyzna ax + by + cz + d = 0).
+   */
+   double A[10];
+};
+
+/*!
+   \brief Dodaje płaszczyznę do kwadryki.
+*/
+static void QuadricAddPlane( Quadric &quadric, double a, double b, double c, double d ){
+   double Plane[10] = { a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d };
+   for( int i = 0; i < 10; ++i ){
+      quadric.A[i] += Plane[i];
+   }
+}
+
+/*!
+   \brief Błąd kwadryki (a + b) w punkcie position.
+*/
+static double QuadricError( const Quadric &a, const Quadric &b, const vec3 &position ){
+   double Q[10];
+   for( int i = 0; i < 10; ++i ){
+      Q[i] = a.A[i] + b.A[i];
+   }
+   double X = position.x, Y = position.y, Z = position.z;
+   double Error = Q[0] * X * X + 2.0 * Q[1] * X * Y + 2.0 * Q[2] * X * Z + 2.0 * Q[3] * X
+                + Q[4] * Y * Y + 2.0 * Q[5] * Y * Z + 2.0 * Q[6] * Y
+                + Q[7] * Z * Z + 2.0 * Q[8] * Z + Q[9];
+   return std::max( Error, 0.0 );
+}
+
+/*!
+   \brief Łączenie krawędzi: wierzchołek From przechodzi do wierzchołka To.
+*/
+struct EdgeCollapse{
+   GLuint From;
+   GLuint To;
+   double Error;
+};
+
+GLfloat SimplifyMesh( const vector <Vertex> &vertices, const vector <GLuint> &indices, unsigned int target_index_count, vector <GLuint> &result ){
+   PROFILE_SCOPE( "SimplifyMesh" );
+   result = indices;
+   unsigned int VertexCount = vertices.size();
+   if( result.size() <= target_index_count or VertexCount == 0 ){
+      return 0.0f;
+   }
+   /*
+      Zablokowane wierzchołki: szwy (ta sama pozycja w kilku wierzchołkach) i brzegi (krawędź tylko w jednym trójkącie).
+   */
+   vector <uint8_t> Locked( VertexCount, 0 );
+   vector <GLuint> Order( VertexCount );
+   for( GLuint i = 0; i < VertexCount; ++i ){
+      Order[i] = i;
+   }
+   sort( Order.begin(), Order.end(), [&vertices]( GLuint a, GLuint b ){
+      const vec3 &A = vertices[a].Position, &B = vertices[b].Position;
+      return A.x != B.x ? A.x < B.x : ( A.y != B.y ? A.y < B.y : A.z < B.z );
+   } );
+   for( GLuint i = 1; i < VertexCount; ++i ){
+      if( vertices[ Order[i] ].Position == vertices[ Order[ i - 1 ] ].Position ){
+         Locked[ Order[i] ] = Locked[ Order[ i - 1 ] ] = 1;
+      }
+   }
+   vector <uint64_t> Edges;
+   Edges.reserve( result.size() );
+   for( unsigned int i = 0; i + 2 < result.size(); i += 3 ){
+      for( int e = 0; e < 3; ++e ){
+         GLuint A = result[ i + e ], B = result[ i + ( e + 1 ) % 3 ];
+         Edges.push_back( (uint64_t)std::min( A, B ) << 32 | std::max( A, B ) );
+      }
+   }
+   sort( Edges.begin(), Edges.end() );
+   for( unsigned int i = 0; i < Edges.size(); ){
+      unsigned int End = i + 1;
+      while( End < Edges.size() and Edges[ End ] == Edges[i] ){
+         ++End;
+      }
+      if( End - i == 1 ){
+         Locked[ Edges[i] >> 32 ] = Locked[ Edges[i] & 0xFFFFFFFF ] = 1;
+      }
+      i = End;
+   }
+   /*
+      Kwadryki wierzchołków z płaszczyzn sąsiednich trójkątów.
+   */
+   vector <Quadric> Quadrics( VertexCount );
+   memset( Quadrics.data(), 0, Quadrics.size() * sizeof( Quadric ) );
+   for( unsigned int i = 0; i + 2 < result.size(); i += 3 ){
+      const vec3 &P0 = vertices[ result[i] ].Position, &P1 = vertices[ result[ i + 1 ] ].Position, &P2 = vertices[ result[ i + 2 ] ].Position;
+      vec3 Normal = cross( P1 - P0, P2 - P0 );
+      GLfloat Length = length( Normal );
+      if( Length == 0.0f ){
+         continue;
+      }
+      Normal /= Length;
+      for( int k = 0; k < 3; ++k ){
+         QuadricAddPlane( Quadrics[ result[ i + k ] ], Normal.x, Normal.y, Normal.z, -dot( Normal, P0 ) );
+      }
+   }
+   double MaxError = 0.0;
+   vector <EdgeCollapse> Collapses;
+   vector <GLuint> Remap( VertexCount );
+   vector <uint8_t> Touched( VertexCount );
+   vector <unsigned int> Offsets( VertexCount + 1 ), Adjacency;
+   for( int Pass = 0; Pass < MESH_OPTIMIZER_SIMPLIFY_PASSES and result.size() > target_index_count; ++Pass ){
+      /*
+         Trójkąty każdego wierzchołka (Offsets + Adjacency).
+      */
+      unsigned int TriangleCount = result.size() / 3;
+      fill( Offsets.begin(), Offsets.end(), 0 );
+      for( unsigned int i = 0; i < result.size(); ++i ){
+         ++Offsets[ result[i] + 1 ];
+      }
+      for( GLuint i = 0; i < VertexCount; ++i ){
+         Offsets[ i + 1 ] += Offsets[i];
+      }
+      Adjacency.resize( result.size() );
+      vector <unsigned int> Fill( Offsets.begin(), Offsets.end() - 1 );
+      for( unsigned int i = 0; i < result.size(); ++i ){
+         Adjacency[ Fill[ result[i] ]++ ] = i / 3;
+      }
+      /*
+         Krawędzie od najmniejszego błędu (wierzchołek przesuwany do sąsiada).
+      */
+      Collapses.clear();
+      for( unsigned int i = 0; i < result.size(); ++i ){
+         GLuint From = result[i], To = result[ i / 3 * 3 + ( i + 1 ) % 3 ];
+         for( int Direction = 0; Direction < 2; ++Direction, swap( From, To ) ){
+            if( ! Locked[ From ] ){
+               EdgeCollapse Collapse = { From, To, QuadricError( Quadrics[ From ], Quadrics[ To ], vertices[ To ].Position ) };
+               Collapses.push_back( Collapse );
+            }
+         }
+      }
+      sort( Collapses.begin(), Collapses.end(), []( const EdgeCollapse &a, const EdgeCollapse &b ){
+         return a.Error < b.Error;
+      } );
+      for( GLuint i = 0; i < VertexCount; ++i ){
+         Remap[i] = i;
+      }
+      fill( Touched.begin(), Touched.end(), 0 );
+      bool Changed = false;
+      for( unsigned int c = 0; c < Collapses.size() and TriangleCount * 3 > target_index_count; ++c ){
+         const EdgeCollapse &Collapse = Collapses[c];
+         if( Touched[ Collapse.From ] or Touched[ Collapse.To ] ){
+            continue;
+         }
+         /*
+            Trójkąty wokół From bez To nie mogą się odwrócić, trójkąty z From i To znikają.
+         */
+         bool Flip = false;
+         unsigned int Removed = 0;
+         for( unsigned int a = Offsets[ Collapse.From ]; a < Offsets[ Collapse.From + 1 ] and ! Flip; ++a ){
+            const GLuint *Triangle = &result[ Adjacency[a] * 3 ];
+            if( Triangle[0] == Collapse.To or Triangle[1] == Collapse.To or Triangle[2] == Collapse.To ){
+               ++Removed;
+               continue;
+            }
+            vec3 Before[3], After[3];
+            for( int k = 0; k < 3; ++k ){
+               Before[k] = vertices[ Triangle[k] ].Position;
+               After[k] = ( Triangle[k] == Collapse.From ) ? vertices[ Collapse.To ].Position : Before[k];
+            }
+            Flip = dot( cross( Before[1] - Before[0], Before[2] - Before[0] ), cross( After[1] - After[0], After[2] - After[0] ) ) <= 0.0f;
+         }
+         if( Flip ){
+            continue;
+         }
+         Remap[ Collapse.From ] = Collapse.To;
+         for( int i = 0; i < 10; ++i ){
+            Quadrics[ Collapse.To ].A[i] += Quadrics[ Collapse.From ].A[i];
+         }
+         MaxError = std::max( MaxError, Collapse.Error );
+         for( unsigned int a = Offsets[ Collapse.From ]; a < Offsets[ Collapse.From + 1 ]; ++a ){
+            for( int k = 0; k < 3; ++k ){
+               Touched[ result[ Adjacency[a] * 3 + k ] ] = 1;
+            }
+         }
+         TriangleCount -= Removed;
+         Changed = true;
+      }
+      if( ! Changed ){
+         break;
+      }
+      /*
+         Nowe indeksy bez trójkątów zdegenerowanych.
+      */
+      unsigned int Write = 0;
+      for( unsigned int i = 0; i + 2 < result.size(); i += 3 ){
+         GLuint A = Remap[ result[i] ], B = Remap[ result[ i + 1 ] ], C = Remap[ result[ i + 2 ] ];
+         if( A == B or B == C or A == C ){
+            continue;
+         }
+         result[ Write++ ] = A;
+         result[ Write++ ] = B;
+         result[ Write++ ] = C;
+      }
+      result.resize( Write );
+   }
+   return (GLfloat)sqrt( MaxError );
+}
+
+void BuildLods( const vector <Vertex> &vertices, vector <GLuint> &indices, vector <MeshPart> &parts, vector <MeshLod> &lods, int count ){
+   PROFILE_SCOPE( "BuildLods" );
+   GLuint PartCount = parts.size();
+   MeshLod Base = { 0, PartCount, 0.0f };
+   lods.assign( 1, Base );
+   vector <GLuint> Simplified;
+   for( int Level = 1; Level < count; ++Level ){
+      GLfloat Ratio = 1.0f / ( 1 << Level );
+      GLfloat Error = lods.back().Error;
+      vector <MeshPart> LevelParts;
+      vector <GLuint> LevelIndices;
+      unsigned int Previous = 0;
+      for( GLuint p = 0; p < PartCount; ++p ){
+         const MeshPart &Part = parts[p];
+         const MeshPart &PreviousPart = parts[ lods.back().FirstPart + p ];
+         Previous += PreviousPart.IndexCount;
+         /*
+            Każda część od poziomu 0 (błąd liczony względem obiektu wczytanego przez assimp).
+         */
+         vector <Vertex> PartVertices( vertices.begin() + Part.BaseVertex, vertices.begin() + Part.BaseVertex + Part.VertexCount );
+         vector <GLuint> PartIndices( indices.begin() + Part.FirstIndex, indices.begin() + Part.FirstIndex + Part.IndexCount );
+         unsigned int Target = std::max( 3u, (unsigned int)( Part.IndexCount * Ratio ) / 3 * 3 );
+         Error = std::max( Error, SimplifyMesh( PartVertices, PartIndices, Target, Simplified ) );
+         MeshPart LevelPart = Part;
+         LevelPart.FirstIndex = indices.size() + LevelIndices.size();
+         LevelPart.IndexCount = Simplified.size();
+         LevelParts.push_back( LevelPart );
+         LevelIndices.insert( LevelIndices.end(), Simplified.begin(), Simplified.end() );
+      }
+      /*
+         Za mało usuniętych trójkątów (np. prawie wszystkie wierzchołki zablokowane): kolejne poziomy nic nie dadzą.
+      */
+      if( LevelIndices.size() > Previous * 0.8f ){
+         break;
+      }
+      MeshLod Lod = { (GLuint)parts.size(), PartCount, Error };
+      parts.insert( parts.end(), LevelParts.begin(), LevelParts.end() );
+      indices.insert( indices.end(), LevelIndices.begin(), LevelIndices.end() );
+      lods.push_back( Lod );
+   }
+}
+
+/*!
+   \brief Sfera otaczająca i stożek normalnych trójkątów [ first, first + count ) części.
+*/
+static MeshCluster MakeCluster( const vector <Vertex> &vertices, const vector <GLuint> &indices, const MeshPart &part, GLuint part_index, GLuint first, GLuint count ){
+   MeshCluster Cluster;
+   Cluster.FirstIndex = first;
+   Cluster.IndexCount = count;
+   Cluster.Part = part_index;
+   vec3 Min = vertices[ part.BaseVertex + indices[ first ] ].Position, Max = Min;
+   for( GLuint i = first; i < first + count; ++i ){
+      const vec3 &Position = vertices[ part.BaseVertex + indices[i] ].Position;
+      Min = glm::min( Min, Position );
+      Max = glm::max( Max, Position );
+   }
+   Cluster.Center = ( Min + Max ) * 0.5f;
+   Cluster.Radius = 0.0f;
+   for( GLuint i = first; i < first + count; ++i ){
+      Cluster.Radius = std::max( Cluster.Radius, length( vertices[ part.BaseVertex + indices[i] ].Position - Cluster.Center ) );
+   }
+   /*
+      Oś stożka: średnia normalnych trójkątów, rozwarcie: największy kąt pomiędzy osią a normalną.
+   */
+   vector <vec3> Normals;
+   vec3 Axis( 0.0f );
+   for( GLuint i = first; i + 2 < first + count; i += 3 ){
+      const vec3 &P0 = vertices[ part.BaseVertex + indices[i] ].Position;
+      vec3 Normal = cross( vertices[ part.BaseVertex + indices[ i + 1 ] ].Position - P0, vertices[ part.BaseVertex + indices[ i + 2 ] ].Position - P0 );
+      GLfloat Length = length( Normal );
+      if( Length > 0.0f ){
+         Normals.push_back( Normal / Length );
+         Axis += Normals.back();
+      }
+   }
+   Cluster.ConeAxis = vec3( 0.0f, 0.0f, 1.0f );
+   Cluster.ConeCutoff = 1.0f;
+   GLfloat AxisLength = length( Axis );
+   if( Normals.empty() or AxisLength < 1e-6f ){
+      return Cluster;
+   }
+   Axis /= AxisLength;
+   GLfloat MinDot = 1.0f;
+   for( unsigned int i = 0; i < Normals.size(); ++i ){
+      MinDot = std::min( MinDot, dot( Axis, Normals[i] ) );
+   }
+   Cluster.ConeAxis = Axis;
+   /*
+      Stożek szerszy niż półprzestrzeń: część trójkątów zawsze zwrócona przodem.
+   */
+   if( MinDot > 0.0f ){
+      Cluster.ConeCutoff = sqrt( 1.0f - MinDot * MinDot );
+   }
+   return Cluster;
+}
+
+void BuildClusters( const vector <Vertex> &vertices, const vector <GLuint> &indices, const vector <MeshPart> &parts, GLuint part_count, vector <MeshCluster> &clusters ){
+   PROFILE_SCOPE( "BuildClusters" );
+   clusters.clear();
+   vector <GLuint> Seen;
+   for( GLuint p = 0; p < part_count; ++p ){
+      const MeshPart &Part = parts[p];
+      /*
+         Numer grupy, w której wierzchołek był ostatnio (różne wierzchołki aktualnej grupy).
+      */
+      Seen.assign( Part.VertexCount, (GLuint)-1 );
+      GLuint First = Part.FirstIndex, Vertices = 0, Group = 0;
+      for( GLuint i = Part.FirstIndex; i + 2 < Part.FirstIndex + Part.IndexCount; i += 3 ){
+         GLuint New = 0;
+         for( int k = 0; k < 3; ++k ){
+            New += Seen[ indices[ i + k ] ] != Group and ( k == 0 or indices[ i + k ] != indices[ i ] ) and ( k < 2 or indices[ i + 2 ] != indices[ i + 1 ] );
+         }
+         if( i > First and ( ( i - First ) / 3 >= MESH_OPTIMIZER_CLUSTER_TRIANGLES or Vertices + New > MESH_OPTIMIZER_CLUSTER_VERTICES ) ){
+            clusters.push_back( MakeCluster( vertices, indices, Part, p, First, i - First ) );
+            First = i;
+            Vertices = 0;
+            ++Group;
+         }
+         for( int k = 0; k < 3; ++k ){
+            if( Seen[ indices[ i + k ] ] != Group ){
+               Seen[ indices[ i + k ] ] = Group;
+               ++Vertices;
+            }
+         }
+      }
+      if( Part.IndexCount >= 3 ){
+         clusters.push_back( MakeCluster( vertices, indices, Part, p, First, Part.FirstIndex + Part.IndexCount / 3 * 3 - First ) );
+      }
+   }
+}
+
+#endif
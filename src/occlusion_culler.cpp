@@ -0,0 +1,344 @@
+/*!
+   \file occlusion_culler.cpp
+   \brief Plik odpowiedzialny za odrzucanie instancji zasłoniętych przez inne obiekty (zapytania GL_ANY_SAMPLES_PASSED).
+*/
+#ifndef __occlusion_culler_hpp__
+#define __occlusion_culler_hpp__
+
+/*!
+   \brief Ilość kolejnych wyników "zasłonięta", po których instancja nie jest rysowana.
+*/
+#define OCCLUSION_CULLER_HYSTERESIS 2
+/*!
+   \brief Co ile klatek sprawdzana jest instancja widoczna (zasłonięte sprawdzane są co klatkę).
+*/
+#define OCCLUSION_CULLER_VISIBLE_INTERVAL 4
+
+/*!
+   \brief Historia widoczności jednej instancji.
+*/
+struct OcclusionEntry{
+   /*!
+      \brief Zapytanie OpenGL (0 = jeszcze nieutworzone).
+   */
+   GLuint Query = 0;
+   /*!
+      \brief TRUE = wynik zapytania nie został jeszcze odczytany.
+   */
+   bool Pending = false;
+   /*!
+      \brief TRUE = instancja nie jest rysowana.
+   */
+   bool Occluded = false;
+   /*!
+      \brief Ilość kolejnych wyników "zasłonięta".
+   */
+   unsigned int OccludedResults = 0;
+   /*!
+      \brief Ostatnia klatka, w której instancja była w ostrosłupie widzenia.
+   */
+   unsigned long LastFrame = 0;
+   /*!
+      \brief Klatka, w której instancja weszła do ostrosłupa widzenia (starsze wyniki są pomijane).
+   */
+   unsigned long EnterFrame = 0;
+   /*!
+      \brief Klatka wysłania ostatniego zapytania.
+   */
+   unsigned long QueryFrame = 0;
+};
+
+/*!
+   \brief Klasa odpowiedzialna za odrzucanie instancji zasłoniętych przez obiekty narysowane w poprzednich klatkach.
+
+   Po narysowaniu klatki ( \link Issue() \endlink ) prostopadłościany otaczające instancji rysowane są bez zapisu koloru i głębi
+   w zapytaniach GL_ANY_SAMPLES_PASSED. Wyniki odczytywane są w kolejnych klatkach ( \link Filter() \endlink ) tylko, gdy są gotowe,
+   więc CPU nie czeka na GPU. Instancja przestaje być rysowana po \link OCCLUSION_CULLER_HYSTERESIS \endlink kolejnych wynikach "zasłonięta",
+   a wraca po pierwszym wyniku "widoczna" (z opóźnieniem jednej lub kilku klatek). Zasłonięte instancje sprawdzane są co klatkę,
+   widoczne co \link OCCLUSION_CULLER_VISIBLE_INTERVAL \endlink klatek.\n
+   Zasłonięta instancja z niegotowym wynikiem zapytania jest rysowana warunkowo ( \link ReturnConditional() \endlink, glBeginConditionalRender):
+   GPU pomija rysowanie według wyniku tego zapytania, więc instancja, która stała się widoczna, pojawia się bez opóźnienia.
+*/
+class OcclusionCuller{
+   public:
+      /*!
+         \brief Konstruktor domyślny.
+      */
+      OcclusionCuller();
+      /*!
+         \brief Tworzy program, VAO sześcianu i ustala uniform macierzy.
+
+         \param vertex - ścieżka do shadera wierzchołków
+         \param fragment - ścieżka do shadera fragmentu
+         \return - TRUE = program utworzony
+      */
+      bool Init( string vertex, string fragment );
+      /*!
+         \brief Zwraca TRUE, gdy odrzucanie jest włączone (wywołano \link Init() \endlink ).
+      */
+      bool IsEnabled() const;
+      /*!
+         \brief Odczytuje gotowe wyniki zapytań i ukrywa zasłonięte instancje (po \link FrustumCuller::Cull() \endlink ).
+
+         \param items - obiekty
+         \param culler - widoczność instancji w ostrosłupie widzenia
+         \param camera_position - pozycja kamery (kamera wewnątrz prostopadłościanu = instancja widoczna)
+         \param stats - liczniki klatki (zasłonięte instancje)
+      */
+      void Filter( const vector <Mesh> &items, FrustumCuller &culler, vec3 camera_position, FrameStats &stats );
+      /*!
+         \brief Wysyła zapytania dla instancji wybranych w \link Filter() \endlink (po narysowaniu obiektów, z buforem głębi klatki).
+
+         \param items - obiekty
+         \param view_projection - iloczyn macierzy projekcji i widoku
+         \param state - stan OpenGL
+         \param stats - liczniki klatki (ilość zapytań)
+      */
+      void Issue( const vector <Mesh> &items, const mat4 &view_projection, StateCache &state, FrameStats &stats );
+      /*!
+         \brief Zwraca ukryte instancje (obiekt, instancja) rysowane warunkowo w tej klatce (po \link Filter() \endlink ).
+      */
+      const vector <BVHHit> & ReturnConditional() const;
+      /*!
+         \brief Zwraca zapytanie instancji dla glBeginConditionalRender.
+
+         \param item - numer obiektu
+         \param instance - numer instancji
+      */
+      GLuint ReturnQuery( GLuint item, GLsizei instance ) const;
+      /*!
+         \brief Usuwa zapytania, bufory i program (przed usunięciem kontekstu OpenGL).
+      */
+      void Destroy();
+   private:
+      /*!
+         \brief Program rysujący prostopadłościany.
+      */
+      GLuint Program = 0;
+      /*!
+         \brief Uniform macierzy prostopadłościanu.
+      */
+      GLint UniformBox = -1;
+      /*!
+         \brief VAO sześcianu [0, 1].
+      */
+      GLuint VAO = 0;
+      /*!
+         \brief Bufor wierzchołków sześcianu.
+      */
+      GLuint VBO = 0;
+      /*!
+         \brief Bufor indeksów sześcianu.
+      */
+      GLuint EBO = 0;
+      /*!
+         \brief Numer klatki.
+      */
+      unsigned long Frame = 0;
+      /*!
+         \brief Historia widoczności instancji każdego obiektu.
+      */
+      vector < vector <OcclusionEntry> > Entries;
+      /*!
+         \brief Instancje (obiekt, instancja) do sprawdzenia w \link Issue() \endlink.
+      */
+      vector <BVHHit> Candidates;
+      /*!
+         \brief Zasłonięte instancje z wysłanym, niegotowym zapytaniem (rysowane warunkowo).
+      */
+      vector <BVHHit> Conditional;
+};
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+OcclusionCuller::OcclusionCuller(){
+}
+
+bool OcclusionCuller::Init( string vertex, string fragment ){
+   this->Program = CreateShader( vertex, fragment );
+   if( this->Program <= 0 ){
+      cout<<"Occlusion shader error: "<<this->Program<<"\n";
+      this->Program = 0;
+      return false;
+   }
+   this->UniformBox = glGetUniformLocation( this->Program, "boxMatrix" );
+   const GLfloat Corners[] = {
+      0.0f, 0.0f, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f, 0.0f,
+      0.0f, 0.0f, 1.0f,   1.0f, 0.0f, 1.0f,   1.0f, 1.0f, 1.0f,   0.0f, 1.0f, 1.0f
+   };
+   const GLubyte Indices[] = {
+      0, 2, 1,   0, 3, 2,
+      4, 5, 6,   4, 6, 7,
+      0, 1, 5,   0, 5, 4,
+      3, 6, 2,   3, 7, 6,
+      0, 4, 7,   0, 7, 3,
+      1, 2, 6,   1, 6, 5
+   };
+   glGenVertexArrays( 1, &this->VAO );
+   glGenBuffers( 1, &this->VBO );
+   glGenBuffers( 1, &this->EBO );
+   glBindVertexArray( this->VAO );
+   glBindBuffer( GL_ARRAY_BUFFER, this->VBO );
+   glBufferData( GL_ARRAY_BUFFER, sizeof( Corners ), Corners, GL_STATIC_DRAW );
+   glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, this->EBO );
+   glBufferData( GL_ELEMENT_ARRAY_BUFFER, sizeof( Indices ), Indices, GL_STATIC_DRAW );
+   glEnableVertexAttribArray( 0 );
+   glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof( GLfloat ), (GLvoid *)0 );
+   glBindVertexArray( 0 );
+   glBindBuffer( GL_ARRAY_BUFFER, 0 );
+   return true;
+}
+
+bool OcclusionCuller::IsEnabled() const{
+   return this->Program != 0;
+}
+
+void OcclusionCuller::Filter( const vector <Mesh> &items, FrustumCuller &culler, vec3 camera_position, FrameStats &stats ){
+   PROFILE_SCOPE( "OcclusionCuller::Filter" );
+   ++this->Frame;
+   this->Candidates.clear();
+   this->Conditional.clear();
+   if( this->Entries.size() < items.size() ){
+      this->Entries.resize( items.size() );
+   }
+   unsigned long Occluded = 0;
+   for( unsigned int i = 0; i < items.size(); ++i ){
+      if( culler.ReturnVisibleCount( i ) == 0 ){
+         continue;
+      }
+      vector <OcclusionEntry> &ItemEntries = this->Entries[i];
+      if( ItemEntries.size() < (size_t)items[i].ReturnInstanceCount() ){
+         ItemEntries.resize( items[i].ReturnInstanceCount() );
+      }
+      for( GLsizei k = 0; k < items[i].ReturnInstanceCount(); ++k ){
+         if( ! culler.IsVisible( i, k ) ){
+            continue;
+         }
+         OcclusionEntry &Entry = ItemEntries[k];
+         /*
+            Instancja wróciła do ostrosłupa widzenia: historia sprzed wyjścia nie obowiązuje.
+         */
+         if( Entry.LastFrame + 1 != this->Frame ){
+            Entry.Occluded = false;
+            Entry.OccludedResults = 0;
+            Entry.EnterFrame = this->Frame;
+         }
+         Entry.LastFrame = this->Frame;
+         if( Entry.Pending ){
+            GLuint Available = 0;
+            glGetQueryObjectuiv( Entry.Query, GL_QUERY_RESULT_AVAILABLE, &Available );
+            if( Available ){
+               GLuint Passed = 0;
+               glGetQueryObjectuiv( Entry.Query, GL_QUERY_RESULT, &Passed );
+               Entry.Pending = false;
+               if( Entry.QueryFrame >= Entry.EnterFrame ){
+                  Entry.OccludedResults = Passed ? 0 : Entry.OccludedResults + 1;
+                  Entry.Occluded = Entry.OccludedResults >= OCCLUSION_CULLER_HYSTERESIS;
+               }
+            }
+         }
+         /*
+            Kamera wewnątrz prostopadłościanu (z zapasem na płaszczyznę bliską): ściany byłyby obcięte, instancja zawsze widoczna.
+         */
+         const MeshBounds &Bounds = items[i].ReturnWorldBounds( k );
+         vec3 Margin = ( Bounds.Max - Bounds.Min ) * 0.01f + vec3( 0.2f );
+         vec3 Min = Bounds.Min - Margin, Max = Bounds.Max + Margin;
+         if( camera_position.x >= Min.x and camera_position.y >= Min.y and camera_position.z >= Min.z and
+             camera_position.x <= Max.x and camera_position.y <= Max.y and camera_position.z <= Max.z ){
+            Entry.Occluded = false;
+            Entry.OccludedResults = 0;
+            continue;
+         }
+         if( ! Entry.Pending and ( Entry.Occluded or ( this->Frame + k ) % OCCLUSION_CULLER_VISIBLE_INTERVAL == 0 or this->Frame == Entry.EnterFrame ) ){
+            BVHHit Candidate = { i, k };
+            this->Candidates.push_back( Candidate );
+         }
+         if( Entry.Occluded ){
+            culler.Hide( i, k );
+            ++Occluded;
+            /*
+               Wynik jeszcze nieodczytany: rysowanie zależy od niego na GPU (bez czekania CPU).
+            */
+            if( Entry.Pending ){
+               BVHHit Hit = { i, k };
+               this->Conditional.push_back( Hit );
+            }
+         }
+      }
+   }
+   stats.Add( COUNTER_OCCLUDED, Occluded );
+}
+
+void OcclusionCuller::Issue( const vector <Mesh> &items, const mat4 &view_projection, StateCache &state, FrameStats &stats ){
+   PROFILE_SCOPE( "OcclusionCuller::Issue" );
+   if( this->Candidates.empty() ){
+      return;
+   }
+   /*
+      Tylko test głębi z buforem narysowanej klatki, obie strony ścian (kamera może być blisko prostopadłościanu).
+   */
+   glColorMask( GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE );
+   glDepthMask( GL_FALSE );
+   glDisable( GL_CULL_FACE );
+   state.UseProgram( this->Program );
+   state.BindVertexArray( this->VAO );
+   for( unsigned int i = 0; i < this->Candidates.size(); ++i ){
+      OcclusionEntry &Entry = this->Entries[ this->Candidates[i].Item ][ this->Candidates[i].Instance ];
+      if( Entry.Query == 0 ){
+         glGenQueries( 1, &Entry.Query );
+      }
+      /*
+         Prostopadłościan minimalnie powiększony, aby ściany nie pokrywały się z powierzchnią samego obiektu.
+      */
+      const MeshBounds &Bounds = items[ this->Candidates[i].Item ].ReturnWorldBounds( this->Candidates[i].Instance );
+      vec3 Margin = ( Bounds.Max - Bounds.Min ) * 0.01f + vec3( 0.01f );
+      vec3 Min = Bounds.Min - Margin, Size = Bounds.Max - Bounds.Min + 2.0f * Margin;
+      state.UniformMatrix4( this->UniformBox, view_projection * scale( translate( mat4( 1.0f ), Min ), Size ) );
+      glBeginQuery( GL_ANY_SAMPLES_PASSED, Entry.Query );
+      glDrawElements( GL_TRIANGLES, 36, GL_UNSIGNED_BYTE, (GLvoid *)0 );
+      glEndQuery( GL_ANY_SAMPLES_PASSED );
+      Entry.Pending = true;
+      Entry.QueryFrame = this->Frame;
+   }
+   glEnable( GL_CULL_FACE );
+   glDepthMask( GL_TRUE );
+   glColorMask( GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE );
+   stats.Add( COUNTER_OCCLUSION_QUERIES, this->Candidates.size() );
+}
+
+const vector <BVHHit> & OcclusionCuller::ReturnConditional() const{
+   return this->Conditional;
+}
+
+GLuint OcclusionCuller::ReturnQuery( GLuint item, GLsizei instance ) const{
+   return this->Entries[ item ][ instance ].Query;
+}
+
+void OcclusionCuller::Destroy(){
+   for( unsigned int i = 0; i < this->Entries.size(); ++i ){
+      for( unsigned int k = 0; k < this->Entries[i].size(); ++k ){
+         if( this->Entries[i][k].Query != 0 ){
+            glDeleteQueries( 1, &this->Entries[i][k].Query );
+         }
+      }
+   }
+   this->Entries.clear();
+   this->Candidates.clear();
+   this->Conditional.clear();
+   glDeleteBuffers( 1, &this->VBO );
+   glDeleteBuffers( 1, &this->EBO );
+   glDeleteVertexArrays( 1, &this->VAO );
+   if( this->Program != 0 ){
+      glDeleteProgram( this->Program );
+   }
+   this->VBO = 0;
+   this->EBO = 0;
+   this->VAO = 0;
+   this->Program = 0;
+}
+
+#endif
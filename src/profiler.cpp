@@ -0,0 +1,375 @@
+/*!
+   \file profiler.cpp
+   \brief Plik odpowiedzialny za pomiar czasu fragmentów kodu (profiler CPU) i zapis do formatu Chrome Trace.
+
+   Pomiar włączany jest podczas kompilacji flagą PROFILER (make PROFILER=1).
+   Bez tej flagi makra \link PROFILE_SCOPE \endlink i \link PROFILE_SCOPE_DETAIL \endlink są puste.
+*/
+#ifndef __profiler_hpp__
+#define __profiler_hpp__
+
+#define PROFILE_CONCAT_( a, b ) a##b
+#define PROFILE_CONCAT( a, b ) PROFILE_CONCAT_( a, b )
+
+#ifdef PROFILER
+   /*!
+      \brief Mierzy czas od miejsca wywołania do końca aktualnego bloku kodu.
+
+      \param name - nazwa mierzonego fragmentu (stały tekst)
+   */
+   #define PROFILE_SCOPE( name ) ProfilerScope PROFILE_CONCAT( ProfilerScope_, __LINE__ )( name )
+   /*!
+      \brief Jak \link PROFILE_SCOPE \endlink, z dodatkowym opisem (np. nazwą obiektu).
+
+      \param name - nazwa mierzonego fragmentu (stały tekst)
+      \param detail - dodatkowy opis (string)
+   */
+   #define PROFILE_SCOPE_DETAIL( name, detail ) ProfilerScope PROFILE_CONCAT( ProfilerScope_, __LINE__ )( name, detail )
+   /*!
+      \brief Ustala nazwę aktualnego wątku w pliku Chrome Trace.
+
+      \param name - nazwa wątku (stały tekst)
+   */
+   #define PROFILE_THREAD( name ) Profiler::SetThreadName( name )
+#else
+   #define PROFILE_SCOPE( name )
+   #define PROFILE_SCOPE_DETAIL( name, detail )
+   #define PROFILE_THREAD( name )
+#endif
+
+/*!
+   \brief Jeden zmierzony fragment kodu.
+*/
+struct ProfilerEvent{
+   /*!
+      \brief Nazwa fragmentu.
+   */
+   const char *Name;
+   /*!
+      \brief Dodatkowy opis.
+   */
+   string Detail;
+   /*!
+      \brief Początek (SDL_GetPerformanceCounter).
+   */
+   Uint64 Start;
+   /*!
+      \brief Koniec (SDL_GetPerformanceCounter).
+   */
+   Uint64 End;
+};
+
+/*!
+   \brief Zmierzone fragmenty jednego wątku (osobna ścieżka w Chrome Trace).
+*/
+struct ProfilerThread{
+   /*!
+      \brief Numer wątku w pliku Chrome Trace.
+   */
+   int Id;
+   /*!
+      \brief Nazwa wątku.
+   */
+   const char *Name;
+   /*!
+      \brief Wszystkie zmierzone fragmenty wątku.
+   */
+   vector <ProfilerEvent> Events;
+};
+
+/*!
+   \brief Klasa odpowiedzialna za zbieranie zmierzonych fragmentów ze wszystkich wątków i zapis do pliku JSON (Chrome Trace / Perfetto).
+
+   Każdy wątek zapisuje do własnego bufora (bez blokowania), blokada jest potrzebna tylko przy pierwszym pomiarze w wątku.
+*/
+class Profiler{
+   public:
+      /*!
+         \brief Włącza lub wyłącza zbieranie pomiarów.
+
+         \param enable - TRUE = zbieranie pomiarów
+      */
+      static void Enable( bool enable );
+      /*!
+         \brief Zwraca TRUE, gdy pomiary są zbierane.
+      */
+      static bool IsEnabled();
+      /*!
+         \brief Ustala nazwę aktualnego wątku.
+
+         \param name - nazwa wątku (stały tekst)
+      */
+      static void SetThreadName( const char *name );
+      /*!
+         \brief Dodaje zmierzony fragment dla aktualnego wątku.
+
+         \param name - nazwa fragmentu (stały tekst)
+         \param detail - dodatkowy opis
+         \param start - początek (SDL_GetPerformanceCounter)
+         \param end - koniec (SDL_GetPerformanceCounter)
+      */
+      static void AddEvent( const char *name, const string &detail, Uint64 start, Uint64 end );
+      /*!
+         \brief Dodaje zmierzony fragment dla dodatkowej ścieżki (np. czasów GPU), niezależnej od wątków.
+
+         \param track - nazwa ścieżki (stały tekst)
+         \param name - nazwa fragmentu (stały tekst)
+         \param detail - dodatkowy opis
+         \param start - początek (w jednostkach SDL_GetPerformanceCounter)
+         \param end - koniec (w jednostkach SDL_GetPerformanceCounter)
+      */
+      static void AddTrackEvent( const char *track, const char *name, const string &detail, Uint64 start, Uint64 end );
+      /*!
+         \brief Zamienia czas z SDL_GetPerformanceCounter na mikrosekundy od początku pomiaru.
+
+         \param counter - czas (SDL_GetPerformanceCounter)
+      */
+      static double ReturnMicroseconds( Uint64 counter );
+      /*!
+         \brief Zapisuje wszystkie pomiary do pliku JSON (Chrome Trace).
+
+         \param file - ścieżka do pliku wyjściowego
+         \return - wartość logiczną dla zapisu pliku, FALSE = błąd
+
+         Wywoływać, gdy żaden inny wątek nie wykonuje pomiarów.
+      */
+      static bool Save( string file );
+      /*!
+         \brief Zapisuje tekst jako napis JSON (z ucieczką cudzysłowu, ukośnika wstecznego i znaków sterujących), również dla \link Benchmark \endlink.
+
+         \param output - strumień wyjściowy
+         \param text - tekst
+      */
+      static void SaveString( ostream &output, const string &text );
+   private:
+      /*!
+         \brief Zwraca bufor aktualnego wątku, tworzy go przy pierwszym wywołaniu w wątku.
+      */
+      static ProfilerThread * ReturnThread();
+      /*!
+         \brief Zwraca bufor dodatkowej ścieżki o podanej nazwie, tworzy go przy pierwszym wywołaniu.
+
+         \param track - nazwa ścieżki
+      */
+      static ProfilerThread * ReturnTrack( const char *track );
+      /*!
+         \brief TRUE = pomiary są zbierane.
+      */
+      static bool Enabled;
+      /*!
+         \brief Początek pomiaru (SDL_GetPerformanceCounter).
+      */
+      static Uint64 Origin;
+      /*!
+         \brief Bufory wszystkich wątków i dodatkowych ścieżek.
+      */
+      static vector <ProfilerThread *> Threads;
+      /*!
+         \brief Blokada dla wektora \link Threads \endlink.
+      */
+      static mutex Lock;
+};
+
+/*!
+   \brief Mierzy czas życia obiektu i dodaje go do \link Profiler \endlink (patrz \link PROFILE_SCOPE \endlink).
+*/
+class ProfilerScope{
+   public:
+      /*!
+         \brief Rozpoczyna pomiar.
+
+         \param name - nazwa fragmentu (stały tekst)
+      */
+      ProfilerScope( const char *name );
+      /*!
+         \brief Rozpoczyna pomiar z dodatkowym opisem.
+
+         \param name - nazwa fragmentu (stały tekst)
+         \param detail - dodatkowy opis
+      */
+      ProfilerScope( const char *name, const string &detail );
+      /*!
+         \brief Kończy pomiar.
+      */
+      ~ProfilerScope();
+   private:
+      /*!
+         \brief Nazwa fragmentu.
+      */
+      const char *Name;
+      /*!
+         \brief Dodatkowy opis.
+      */
+      string Detail;
+      /*!
+         \brief Początek pomiaru (SDL_GetPerformanceCounter), 0 = pomiary wyłączone.
+      */
+      Uint64 Start;
+};
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+bool Profiler::Enabled = false;
+Uint64 Profiler::Origin = 0;
+vector <ProfilerThread *> Profiler::Threads;
+mutex Profiler::Lock;
+
+void Profiler::Enable( bool enable ){
+   if( enable and Profiler::Origin == 0 ){
+      Profiler::Origin = SDL_GetPerformanceCounter();
+   }
+   Profiler::Enabled = enable;
+}
+
+bool Profiler::IsEnabled(){
+   return Profiler::Enabled;
+}
+
+void Profiler::SetThreadName( const char *name ){
+   Profiler::ReturnThread()->Name = name;
+}
+
+void Profiler::AddEvent( const char *name, const string &detail, Uint64 start, Uint64 end ){
+   ProfilerEvent Event;
+   Event.Name = name;
+   Event.Detail = detail;
+   Event.Start = start;
+   Event.End = end;
+   Profiler::ReturnThread()->Events.push_back( Event );
+}
+
+void Profiler::AddTrackEvent( const char *track, const char *name, const string &detail, Uint64 start, Uint64 end ){
+   ProfilerEvent Event;
+   Event.Name = name;
+   Event.Detail = detail;
+   Event.Start = start;
+   Event.End = end;
+   Profiler::ReturnTrack( track )->Events.push_back( Event );
+}
+
+double Profiler::ReturnMicroseconds( Uint64 counter ){
+   return (double)( counter - Profiler::Origin ) * 1000000.0 / SDL_GetPerformanceFrequency();
+}
+
+ProfilerThread * Profiler::ReturnThread(){
+   /*
+      Każdy wątek ma własny bufor, więc dodawanie pomiarów nie wymaga blokady.
+   */
+   static thread_local ProfilerThread *Thread = NULL;
+   if( Thread == NULL ){
+      lock_guard <mutex> Guard( Profiler::Lock );
+      Thread = new ProfilerThread();
+      Thread->Id = Profiler::Threads.size() + 1;
+      Thread->Name = "worker";
+      Profiler::Threads.push_back( Thread );
+   }
+   return Thread;
+}
+
+ProfilerThread * Profiler::ReturnTrack( const char *track ){
+   lock_guard <mutex> Guard( Profiler::Lock );
+   for( unsigned int i = 0; i < Profiler::Threads.size(); ++i ){
+      if( Profiler::Threads[i]->Id >= 1000 and string( Profiler::Threads[i]->Name ) == track ){
+         return Profiler::Threads[i];
+      }
+   }
+   ProfilerThread *Track = new ProfilerThread();
+   /*
+      Numery dodatkowych ścieżek zaczynają się od 1000, aby nie pokrywały się z numerami wątków.
+   */
+   Track->Id = 1000 + Profiler::Threads.size();
+   Track->Name = track;
+   Profiler::Threads.push_back( Track );
+   return Track;
+}
+
+void Profiler::SaveString( ostream &output, const string &text ){
+   output<<"\"";
+   for( unsigned int i = 0; i < text.size(); ++i ){
+      unsigned char Character = text[i];
+      if( Character == '"' or Character == '\\' ){
+         output<<'\\'<<text[i];
+      }
+      else if( Character < 0x20 ){
+         /*
+            Znaki sterujące jako \u00XX (bez zmiany flag strumienia).
+         */
+         const char *Hex = "0123456789abcdef";
+         output<<"\\u00"<<Hex[ Character >> 4 ]<<Hex[ Character & 0xF ];
+      }
+      else{
+         output<<text[i];
+      }
+   }
+   output<<"\"";
+}
+
+bool Profiler::Save( string file ){
+   fstream output;
+   output.open( file.c_str(), ios::out );
+   if( ! output.good() ){
+      cout<<"File error: "<<file<<"\n";
+      return false;
+   }
+   lock_guard <mutex> Guard( Profiler::Lock );
+   output<<fixed<<setprecision( 3 );
+   output<<"{\"traceEvents\":[\n";
+   bool First = true;
+   for( unsigned int i = 0; i < Profiler::Threads.size(); ++i ){
+      ProfilerThread *Thread = Profiler::Threads[i];
+      /*
+         Nazwa wątku.
+      */
+      output<<( First ? "" : ",\n" );
+      First = false;
+      output<<"{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"<<Thread->Id<<",\"args\":{\"name\":";
+      Profiler::SaveString( output, Thread->Name );
+      output<<"}}";
+      /*
+         Pomiary wątku jako zdarzenia "X" (początek i długość w mikrosekundach).
+      */
+      for( unsigned int j = 0; j < Thread->Events.size(); ++j ){
+         const ProfilerEvent &Event = Thread->Events[j];
+         double Start = Profiler::ReturnMicroseconds( Event.Start );
+         double Duration = Profiler::ReturnMicroseconds( Event.End ) - Start;
+         output<<",\n{\"name\":\""<<Event.Name<<"\",\"cat\":\""<<( Thread->Id >= 1000 ? Thread->Name : "cpu" )<<"\",\"ph\":\"X\",\"pid\":1,\"tid\":"<<Thread->Id
+               <<",\"ts\":"<<Start<<",\"dur\":"<<Duration;
+         if( ! Event.Detail.empty() ){
+            output<<",\"args\":{\"detail\":";
+            Profiler::SaveString( output, Event.Detail );
+            output<<"}";
+         }
+         output<<"}";
+      }
+   }
+   output<<"\n]}\n";
+   output.close();
+   cout<<"Trace: "<<file<<"\n";
+   return true;
+}
+
+ProfilerScope::ProfilerScope( const char *name ){
+   this->Name = name;
+   this->Start = Profiler::IsEnabled() ? SDL_GetPerformanceCounter() : 0;
+}
+
+ProfilerScope::ProfilerScope( const char *name, const string &detail ){
+   this->Name = name;
+   this->Start = 0;
+   if( Profiler::IsEnabled() ){
+      this->Detail = detail;
+      this->Start = SDL_GetPerformanceCounter();
+   }
+}
+
+ProfilerScope::~ProfilerScope(){
+   if( this->Start != 0 ){
+      Profiler::AddEvent( this->Name, this->Detail, this->Start, SDL_GetPerformanceCounter() );
+   }
+}
+
+#endif
@@ -0,0 +1,471 @@
+/*!
+   \file render_queue.cpp
+   \brief Plik odpowiedzialny za kolejkę rysowania posortowaną według stanu OpenGL.
+*/
+#ifndef __render_queue_hpp__
+#define __render_queue_hpp__
+
+/*!
+   \brief Bity klucza sortowania (od najstarszego): program 4, VAO 4, tekstura główna 18, tekstura spektralna 18, odległość 20.
+
+   Identyfikatory skracane są do ilości bitów pola (inne obiekty z tym samym skrótem rysowane są po prostu obok siebie).
+*/
+#define RENDER_QUEUE_PROGRAM_SHIFT 60
+#define RENDER_QUEUE_VAO_SHIFT 56
+#define RENDER_QUEUE_TEXTURE_SHIFT 38
+#define RENDER_QUEUE_SPECULAR_SHIFT 20
+#define RENDER_QUEUE_TEXTURE_MASK 0x3FFFF
+#define RENDER_QUEUE_DEPTH_BITS 20
+
+/*!
+   \brief Jedno rysowanie w kolejce (jedna część obiektu).
+*/
+struct RenderCommand{
+   /*!
+      \brief Klucz sortowania.
+   */
+   uint64_t Key;
+   /*!
+      \brief Numer obiektu w wektorze obiektów.
+   */
+   GLuint Item;
+   /*!
+      \brief Numer części obiektu (część poziomu szczegółowości partii).
+   */
+   GLuint Part;
+   /*!
+      \brief Numer partii (instancje obiektu z tym samym poziomem szczegółowości).
+   */
+   GLuint Batch;
+};
+
+/*!
+   \brief Instancje jednego obiektu rysowane z tym samym poziomem szczegółowości (jedno rysowanie na część).
+*/
+struct RenderBatch{
+   /*!
+      \brief Numer pierwszej instancji w buforze instancji, -1 = obiekt bez instancji (macierze z uniformów).
+   */
+   GLint InstanceOffset;
+   /*!
+      \brief Ilość rysowanych instancji.
+   */
+   GLsizei InstanceCount;
+   /*!
+      \brief Zapytanie o zasłonięcie dla glBeginConditionalRender ( \link OcclusionCuller::ReturnConditional() \endlink ), 0 = rysowanie bez warunku.
+   */
+   GLuint Query;
+};
+
+/*!
+   \brief Dane jednej instancji w buforze instancji (atrybuty 4-7 i 8-10, dzielnik 1).
+*/
+struct RenderInstance{
+   /*!
+      \brief Macierz modelu instancji.
+   */
+   mat4 Model;
+   /*!
+      \brief Macierz normalnych instancji.
+   */
+   mat3 Normal;
+};
+
+/*!
+   \brief Klasa odpowiedzialna za kolejkę rysowania: klucze 64 bity (program, VAO, tekstury, odległość) sortowane pozycyjnie (radix sort) co klatkę.
+
+   Rysowanie przez \link StateCache \endlink, więc tekstury i uniformy obiektów przekazywane są tylko przy zmianie.
+   W ramach tych samych tekstur obiekty rysowane są od najbliższego (mniej cieniowania zasłoniętych fragmentów).
+   Macierze modelu i normalnych instancji wszystkich obiektów z instancjami trafiają raz na klatkę do jednego bufora (atrybuty 4-7 i 8-10).
+   Macierz model-widok-projekcja liczona jest na CPU raz na obiekt.
+   Instancje obiektu dzielone są na partie według poziomu szczegółowości ( \link LodSelector \endlink ), każda partia rysuje części swojego poziomu.
+   Zasłonięta instancja z niegotowym wynikiem zapytania to osobna partia rysowana warunkowo (glBeginConditionalRender).
+*/
+class RenderQueue{
+   public:
+      /*!
+         \brief Konstruktor domyślny.
+      */
+      RenderQueue();
+      /*!
+         \brief Tworzy bufor instancji i ustala stałą wartość atrybutów 4-7 i 8-10 (macierze jednostkowe).
+
+         \param program - program shaderów
+         \param model - położenie uniformu macierzy modelu
+         \param model_view_projection - położenie uniformu macierzy model-widok-projekcja
+         \param normal - położenie uniformu macierzy normalnych
+         \param position_scale - położenie uniformu skali kwantyzowanej pozycji
+         \param position_offset - położenie uniformu przesunięcia kwantyzowanej pozycji
+      */
+      void Init( GLuint program, GLint model, GLint model_view_projection, GLint normal, GLint position_scale, GLint position_offset );
+      /*!
+         \brief Buduje i sortuje kolejkę dla widocznych instancji wczytanych obiektów.
+
+         \param items - obiekty
+         \param camera_position - pozycja kamery (odległość w kluczu)
+         \param culler - widoczność instancji (po \link FrustumCuller::Cull() \endlink )
+         \param lods - poziom szczegółowości instancji (po \link LodSelector::Select() \endlink )
+         \param occlusion - instancje rysowane warunkowo (po \link OcclusionCuller::Filter() \endlink )
+      */
+      void Build( const vector <Mesh> &items, vec3 camera_position, const FrustumCuller &culler, const LodSelector &lods, const OcclusionCuller &occlusion );
+      /*!
+         \brief Rysuje kolejkę.
+
+         \param items - obiekty (te same co w \link Build() \endlink )
+         \param view_projection - iloczyn macierzy projekcji i widoku kamery
+         \param state - stan OpenGL
+         \param clusters - widoczne grupy trójkątów (po \link ClusterCuller::Cull() \endlink ), części takich obiektów rysowane są zakresami grup
+         \param profiler - pomiar czasu GPU, znacznik "Draw" z nazwą obiektu po każdym ciągu poleceń jednego obiektu (gdy pomiar jest włączony)
+         \param stats - liczniki klatki
+      */
+      void Submit( const vector <Mesh> &items, const mat4 &view_projection, StateCache &state, const ClusterCuller &clusters, GpuProfiler &profiler, FrameStats &stats );
+      /*!
+         \brief Usuwa bufor instancji (przed usunięciem kontekstu OpenGL).
+      */
+      void Destroy();
+   private:
+      /*!
+         \brief Dodaje partię i polecenia rysowania części jej poziomu szczegółowości.
+
+         \param item - obiekt
+         \param index - numer obiektu
+         \param level - poziom szczegółowości
+         \param batch - partia
+         \param key - program, VAO i odległość w kluczu (tekstury dodawane dla każdej części)
+      */
+      void AddBatch( const Mesh &item, GLuint index, GLuint level, const RenderBatch &batch, uint64_t key );
+      /*!
+         \brief Sortowanie pozycyjne (LSD, 8 przebiegów po 8 bitów, stabilne) \link Commands \endlink według klucza.
+
+         Przebieg, w którym wszystkie klucze mają ten sam bajt, jest pomijany.
+      */
+      void Sort();
+      /*!
+         \brief Wyłącza atrybuty instancji 4-10 (wraca stała wartość macierzy jednostkowych).
+      */
+      void DisableInstances();
+      /*!
+         \brief Program shaderów.
+      */
+      GLuint Program = 0;
+      /*!
+         \brief Położenie uniformu macierzy modelu.
+      */
+      GLint UniformModel = -1;
+      /*!
+         \brief Położenie uniformu macierzy model-widok-projekcja.
+      */
+      GLint UniformModelViewProjection = -1;
+      /*!
+         \brief Położenie uniformu macierzy normalnych.
+      */
+      GLint UniformNormal = -1;
+      /*!
+         \brief Położenie uniformu skali kwantyzowanej pozycji.
+      */
+      GLint UniformPositionScale = -1;
+      /*!
+         \brief Położenie uniformu przesunięcia kwantyzowanej pozycji.
+      */
+      GLint UniformPositionOffset = -1;
+      /*!
+         \brief Bufor macierzy instancji.
+      */
+      GLuint InstanceBuffer = 0;
+      /*!
+         \brief Rysowania aktualnej klatki.
+      */
+      vector <RenderCommand> Commands;
+      /*!
+         \brief Bufor pomocniczy sortowania.
+      */
+      vector <RenderCommand> Scratch;
+      /*!
+         \brief Dane instancji aktualnej klatki.
+      */
+      vector <RenderInstance> Instances;
+      /*!
+         \brief Partie aktualnej klatki.
+      */
+      vector <RenderBatch> Batches;
+};
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+RenderQueue::RenderQueue(){
+}
+
+void RenderQueue::Init( GLuint program, GLint model, GLint model_view_projection, GLint normal, GLint position_scale, GLint position_offset ){
+   this->Program = program;
+   this->UniformModel = model;
+   this->UniformModelViewProjection = model_view_projection;
+   this->UniformNormal = normal;
+   this->UniformPositionScale = position_scale;
+   this->UniformPositionOffset = position_offset;
+   glGenBuffers( 1, &this->InstanceBuffer );
+   /*
+      Obiekty bez instancji: atrybuty 4-7 i 8-10 bez bufora mają stałą wartość macierzy jednostkowej.
+   */
+   for( int i = 0; i < 4; ++i ){
+      glVertexAttrib4f( 4 + i, i == 0, i == 1, i == 2, i == 3 );
+   }
+   for( int i = 0; i < 3; ++i ){
+      glVertexAttrib3f( 8 + i, i == 0, i == 1, i == 2 );
+   }
+}
+
+void RenderQueue::Build( const vector <Mesh> &items, vec3 camera_position, const FrustumCuller &culler, const LodSelector &lods, const OcclusionCuller &occlusion ){
+   PROFILE_SCOPE( "RenderQueue::Build" );
+   this->Commands.clear();
+   this->Instances.clear();
+   this->Batches.clear();
+   uint64_t Program = (uint64_t)( this->Program & 0xF ) << RENDER_QUEUE_PROGRAM_SHIFT;
+   uint64_t VAO = (uint64_t)( GeometryArena::ReturnVAO() & 0xF ) << RENDER_QUEUE_VAO_SHIFT;
+   for( unsigned int i = 0; i < items.size(); ++i ){
+      const Mesh &Item = items[i];
+      /*
+         Obiekt bez widocznych instancji nie trafia do kolejki.
+      */
+      if( ! Item.IsLoaded() or Item.ReturnGeometry() == 0 or culler.ReturnVisibleCount( i ) == 0 ){
+         continue;
+      }
+      /*
+         Odległość jako float: dla liczb dodatnich kolejność bitów jest taka sama jak kolejność wartości.
+      */
+      GLfloat Distance = length( Item.ReturnWorldBounds( 0 ).Center - camera_position );
+      uint32_t DistanceBits;
+      memcpy( &DistanceBits, &Distance, sizeof( DistanceBits ) );
+      uint64_t Depth = DistanceBits >> ( 31 - RENDER_QUEUE_DEPTH_BITS );
+      GLuint LastLod = Item.ReturnLods().size() - 1;
+      GLsizei Instances = Item.ReturnInstanceCount();
+      for( GLuint Level = 0; Level <= LastLod; ++Level ){
+         RenderBatch Batch = { -1, 0, 0 };
+         if( Instances > 1 ){
+            Batch.InstanceOffset = this->Instances.size();
+            for( GLsizei k = 0; k < Instances; ++k ){
+               if( ! culler.IsVisible( i, k ) or std::min( lods.ReturnLevel( i, k ), LastLod ) != Level ){
+                  continue;
+               }
+               RenderInstance Instance;
+               Instance.Model = Item.ReturnInstanceMatrix( k );
+               Instance.Normal = Item.ReturnInstanceNormalMatrix( k );
+               this->Instances.push_back( Instance );
+               ++Batch.InstanceCount;
+            }
+         }
+         else{
+            Batch.InstanceCount = ( std::min( lods.ReturnLevel( i, 0 ), LastLod ) == Level ) ? 1 : 0;
+         }
+         if( Batch.InstanceCount == 0 ){
+            continue;
+         }
+         this->AddBatch( Item, i, Level, Batch, Program | VAO | Depth );
+      }
+   }
+   /*
+      Ukryte instancje z niegotowym wynikiem zapytania: każda osobną partią z zapytaniem (poziom z ostatniej klatki, w której była widoczna).
+   */
+   const vector <BVHHit> &Conditional = occlusion.ReturnConditional();
+   for( unsigned int i = 0; i < Conditional.size(); ++i ){
+      const Mesh &Item = items[ Conditional[i].Item ];
+      GLsizei k = Conditional[i].Instance;
+      if( ! Item.IsLoaded() or Item.ReturnGeometry() == 0 ){
+         continue;
+      }
+      GLfloat Distance = length( Item.ReturnWorldBounds( k ).Center - camera_position );
+      uint32_t DistanceBits;
+      memcpy( &DistanceBits, &Distance, sizeof( DistanceBits ) );
+      uint64_t Depth = DistanceBits >> ( 31 - RENDER_QUEUE_DEPTH_BITS );
+      RenderBatch Batch = { -1, 1, occlusion.ReturnQuery( Conditional[i].Item, k ) };
+      if( Item.ReturnInstanceCount() > 1 ){
+         Batch.InstanceOffset = this->Instances.size();
+         RenderInstance Instance;
+         Instance.Model = Item.ReturnInstanceMatrix( k );
+         Instance.Normal = Item.ReturnInstanceNormalMatrix( k );
+         this->Instances.push_back( Instance );
+      }
+      GLuint LastLod = Item.ReturnLods().size() - 1;
+      this->AddBatch( Item, Conditional[i].Item, std::min( lods.ReturnLevel( Conditional[i].Item, k ), LastLod ), Batch, Program | VAO | Depth );
+   }
+   this->Sort();
+}
+
+void RenderQueue::AddBatch( const Mesh &item, GLuint index, GLuint level, const RenderBatch &batch, uint64_t key ){
+   const vector <MeshPart> &Parts = item.ReturnParts();
+   const MeshLod &Lod = item.ReturnLods()[ level ];
+   GLuint BatchIndex = this->Batches.size();
+   this->Batches.push_back( batch );
+   for( GLuint j = Lod.FirstPart; j < Lod.FirstPart + Lod.PartCount; ++j ){
+      if( Parts[j].IndexCount == 0 ){
+         continue;
+      }
+      RenderCommand Command;
+      Command.Key = key
+                  | (uint64_t)( item.ReturnTexture( Parts[j].Material ) & RENDER_QUEUE_TEXTURE_MASK ) << RENDER_QUEUE_TEXTURE_SHIFT
+                  | (uint64_t)( item.ReturnTextureSpecular( Parts[j].Material ) & RENDER_QUEUE_TEXTURE_MASK ) << RENDER_QUEUE_SPECULAR_SHIFT;
+      Command.Item = index;
+      Command.Part = j;
+      Command.Batch = BatchIndex;
+      this->Commands.push_back( Command );
+   }
+}
+
+void RenderQueue::Submit( const vector <Mesh> &items, const mat4 &view_projection, StateCache &state, const ClusterCuller &clusters, GpuProfiler &profiler, FrameStats &stats ){
+   PROFILE_SCOPE( "RenderQueue::Submit" );
+   if( this->Commands.empty() ){
+      return;
+   }
+   /*
+      Dane instancji wszystkich obiektów jednym wywołaniem.
+   */
+   if( ! this->Instances.empty() ){
+      glBindBuffer( GL_ARRAY_BUFFER, this->InstanceBuffer );
+      glBufferData( GL_ARRAY_BUFFER, this->Instances.size() * sizeof( RenderInstance ), this->Instances.data(), GL_STREAM_DRAW );
+   }
+   state.UseProgram( this->Program );
+   state.BindVertexArray( GeometryArena::ReturnVAO() );
+   GLuint Previous = (GLuint)-1;
+   bool Instanced = false;
+   for( unsigned int i = 0; i < this->Commands.size(); ++i ){
+      const RenderCommand &Command = this->Commands[i];
+      const Mesh &Item = items[ Command.Item ];
+      const MeshPart &Part = Item.ReturnParts()[ Command.Part ];
+      const RenderBatch &Batch = this->Batches[ Command.Batch ];
+      /*
+         Obiekt z grupami: część bez widocznych grup nie jest rysowana (partia warunkowa rysuje całe części).
+      */
+      const ClusterRanges *Ranges = ( Batch.Query == 0 and clusters.IsActive( Command.Item ) ) ? &clusters.ReturnRanges( Command.Item, Command.Part ) : NULL;
+      if( Ranges != NULL and Ranges->Counts.empty() ){
+         continue;
+      }
+      state.BindTexture( 0, Item.ReturnTexture( Part.Material ) );
+      state.BindTexture( 1, Item.ReturnTextureSpecular( Part.Material ) );
+      GLsizei Instances = Batch.InstanceCount;
+      if( Command.Batch != Previous ){
+         Previous = Command.Batch;
+         /*
+            Obiekt z instancjami: macierze jednostkowe, macierze widocznych instancji partii z bufora od położenia partii.
+         */
+         if( Batch.InstanceOffset >= 0 ){
+            state.UniformMatrix4( this->UniformModel, mat4( 1.0f ) );
+            state.UniformMatrix4( this->UniformModelViewProjection, view_projection );
+            state.UniformMatrix3( this->UniformNormal, mat3( 1.0f ) );
+            glBindBuffer( GL_ARRAY_BUFFER, this->InstanceBuffer );
+            GLsizeiptr Offset = Batch.InstanceOffset * sizeof( RenderInstance );
+            for( int k = 0; k < 4; ++k ){
+               glVertexAttribPointer( 4 + k, 4, GL_FLOAT, GL_FALSE, sizeof( RenderInstance ), (GLvoid *)( Offset + k * sizeof( vec4 ) ) );
+               glVertexAttribDivisor( 4 + k, 1 );
+               glEnableVertexAttribArray( 4 + k );
+            }
+            for( int k = 0; k < 3; ++k ){
+               glVertexAttribPointer( 8 + k, 3, GL_FLOAT, GL_FALSE, sizeof( RenderInstance ), (GLvoid *)( Offset + sizeof( mat4 ) + k * sizeof( vec3 ) ) );
+               glVertexAttribDivisor( 8 + k, 1 );
+               glEnableVertexAttribArray( 8 + k );
+            }
+            Instanced = true;
+         }
+         else{
+            state.UniformMatrix4( this->UniformModel, Item.ReturnModelMatrix() );
+            state.UniformMatrix4( this->UniformModelViewProjection, view_projection * Item.ReturnModelMatrix() );
+            state.UniformMatrix3( this->UniformNormal, Item.ReturnNormalMatrix() );
+            if( Instanced ){
+               this->DisableInstances();
+               Instanced = false;
+            }
+         }
+         state.Uniform3( this->UniformPositionScale, Item.ReturnQuantization().Scale );
+         state.Uniform3( this->UniformPositionOffset, Item.ReturnQuantization().Offset );
+      }
+      /*
+         Zapytanie wysłane w jednej z poprzednich klatek jest już zakończone na GPU, CPU nie czeka na wynik.
+      */
+      if( Batch.Query != 0 ){
+         glBeginConditionalRender( Batch.Query, GL_QUERY_WAIT );
+         Item.DrawPart( Command.Part, Instances );
+         glEndConditionalRender();
+         stats.Add( COUNTER_DRAWS, 1 );
+         stats.Add( COUNTER_TRIANGLES, Part.IndexCount / 3 );
+      }
+      else if( Ranges != NULL ){
+         ClusterCuller::Draw( Item, *Ranges );
+         stats.Add( COUNTER_DRAWS, 1 );
+         stats.Add( COUNTER_TRIANGLES, Ranges->Triangles );
+      }
+      else{
+         Item.DrawPart( Command.Part, Instances );
+         stats.Add( COUNTER_DRAWS, 1 );
+         stats.Add( COUNTER_TRIANGLES, Part.IndexCount / 3 * Instances );
+      }
+      /*
+         Czas GPU obiektu: znacznik na końcu każdego ciągu jego poleceń (kolejność kolejki się nie zmienia).
+      */
+      if( profiler.IsEnabled() and ( i + 1 == this->Commands.size() or this->Commands[ i + 1 ].Item != Command.Item ) ){
+         profiler.Mark( "Draw", Item.ReturnName() );
+      }
+   }
+   if( Instanced ){
+      this->DisableInstances();
+   }
+   glBindBuffer( GL_ARRAY_BUFFER, 0 );
+   /*
+      Instancje liczone raz na partię.
+   */
+   for( unsigned int i = 0; i < this->Batches.size(); ++i ){
+      stats.Add( COUNTER_INSTANCES, this->Batches[i].InstanceCount );
+   }
+}
+
+void RenderQueue::Destroy(){
+   glDeleteBuffers( 1, &this->InstanceBuffer );
+   this->InstanceBuffer = 0;
+}
+
+void RenderQueue::DisableInstances(){
+   for( int i = 4; i <= 10; ++i ){
+      glDisableVertexAttribArray( i );
+   }
+}
+
+void RenderQueue::Sort(){
+   PROFILE_SCOPE( "RenderQueue::Sort" );
+   unsigned int Size = this->Commands.size();
+   /*
+      Pusta kolejka (np. przed wczytaniem obiektów lub wszystko odrzucone) lub jedno polecenie: nic do sortowania.
+   */
+   if( Size < 2 ){
+      return;
+   }
+   this->Scratch.resize( Size );
+   vector <RenderCommand> *From = &this->Commands, *To = &this->Scratch;
+   for( int Shift = 0; Shift < 64; Shift += 8 ){
+      unsigned int Count[256] = { 0 };
+      for( unsigned int i = 0; i < Size; ++i ){
+         ++Count[ ( (*From)[i].Key >> Shift ) & 0xFF ];
+      }
+      /*
+         Wszystkie klucze mają ten sam bajt: przebieg niczego nie zmienia.
+      */
+      if( Count[ ( (*From)[0].Key >> Shift ) & 0xFF ] == Size ){
+         continue;
+      }
+      unsigned int Offset = 0;
+      for( int i = 0; i < 256; ++i ){
+         unsigned int Next = Offset + Count[i];
+         Count[i] = Offset;
+         Offset = Next;
+      }
+      for( unsigned int i = 0; i < Size; ++i ){
+         (*To)[ Count[ ( (*From)[i].Key >> Shift ) & 0xFF ]++ ] = (*From)[i];
+      }
+      swap( From, To );
+   }
+   if( From != &this->Commands ){
+      this->Commands.swap( this->Scratch );
+   }
+}
+
+#endif
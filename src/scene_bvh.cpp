@@ -0,0 +1,633 @@
+/*!
+   \file scene_bvh.cpp
+   \brief Plik odpowiedzialny za drzewo brył otaczających (BVH) wszystkich instancji obiektów sceny.
+*/
+#ifndef __scene_bvh_hpp__
+#define __scene_bvh_hpp__
+
+/*!
+   \brief Największa ilość instancji w liściu drzewa.
+*/
+#define SCENE_BVH_LEAF_SIZE 4
+
+/*!
+   \brief Węzeł drzewa: prostopadłościan otaczający oraz dzieci (węzeł wewnętrzny) lub instancje (liść).
+*/
+struct BVHNode{
+   /*!
+      \brief Najmniejsze współrzędne prostopadłościanu.
+   */
+   vec3 Min;
+   /*!
+      \brief Liść: pierwsza instancja w \link SceneBVH::Primitives \endlink, węzeł wewnętrzny: lewe dziecko (prawe to First + 1).
+   */
+   GLuint First;
+   /*!
+      \brief Największe współrzędne prostopadłościanu.
+   */
+   vec3 Max;
+   /*!
+      \brief Ilość instancji liścia, 0 = węzeł wewnętrzny.
+   */
+   GLuint Count;
+   /*!
+      \brief Rodzic węzła (dla korzenia -1).
+   */
+   GLuint Parent;
+};
+
+/*!
+   \brief Instancja obiektu w drzewie.
+*/
+struct BVHPrimitive{
+   /*!
+      \brief Najmniejsze współrzędne prostopadłościanu instancji w świecie.
+   */
+   vec3 Min;
+   /*!
+      \brief Największe współrzędne prostopadłościanu instancji w świecie.
+   */
+   vec3 Max;
+   /*!
+      \brief Numer obiektu.
+   */
+   GLuint Item;
+   /*!
+      \brief Numer instancji obiektu.
+   */
+   GLsizei Instance;
+};
+
+/*!
+   \brief Wynik zapytania: instancja obiektu.
+*/
+struct BVHHit{
+   /*!
+      \brief Numer obiektu.
+   */
+   GLuint Item;
+   /*!
+      \brief Numer instancji obiektu.
+   */
+   GLsizei Instance;
+};
+
+/*!
+   \brief Klasa odpowiedzialna za drzewo brył otaczających (prostopadłościany w świecie) wszystkich instancji wczytanych obiektów.
+
+   Drzewo budowane jest od nowa, gdy zmieni się zbiór instancji ( \link Mesh::ReturnLayoutVersion() \endlink ),
+   po zmianie macierzy modelu poprawiane są tylko liście zmienionych instancji ( \link Mesh::ReturnChanges() \endlink ) i węzły nad nimi.
+   Bez zmian w scenie ( \link Mesh::ReturnSceneVersion() \endlink ) aktualizacja niczego nie sprawdza.
+   Zapytania zwracają ilość odwiedzonych węzłów.
+*/
+class SceneBVH{
+   public:
+      /*!
+         \brief Konstruktor domyślny.
+      */
+      SceneBVH();
+      /*!
+         \brief Buduje drzewo od nowa lub poprawia prostopadłościany zmienionych obiektów.
+
+         \param items - obiekty
+      */
+      void Update( const vector <Mesh> &items );
+      /*!
+         \brief Instancje przecinające ostrosłup widzenia (lub w jego wnętrzu).
+
+         \param planes - \link FRUSTUM_PLANES \endlink płaszczyzn ( \link Camera::ReturnFrustumPlanes() \endlink )
+         \param hits - wynik (dopisywany)
+         \return - ilość odwiedzonych węzłów
+      */
+      unsigned int QueryFrustum( const vec4 *planes, vector <BVHHit> &hits ) const;
+      /*!
+         \brief Instancje, których prostopadłościan przecina sferę.
+
+         \param center - środek sfery
+         \param radius - promień sfery
+         \param hits - wynik (dopisywany)
+         \return - ilość odwiedzonych węzłów
+      */
+      unsigned int QuerySphere( vec3 center, GLfloat radius, vector <BVHHit> &hits ) const;
+      /*!
+         \brief Instancje, których prostopadłościan przecina prostopadłościan.
+
+         \param min - najmniejsze współrzędne
+         \param max - największe współrzędne
+         \param hits - wynik (dopisywany)
+         \return - ilość odwiedzonych węzłów
+      */
+      unsigned int QueryAABB( vec3 min, vec3 max, vector <BVHHit> &hits ) const;
+      /*!
+         \brief Najbliższa instancja, której prostopadłościan przecina promień (np. wybór obiektu myszką).
+
+         \param origin - początek promienia
+         \param direction - kierunek promienia
+         \param max_distance - największa odległość (w długościach direction)
+         \param hit - wynik
+         \param distance - odległość do prostopadłościanu instancji (w długościach direction)
+         \param visited - ilość odwiedzonych węzłów (gdy różne od NULL)
+         \return - TRUE = promień trafił instancję
+      */
+      bool QueryRay( vec3 origin, vec3 direction, GLfloat max_distance, BVHHit &hit, GLfloat &distance, unsigned int *visited = NULL ) const;
+      /*!
+         \brief Zwraca ilość instancji w drzewie.
+      */
+      GLuint ReturnPrimitiveCount() const;
+   private:
+      /*!
+         \brief Buduje drzewo od nowa (podział w połowie instancji wzdłuż najdłuższej osi środków).
+
+         \param items - obiekty
+      */
+      void Build( const vector <Mesh> &items );
+      /*!
+         \brief Przelicza prostopadłościan węzła z dzieci lub instancji liścia.
+
+         \param node - numer węzła
+      */
+      void UpdateNode( GLuint node );
+      /*!
+         \brief Przepisuje prostopadłościan instancji do jej liścia i oznacza liść oraz jego przodków do przeliczenia.
+
+         \param item - obiekt
+         \param index - numer obiektu
+         \param instance - numer instancji
+      */
+      void RefitPrimitive( const Mesh &item, GLuint index, GLsizei instance );
+      /*!
+         \brief Dopisuje wszystkie instancje poddrzewa.
+
+         \param node - korzeń poddrzewa
+         \param hits - wynik
+         \return - ilość odwiedzonych węzłów
+      */
+      unsigned int AddSubtree( GLuint node, vector <BVHHit> &hits ) const;
+      /*!
+         \brief Dopisuje instancje liścia.
+
+         \param node - liść
+         \param hits - wynik
+      */
+      void AddLeaf( const BVHNode &node, vector <BVHHit> &hits ) const;
+      /*!
+         \brief Węzły, korzeń to węzeł 0, dzieci zawsze za rodzicem.
+      */
+      vector <BVHNode> Nodes;
+      /*!
+         \brief Instancje w kolejności liści.
+      */
+      vector <BVHPrimitive> Primitives;
+      /*!
+         \brief Liść każdej instancji z \link Primitives \endlink.
+      */
+      vector <GLuint> PrimitiveLeaf;
+      /*!
+         \brief Położenie instancji w \link Primitives \endlink według kolejności obiektów ( \link ItemOffsets \endlink + numer instancji).
+      */
+      vector <GLuint> PrimitiveIndex;
+      /*!
+         \brief Pierwsza instancja każdego obiektu w \link PrimitiveIndex \endlink.
+      */
+      vector <GLuint> ItemOffsets;
+      /*!
+         \brief Ilość instancji każdego obiektu w drzewie (0 = obiekt niewczytany).
+      */
+      vector <GLsizei> ItemCounts;
+      /*!
+         \brief Wersja brył otaczających każdego obiektu w chwili ostatniej aktualizacji.
+      */
+      vector <unsigned long> ItemVersions;
+      /*!
+         \brief Węzły do przeliczenia w \link Update() \endlink.
+      */
+      vector <uint8_t> Dirty;
+      /*!
+         \brief Wersja zbioru instancji ( \link Mesh::ReturnLayoutVersion() \endlink ) w chwili budowy drzewa.
+      */
+      unsigned long LayoutVersion = 0;
+      /*!
+         \brief Wersja sceny ( \link Mesh::ReturnSceneVersion() \endlink ) w chwili ostatniej aktualizacji.
+      */
+      unsigned long SceneVersion = 0;
+      /*!
+         \brief Zmiany brył otaczających odebrane w \link Update() \endlink.
+      */
+      vector <MeshChange> Changes;
+};
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+SceneBVH::SceneBVH(){
+}
+
+void SceneBVH::Update( const vector <Mesh> &items ){
+   PROFILE_SCOPE( "SceneBVH::Update" );
+   /*
+      Inny zbiór instancji: budowa od nowa (zapamiętane zmiany są już w drzewie).
+   */
+   if( items.size() != this->ItemCounts.size() or Mesh::ReturnLayoutVersion() != this->LayoutVersion ){
+      this->Build( items );
+      Mesh::ReturnChanges( this->Changes );
+      return;
+   }
+   if( Mesh::ReturnSceneVersion() == this->SceneVersion ){
+      return;
+   }
+   this->SceneVersion = Mesh::ReturnSceneVersion();
+   /*
+      Poprawienie liści zmienionych instancji i oznaczenie ich przodków.
+      Zmiana spoza wektora obiektów (np. obiekt tymczasowy) jest pomijana, przepełniona lista: sprawdzenie wersji wszystkich obiektów.
+   */
+   bool Changed = false;
+   if( Mesh::ReturnChanges( this->Changes ) ){
+      std::less <const Mesh *> Less;
+      for( unsigned int i = 0; i < this->Changes.size(); ++i ){
+         const MeshChange &Change = this->Changes[i];
+         if( items.empty() or Less( Change.Item, &items[0] ) or ! Less( Change.Item, &items[0] + items.size() ) ){
+            continue;
+         }
+         GLuint Index = Change.Item - &items[0];
+         if( Change.Instance >= this->ItemCounts[ Index ] ){
+            continue;
+         }
+         this->ItemVersions[ Index ] = items[ Index ].ReturnBoundsVersion();
+         this->RefitPrimitive( items[ Index ], Index, Change.Instance );
+         Changed = true;
+      }
+   }
+   else{
+      for( unsigned int i = 0; i < items.size(); ++i ){
+         if( this->ItemCounts[i] == 0 or items[i].ReturnBoundsVersion() == this->ItemVersions[i] ){
+            continue;
+         }
+         this->ItemVersions[i] = items[i].ReturnBoundsVersion();
+         for( GLsizei k = 0; k < this->ItemCounts[i]; ++k ){
+            this->RefitPrimitive( items[i], i, k );
+         }
+         Changed = true;
+      }
+   }
+   if( ! Changed ){
+      return;
+   }
+   /*
+      Dzieci są zawsze za rodzicem: przeliczanie od końca poprawia najpierw dzieci.
+   */
+   for( GLuint i = this->Nodes.size(); i-- > 0; ){
+      if( this->Dirty[i] ){
+         this->UpdateNode( i );
+         this->Dirty[i] = 0;
+      }
+   }
+}
+
+void SceneBVH::RefitPrimitive( const Mesh &item, GLuint index, GLsizei instance ){
+   GLuint Primitive = this->PrimitiveIndex[ this->ItemOffsets[ index ] + instance ];
+   const MeshBounds &Bounds = item.ReturnWorldBounds( instance );
+   this->Primitives[ Primitive ].Min = Bounds.Min;
+   this->Primitives[ Primitive ].Max = Bounds.Max;
+   for( GLuint Node = this->PrimitiveLeaf[ Primitive ]; Node != (GLuint)-1 and ! this->Dirty[ Node ]; Node = this->Nodes[ Node ].Parent ){
+      this->Dirty[ Node ] = 1;
+   }
+}
+
+void SceneBVH::Build( const vector <Mesh> &items ){
+   PROFILE_SCOPE( "SceneBVH::Build" );
+   this->Primitives.clear();
+   this->Nodes.clear();
+   this->ItemOffsets.assign( items.size(), 0 );
+   this->ItemCounts.assign( items.size(), 0 );
+   this->ItemVersions.assign( items.size(), 0 );
+   this->LayoutVersion = Mesh::ReturnLayoutVersion();
+   this->SceneVersion = Mesh::ReturnSceneVersion();
+   for( unsigned int i = 0; i < items.size(); ++i ){
+      this->ItemOffsets[i] = this->Primitives.size();
+      if( ! items[i].IsLoaded() or items[i].ReturnGeometry() == 0 ){
+         continue;
+      }
+      this->ItemCounts[i] = items[i].ReturnInstanceCount();
+      this->ItemVersions[i] = items[i].ReturnBoundsVersion();
+      for( GLsizei k = 0; k < this->ItemCounts[i]; ++k ){
+         BVHPrimitive Primitive;
+         Primitive.Min = items[i].ReturnWorldBounds( k ).Min;
+         Primitive.Max = items[i].ReturnWorldBounds( k ).Max;
+         Primitive.Item = i;
+         Primitive.Instance = k;
+         this->Primitives.push_back( Primitive );
+      }
+   }
+   GLuint Count = this->Primitives.size();
+   this->PrimitiveLeaf.assign( Count, 0 );
+   this->PrimitiveIndex.assign( Count, 0 );
+   if( Count == 0 ){
+      this->Dirty.clear();
+      return;
+   }
+   /*
+      Podział od korzenia (stos zamiast rekurencji), węzły dzieci dopisywane są za rodzicem.
+   */
+   this->Nodes.reserve( 2 * ( Count / SCENE_BVH_LEAF_SIZE + 1 ) );
+   BVHNode Root;
+   Root.First = 0;
+   Root.Count = Count;
+   Root.Parent = (GLuint)-1;
+   this->Nodes.push_back( Root );
+   vector <GLuint> Stack( 1, 0 );
+   while( ! Stack.empty() ){
+      GLuint Node = Stack.back();
+      Stack.pop_back();
+      GLuint First = this->Nodes[ Node ].First, Size = this->Nodes[ Node ].Count;
+      if( Size <= SCENE_BVH_LEAF_SIZE ){
+         continue;
+      }
+      vec3 CenterMin = this->Primitives[ First ].Min + this->Primitives[ First ].Max, CenterMax = CenterMin;
+      for( GLuint i = First + 1; i < First + Size; ++i ){
+         vec3 Center = this->Primitives[i].Min + this->Primitives[i].Max;
+         CenterMin = glm::min( CenterMin, Center );
+         CenterMax = glm::max( CenterMax, Center );
+      }
+      vec3 Extent = CenterMax - CenterMin;
+      int Axis = ( Extent.x >= Extent.y and Extent.x >= Extent.z ) ? 0 : ( Extent.y >= Extent.z ? 1 : 2 );
+      GLuint Middle = First + Size / 2;
+      nth_element( this->Primitives.begin() + First, this->Primitives.begin() + Middle, this->Primitives.begin() + First + Size,
+                   [Axis]( const BVHPrimitive &a, const BVHPrimitive &b ){
+         return a.Min[ Axis ] + a.Max[ Axis ] < b.Min[ Axis ] + b.Max[ Axis ];
+      } );
+      BVHNode Child;
+      Child.Parent = Node;
+      Child.First = First;
+      Child.Count = Middle - First;
+      GLuint Left = this->Nodes.size();
+      this->Nodes.push_back( Child );
+      Child.First = Middle;
+      Child.Count = First + Size - Middle;
+      this->Nodes.push_back( Child );
+      this->Nodes[ Node ].First = Left;
+      this->Nodes[ Node ].Count = 0;
+      Stack.push_back( Left );
+      Stack.push_back( Left + 1 );
+   }
+   for( GLuint i = this->Nodes.size(); i-- > 0; ){
+      const BVHNode &Node = this->Nodes[i];
+      for( GLuint k = 0; k < Node.Count; ++k ){
+         const BVHPrimitive &Primitive = this->Primitives[ Node.First + k ];
+         this->PrimitiveLeaf[ Node.First + k ] = i;
+         this->PrimitiveIndex[ this->ItemOffsets[ Primitive.Item ] + Primitive.Instance ] = Node.First + k;
+      }
+      this->UpdateNode( i );
+   }
+   this->Dirty.assign( this->Nodes.size(), 0 );
+}
+
+void SceneBVH::UpdateNode( GLuint node ){
+   BVHNode &Node = this->Nodes[ node ];
+   if( Node.Count == 0 ){
+      Node.Min = glm::min( this->Nodes[ Node.First ].Min, this->Nodes[ Node.First + 1 ].Min );
+      Node.Max = glm::max( this->Nodes[ Node.First ].Max, this->Nodes[ Node.First + 1 ].Max );
+      return;
+   }
+   Node.Min = this->Primitives[ Node.First ].Min;
+   Node.Max = this->Primitives[ Node.First ].Max;
+   for( GLuint i = 1; i < Node.Count; ++i ){
+      Node.Min = glm::min( Node.Min, this->Primitives[ Node.First + i ].Min );
+      Node.Max = glm::max( Node.Max, this->Primitives[ Node.First + i ].Max );
+   }
+}
+
+/*!
+   \brief Zwraca TRUE, gdy prostopadłościan leży całkowicie po zewnętrznej stronie jednej z płaszczyzn maski.
+
+   Z maski usuwane są płaszczyzny, po których wewnętrznej stronie leży cały prostopadłościan.
+*/
+static bool BoxOutsideFrustum( vec3 min, vec3 max, const vec4 *planes, unsigned int &mask ){
+   for( int p = 0; p < FRUSTUM_PLANES; ++p ){
+      if( ! ( mask & ( 1u << p ) ) ){
+         continue;
+      }
+      vec3 Normal = vec3( planes[p] );
+      /*
+         Wierzchołek prostopadłościanu najdalej w kierunku normalnej i najdalej w przeciwnym.
+      */
+      vec3 Positive( Normal.x >= 0.0f ? max.x : min.x, Normal.y >= 0.0f ? max.y : min.y, Normal.z >= 0.0f ? max.z : min.z );
+      vec3 Negative( Normal.x >= 0.0f ? min.x : max.x, Normal.y >= 0.0f ? min.y : max.y, Normal.z >= 0.0f ? min.z : max.z );
+      if( dot( Normal, Positive ) + planes[p].w < 0.0f ){
+         return true;
+      }
+      if( dot( Normal, Negative ) + planes[p].w >= 0.0f ){
+         mask &= ~( 1u << p );
+      }
+   }
+   return false;
+}
+
+unsigned int SceneBVH::QueryFrustum( const vec4 *planes, vector <BVHHit> &hits ) const{
+   if( this->Nodes.empty() ){
+      return 0;
+   }
+   unsigned int Visited = 0;
+   /*
+      Na stosie węzeł i maska płaszczyzn, które jeszcze przecinają rodzica (węzeł w całości po wewnętrznej stronie płaszczyzny jej nie sprawdza).
+   */
+   vector < pair <GLuint, unsigned int> > Stack( 1, make_pair( 0u, ( 1u << FRUSTUM_PLANES ) - 1 ) );
+   while( ! Stack.empty() ){
+      GLuint Index = Stack.back().first;
+      unsigned int Mask = Stack.back().second;
+      Stack.pop_back();
+      const BVHNode &Node = this->Nodes[ Index ];
+      ++Visited;
+      if( BoxOutsideFrustum( Node.Min, Node.Max, planes, Mask ) ){
+         continue;
+      }
+      if( Mask == 0 ){
+         Visited += this->AddSubtree( Index, hits ) - 1;
+      }
+      else if( Node.Count > 0 ){
+         /*
+            Liść przecina płaszczyzny: każda instancja sprawdzana osobno (tylko z płaszczyznami z maski).
+         */
+         for( GLuint i = 0; i < Node.Count; ++i ){
+            const BVHPrimitive &Primitive = this->Primitives[ Node.First + i ];
+            unsigned int PrimitiveMask = Mask;
+            if( ! BoxOutsideFrustum( Primitive.Min, Primitive.Max, planes, PrimitiveMask ) ){
+               BVHHit Hit = { Primitive.Item, Primitive.Instance };
+               hits.push_back( Hit );
+            }
+         }
+      }
+      else{
+         Stack.push_back( make_pair( Node.First, Mask ) );
+         Stack.push_back( make_pair( Node.First + 1, Mask ) );
+      }
+   }
+   return Visited;
+}
+
+unsigned int SceneBVH::QuerySphere( vec3 center, GLfloat radius, vector <BVHHit> &hits ) const{
+   if( this->Nodes.empty() ){
+      return 0;
+   }
+   unsigned int Visited = 0;
+   vector <GLuint> Stack( 1, 0 );
+   while( ! Stack.empty() ){
+      const BVHNode &Node = this->Nodes[ Stack.back() ];
+      Stack.pop_back();
+      ++Visited;
+      /*
+         Odległość środka sfery od najbliższego punktu prostopadłościanu.
+      */
+      vec3 Delta = center - glm::clamp( center, Node.Min, Node.Max );
+      if( dot( Delta, Delta ) > radius * radius ){
+         continue;
+      }
+      if( Node.Count > 0 ){
+         for( GLuint i = 0; i < Node.Count; ++i ){
+            const BVHPrimitive &Primitive = this->Primitives[ Node.First + i ];
+            vec3 PrimitiveDelta = center - glm::clamp( center, Primitive.Min, Primitive.Max );
+            if( dot( PrimitiveDelta, PrimitiveDelta ) <= radius * radius ){
+               BVHHit Hit = { Primitive.Item, Primitive.Instance };
+               hits.push_back( Hit );
+            }
+         }
+      }
+      else{
+         Stack.push_back( Node.First );
+         Stack.push_back( Node.First + 1 );
+      }
+   }
+   return Visited;
+}
+
+/*!
+   \brief Zwraca TRUE, gdy prostopadłościany [ min_a, max_a ] i [ min_b, max_b ] mają część wspólną.
+*/
+static bool BoxOverlap( vec3 min_a, vec3 max_a, vec3 min_b, vec3 max_b ){
+   return min_a.x <= max_b.x and max_a.x >= min_b.x and min_a.y <= max_b.y and max_a.y >= min_b.y and min_a.z <= max_b.z and max_a.z >= min_b.z;
+}
+
+unsigned int SceneBVH::QueryAABB( vec3 min, vec3 max, vector <BVHHit> &hits ) const{
+   if( this->Nodes.empty() ){
+      return 0;
+   }
+   unsigned int Visited = 0;
+   vector <GLuint> Stack( 1, 0 );
+   while( ! Stack.empty() ){
+      const BVHNode &Node = this->Nodes[ Stack.back() ];
+      Stack.pop_back();
+      ++Visited;
+      if( ! BoxOverlap( Node.Min, Node.Max, min, max ) ){
+         continue;
+      }
+      if( Node.Count > 0 ){
+         for( GLuint i = 0; i < Node.Count; ++i ){
+            const BVHPrimitive &Primitive = this->Primitives[ Node.First + i ];
+            if( BoxOverlap( Primitive.Min, Primitive.Max, min, max ) ){
+               BVHHit Hit = { Primitive.Item, Primitive.Instance };
+               hits.push_back( Hit );
+            }
+         }
+      }
+      else{
+         Stack.push_back( Node.First );
+         Stack.push_back( Node.First + 1 );
+      }
+   }
+   return Visited;
+}
+
+/*!
+   \brief Odległość wejścia promienia do prostopadłościanu (metoda płyt).
+
+   \return - odległość (w długościach kierunku promienia), -1 = brak przecięcia przed max_distance
+*/
+static GLfloat RayBox( vec3 origin, vec3 inverse_direction, GLfloat max_distance, vec3 min, vec3 max ){
+   vec3 T1 = ( min - origin ) * inverse_direction;
+   vec3 T2 = ( max - origin ) * inverse_direction;
+   vec3 Near = glm::min( T1, T2 ), Far = glm::max( T1, T2 );
+   GLfloat Enter = std::max( std::max( Near.x, Near.y ), std::max( Near.z, 0.0f ) );
+   GLfloat Exit = std::min( std::min( Far.x, Far.y ), std::min( Far.z, max_distance ) );
+   return ( Enter <= Exit ) ? Enter : -1.0f;
+}
+
+bool SceneBVH::QueryRay( vec3 origin, vec3 direction, GLfloat max_distance, BVHHit &hit, GLfloat &distance, unsigned int *visited ) const{
+   unsigned int Visited = 0;
+   bool Found = false;
+   distance = max_distance;
+   vec3 Inverse = vec3( 1.0f ) / direction;
+   if( ! this->Nodes.empty() and RayBox( origin, Inverse, distance, this->Nodes[0].Min, this->Nodes[0].Max ) >= 0.0f ){
+      vector <GLuint> Stack( 1, 0 );
+      while( ! Stack.empty() ){
+         const BVHNode &Node = this->Nodes[ Stack.back() ];
+         Stack.pop_back();
+         ++Visited;
+         if( Node.Count > 0 ){
+            for( GLuint i = 0; i < Node.Count; ++i ){
+               const BVHPrimitive &Primitive = this->Primitives[ Node.First + i ];
+               GLfloat Enter = RayBox( origin, Inverse, distance, Primitive.Min, Primitive.Max );
+               if( Enter >= 0.0f ){
+                  hit.Item = Primitive.Item;
+                  hit.Instance = Primitive.Instance;
+                  distance = Enter;
+                  Found = true;
+               }
+            }
+            continue;
+         }
+         /*
+            Bliższe dziecko na szczycie stosu, dalsze odrzucane, gdy jest dalej niż najbliższe trafienie.
+         */
+         GLfloat Left = RayBox( origin, Inverse, distance, this->Nodes[ Node.First ].Min, this->Nodes[ Node.First ].Max );
+         GLfloat Right = RayBox( origin, Inverse, distance, this->Nodes[ Node.First + 1 ].Min, this->Nodes[ Node.First + 1 ].Max );
+         GLuint Near = Node.First, Far = Node.First + 1;
+         if( Right >= 0.0f and ( Left < 0.0f or Right < Left ) ){
+            swap( Near, Far );
+            swap( Left, Right );
+         }
+         if( Right >= 0.0f ){
+            Stack.push_back( Far );
+         }
+         if( Left >= 0.0f ){
+            Stack.push_back( Near );
+         }
+      }
+   }
+   if( visited != NULL ){
+      *visited = Visited;
+   }
+   return Found;
+}
+
+GLuint SceneBVH::ReturnPrimitiveCount() const{
+   return this->Primitives.size();
+}
+
+unsigned int SceneBVH::AddSubtree( GLuint node, vector <BVHHit> &hits ) const{
+   unsigned int Visited = 0;
+   vector <GLuint> Stack( 1, node );
+   while( ! Stack.empty() ){
+      const BVHNode &Node = this->Nodes[ Stack.back() ];
+      Stack.pop_back();
+      ++Visited;
+      if( Node.Count > 0 ){
+         this->AddLeaf( Node, hits );
+      }
+      else{
+         Stack.push_back( Node.First );
+         Stack.push_back( Node.First + 1 );
+      }
+   }
+   return Visited;
+}
+
+void SceneBVH::AddLeaf( const BVHNode &node, vector <BVHHit> &hits ) const{
+   for( GLuint i = 0; i < node.Count; ++i ){
+      BVHHit Hit = { this->Primitives[ node.First + i ].Item, this->Primitives[ node.First + i ].Instance };
+      hits.push_back( Hit );
+   }
+}
+
+#endif
@@ -0,0 +1,239 @@
+/*!
+   \file state_cache.cpp
+   \brief Plik odpowiedzialny za pomijanie powtórzonych zmian stanu OpenGL.
+*/
+#ifndef __state_cache_hpp__
+#define __state_cache_hpp__
+
+/*!
+   \brief Ilość jednostek tekstur zapamiętywanych przez \link StateCache \endlink.
+*/
+#define STATE_CACHE_TEXTURE_UNITS 4
+
+/*!
+   \brief Klasa odpowiedzialna za zapamiętanie ostatniego stanu OpenGL i pomijanie wywołań, które go nie zmieniają.
+
+   Zmiany stanu poza \link StateCache \endlink (np. przekazywanie tekstur) wymagają \link Reset() \endlink.
+   Wartości uniformów zapamiętywane są dla aktualnego programu, zmiana programu je zapomina.
+*/
+class StateCache{
+   public:
+      /*!
+         \brief Konstruktor domyślny.
+      */
+      StateCache();
+      /*!
+         \brief Zapomina zapamiętany stan i zeruje liczniki wywołań (na początku rysowania klatki).
+      */
+      void Reset();
+      /*!
+         \brief glUseProgram, gdy program jest inny niż aktualny.
+
+         \param program - identyfikator programu
+      */
+      void UseProgram( GLuint program );
+      /*!
+         \brief glBindVertexArray, gdy VAO jest inne niż aktualne.
+
+         \param vertex_array - identyfikator VAO
+      */
+      void BindVertexArray( GLuint vertex_array );
+      /*!
+         \brief glActiveTexture i glBindTexture (GL_TEXTURE_2D), gdy tekstura jednostki jest inna niż aktualna.
+
+         \param unit - numer jednostki tekstury (mniejszy niż \link STATE_CACHE_TEXTURE_UNITS \endlink )
+         \param texture - identyfikator tekstury
+      */
+      void BindTexture( GLuint unit, GLuint texture );
+      /*!
+         \brief glUniformMatrix4fv, gdy wartość jest inna niż ostatnio przekazana.
+
+         \param location - położenie uniformu w aktualnym programie
+         \param value - wartość
+      */
+      void UniformMatrix4( GLint location, const mat4 &value );
+      /*!
+         \brief glUniformMatrix3fv, gdy wartość jest inna niż ostatnio przekazana.
+
+         \param location - położenie uniformu w aktualnym programie
+         \param value - wartość
+      */
+      void UniformMatrix3( GLint location, const mat3 &value );
+      /*!
+         \brief glUniform3fv, gdy wartość jest inna niż ostatnio przekazana.
+
+         \param location - położenie uniformu w aktualnym programie
+         \param value - wartość
+      */
+      void Uniform3( GLint location, const vec3 &value );
+      /*!
+         \brief Zwraca ilość wykonanych wywołań OpenGL od \link Reset() \endlink.
+      */
+      unsigned long ReturnIssued() const;
+      /*!
+         \brief Zwraca ilość pominiętych wywołań OpenGL od \link Reset() \endlink.
+      */
+      unsigned long ReturnSkipped() const;
+   private:
+      /*!
+         \brief Sprawdza, czy wartość się zmieniła, zapamiętuje nową i liczy wywołanie.
+
+         \param cache - zapamiętana wartość
+         \param value - nowa wartość
+         \return - TRUE = wartość się zmieniła, trzeba wywołać OpenGL
+      */
+      template <typename T> bool Change( T &cache, const T &value );
+      /*!
+         \brief Aktualny program.
+      */
+      GLuint Program = 0;
+      /*!
+         \brief Aktualne VAO.
+      */
+      GLuint VertexArray = 0;
+      /*!
+         \brief Aktywna jednostka tekstury.
+      */
+      GLuint ActiveUnit = 0;
+      /*!
+         \brief Tekstury przypięte do jednostek.
+      */
+      GLuint Textures[ STATE_CACHE_TEXTURE_UNITS ];
+      /*!
+         \brief Ostatnie wartości uniformów mat4 aktualnego programu.
+      */
+      map <GLint, mat4> Matrices;
+      /*!
+         \brief Ostatnie wartości uniformów mat3 aktualnego programu.
+      */
+      map <GLint, mat3> Matrices3;
+      /*!
+         \brief Ostatnie wartości uniformów vec3 aktualnego programu.
+      */
+      map <GLint, vec3> Vectors;
+      /*!
+         \brief Ilość wykonanych wywołań.
+      */
+      unsigned long Issued = 0;
+      /*!
+         \brief Ilość pominiętych wywołań.
+      */
+      unsigned long Skipped = 0;
+};
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+StateCache::StateCache(){
+   this->Reset();
+}
+
+void StateCache::Reset(){
+   /*
+      Wartość -1 nie jest identyfikatorem żadnego obiektu OpenGL, pierwsze wywołanie zawsze zmienia stan.
+   */
+   this->Program = (GLuint)-1;
+   this->VertexArray = (GLuint)-1;
+   this->ActiveUnit = (GLuint)-1;
+   for( int i = 0; i < STATE_CACHE_TEXTURE_UNITS; ++i ){
+      this->Textures[i] = (GLuint)-1;
+   }
+   this->Matrices.clear();
+   this->Matrices3.clear();
+   this->Vectors.clear();
+   this->Issued = 0;
+   this->Skipped = 0;
+}
+
+void StateCache::UseProgram( GLuint program ){
+   if( this->Change( this->Program, program ) ){
+      this->Matrices.clear();
+      this->Matrices3.clear();
+      this->Vectors.clear();
+      glUseProgram( program );
+   }
+}
+
+void StateCache::BindVertexArray( GLuint vertex_array ){
+   if( this->Change( this->VertexArray, vertex_array ) ){
+      glBindVertexArray( vertex_array );
+   }
+}
+
+void StateCache::BindTexture( GLuint unit, GLuint texture ){
+   if( this->Textures[ unit ] == texture ){
+      ++this->Skipped;
+      return;
+   }
+   this->Textures[ unit ] = texture;
+   if( this->Change( this->ActiveUnit, unit ) ){
+      glActiveTexture( GL_TEXTURE0 + unit );
+   }
+   glBindTexture( GL_TEXTURE_2D, texture );
+   ++this->Issued;
+}
+
+void StateCache::UniformMatrix4( GLint location, const mat4 &value ){
+   if( location < 0 ){
+      return;
+   }
+   map <GLint, mat4>::iterator It = this->Matrices.find( location );
+   if( It != this->Matrices.end() and memcmp( value_ptr( It->second ), value_ptr( value ), sizeof( mat4 ) ) == 0 ){
+      ++this->Skipped;
+      return;
+   }
+   this->Matrices[ location ] = value;
+   glUniformMatrix4fv( location, 1, GL_FALSE, value_ptr( value ) );
+   ++this->Issued;
+}
+
+void StateCache::UniformMatrix3( GLint location, const mat3 &value ){
+   if( location < 0 ){
+      return;
+   }
+   map <GLint, mat3>::iterator It = this->Matrices3.find( location );
+   if( It != this->Matrices3.end() and memcmp( value_ptr( It->second ), value_ptr( value ), sizeof( mat3 ) ) == 0 ){
+      ++this->Skipped;
+      return;
+   }
+   this->Matrices3[ location ] = value;
+   glUniformMatrix3fv( location, 1, GL_FALSE, value_ptr( value ) );
+   ++this->Issued;
+}
+
+void StateCache::Uniform3( GLint location, const vec3 &value ){
+   if( location < 0 ){
+      return;
+   }
+   map <GLint, vec3>::iterator It = this->Vectors.find( location );
+   if( It != this->Vectors.end() and memcmp( value_ptr( It->second ), value_ptr( value ), sizeof( vec3 ) ) == 0 ){
+      ++this->Skipped;
+      return;
+   }
+   this->Vectors[ location ] = value;
+   glUniform3fv( location, 1, value_ptr( value ) );
+   ++this->Issued;
+}
+
+unsigned long StateCache::ReturnIssued() const{
+   return this->Issued;
+}
+
+unsigned long StateCache::ReturnSkipped() const{
+   return this->Skipped;
+}
+
+template <typename T> bool StateCache::Change( T &cache, const T &value ){
+   if( cache == value ){
+      ++this->Skipped;
+      return false;
+   }
+   cache = value;
+   ++this->Issued;
+   return true;
+}
+
+#endif
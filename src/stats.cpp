@@ -0,0 +1,178 @@
+/*!
+   \file stats.cpp
+   \brief Plik odpowiedzialny za liczniki statystyk jednej klatki.
+*/
+#ifndef __stats_hpp__
+#define __stats_hpp__
+
+/*!
+   \brief Liczniki zbierane podczas rysowania jednej klatki.
+*/
+enum Counter{
+   /*!
+      \brief Ilość wywołań rysowania (draw call).
+   */
+   COUNTER_DRAWS = 0,
+   /*!
+      \brief Ilość rysowanych trójkątów.
+   */
+   COUNTER_TRIANGLES,
+   /*!
+      \brief Ilość obiektów przekazanych do OpenGL w trakcie wczytywania.
+   */
+   COUNTER_UPLOADS,
+   /*!
+      \brief Ilość rysowanych instancji obiektów (obiekt bez instancji to jedna instancja).
+   */
+   COUNTER_INSTANCES,
+   /*!
+      \brief Ilość wykonanych zmian stanu OpenGL (program, VAO, tekstury, uniformy obiektów) w trakcie rysowania.
+   */
+   COUNTER_STATE_CALLS,
+   /*!
+      \brief Ilość pominiętych zmian stanu OpenGL (stan był już ustawiony).
+   */
+   COUNTER_STATE_SKIPPED,
+   /*!
+      \brief Ilość instancji obiektów w ostrosłupie widzenia kamery.
+   */
+   COUNTER_VISIBLE,
+   /*!
+      \brief Ilość instancji obiektów odrzuconych (poza ostrosłupem widzenia kamery).
+   */
+   COUNTER_CULLED,
+   /*!
+      \brief Ilość węzłów drzewa instancji odwiedzonych przy odrzucaniu.
+   */
+   COUNTER_BVH_NODES,
+   /*!
+      \brief Ilość instancji w ostrosłupie widzenia, ale zasłoniętych (nierysowanych).
+   */
+   COUNTER_OCCLUDED,
+   /*!
+      \brief Ilość wysłanych zapytań o zasłonięcie.
+   */
+   COUNTER_OCCLUSION_QUERIES,
+   /*!
+      \brief Czas CPU odrzucania (drzewo, ostrosłup widzenia, zasłonięcie), w mikrosekundach.
+   */
+   COUNTER_CULL_MICROSECONDS,
+   /*!
+      \brief Ilość zmian poziomu szczegółowości instancji.
+   */
+   COUNTER_LOD_SWITCHES,
+   /*!
+      \brief Ilość sprawdzonych grup trójkątów ( \link ClusterCuller \endlink ).
+   */
+   COUNTER_CLUSTERS,
+   /*!
+      \brief Ilość odrzuconych grup trójkątów.
+   */
+   COUNTER_CLUSTERS_CULLED,
+   /*!
+      \brief Ilość liczników, zawsze ostatnia.
+   */
+   COUNTER_COUNT
+};
+
+/*!
+   \brief Klasa odpowiedzialna za liczniki statystyk jednej klatki (ilość rysowań, trójkątów itd.).
+*/
+class FrameStats{
+   public:
+      /*!
+         \brief Konstruktor domyślny, zeruje wszystkie liczniki.
+      */
+      FrameStats();
+      /*!
+         \brief Zeruje wszystkie liczniki, wywoływane na początku każdej klatki.
+      */
+      void Reset();
+      /*!
+         \brief Zwiększa licznik.
+
+         \param counter - licznik
+         \param value - wartość o jaką zostanie zwiększony licznik
+      */
+      void Add( Counter counter, unsigned long value );
+      /*!
+         \brief Zwraca aktualną wartość licznika.
+
+         \param counter - licznik
+      */
+      unsigned long Return( Counter counter ) const;
+      /*!
+         \brief Zwraca nazwę licznika (używana w raportach).
+
+         \param counter - licznik
+      */
+      static const char * ReturnName( Counter counter );
+   private:
+      /*!
+         \brief Wartości wszystkich liczników.
+      */
+      unsigned long Values[ COUNTER_COUNT ];
+};
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+FrameStats::FrameStats(){
+   this->Reset();
+}
+
+void FrameStats::Reset(){
+   for( int i = 0; i < COUNTER_COUNT; ++i ){
+      this->Values[i] = 0;
+   }
+}
+
+void FrameStats::Add( Counter counter, unsigned long value ){
+   this->Values[ counter ] += value;
+}
+
+unsigned long FrameStats::Return( Counter counter ) const{
+   return this->Values[ counter ];
+}
+
+const char * FrameStats::ReturnName( Counter counter ){
+   switch( counter ){
+      case COUNTER_DRAWS:
+         return "draws";
+      case COUNTER_TRIANGLES:
+         return "triangles";
+      case COUNTER_UPLOADS:
+         return "uploads";
+      case COUNTER_INSTANCES:
+         return "instances";
+      case COUNTER_STATE_CALLS:
+         return "state_calls";
+      case COUNTER_STATE_SKIPPED:
+         return "state_skipped";
+      case COUNTER_VISIBLE:
+         return "visible";
+      case COUNTER_CULLED:
+         return "culled";
+      case COUNTER_BVH_NODES:
+         return "bvh_nodes";
+      case COUNTER_OCCLUDED:
+         return "occluded";
+      case COUNTER_OCCLUSION_QUERIES:
+         return "occlusion_queries";
+      case COUNTER_CULL_MICROSECONDS:
+         return "cull_us";
+      case COUNTER_LOD_SWITCHES:
+         return "lod_switches";
+      case COUNTER_CLUSTERS:
+         return "clusters";
+      case COUNTER_CLUSTERS_CULLED:
+         return "clusters_culled";
+      default:
+         return "unknown";
+   }
+}
+
+#endif
@@ -0,0 +1,308 @@
+/*!
+   \file texture_cache.cpp
+   \brief Plik odpowiedzialny za wspólne tekstury obiektów (bez powtórnego dekodowania i tworzenia tej samej tekstury).
+*/
+#ifndef __texture_cache_hpp__
+#define __texture_cache_hpp__
+
+/*!
+   \brief Tekstura wczytywana z jednego pliku.
+*/
+struct TextureCachePath{
+   /*!
+      \brief Identyfikator tekstury OpenGL. 0 = tekstura jeszcze nie utworzona.
+   */
+   GLuint Texture = 0;
+   /*!
+      \brief Zdekodowana tekstura (wspólna dla wszystkich wątków dekodujących ten plik), pusta po utworzeniu tekstury.
+   */
+   shared_future < shared_ptr <const ImageData> > Image;
+};
+
+/*!
+   \brief Jedna tekstura OpenGL.
+*/
+struct TextureCacheEntry{
+   /*!
+      \brief Ilość obiektów używających tekstury.
+   */
+   int References = 0;
+   /*!
+      \brief Suma kontrolna zawartości (gdy włączone \link TextureCache::EnableHash() \endlink ).
+   */
+   uint64_t Hash = 0;
+   /*!
+      \brief Pliki, z których wczytywana jest ta tekstura.
+   */
+   vector <string> Paths;
+};
+
+/*!
+   \brief Klasa odpowiedzialna za wspólne tekstury obiektów.
+
+   Każdy plik tekstury dekodowany jest tylko raz (także, gdy kilka wątków wczytuje go jednocześnie),
+   a tekstura OpenGL tworzona jest tylko raz i współdzielona przez licznik odwołań
+   ( \link Retain() \endlink / \link Release() \endlink ).\n
+   Opcjonalnie ( \link EnableHash() \endlink ) tekstury o tej samej zawartości z różnych plików także są współdzielone.
+*/
+class TextureCache{
+   public:
+      /*!
+         \brief Dekoduje plik tekstury (tylko za pierwszym razem), wywoływane w wątkach roboczych.
+
+         \param path - ścieżka do pliku z teksturą
+         \param image - zdekodowana tekstura, pusta gdy tekstura OpenGL już istnieje
+         \return - wartość logiczną dla dekodowania tekstury, FALSE = błąd
+      */
+      static bool Decode( const string &path, shared_ptr <const ImageData> &image );
+      /*!
+         \brief Szuka utworzonej tekstury OpenGL (po ścieżce, a gdy włączone, także po zawartości) i zwiększa licznik odwołań.
+
+         \param path - ścieżka do pliku z teksturą
+         \param image - zdekodowana tekstura (dla porównania zawartości), może być NULL
+         \param texture - identyfikator znalezionej tekstury
+         \return - TRUE = tekstura znaleziona
+      */
+      static bool Find( const string &path, const ImageData *image, GLuint &texture );
+      /*!
+         \brief Dodaje nowo utworzoną teksturę OpenGL z licznikiem odwołań 1.
+
+         \param path - ścieżka do pliku z teksturą
+         \param image - zdekodowana tekstura
+         \param texture - identyfikator tekstury
+
+         Zdekodowane piksele nie są już przechowywane.
+      */
+      static void Insert( const string &path, const ImageData &image, GLuint texture );
+      /*!
+         \brief Zwiększa licznik odwołań tekstury.
+
+         \param texture - identyfikator tekstury, 0 = brak
+      */
+      static void Retain( GLuint texture );
+      /*!
+         \brief Zmniejsza licznik odwołań tekstury, tekstura jest usuwana, gdy nikt jej nie używa.
+
+         \param texture - identyfikator tekstury, 0 = brak
+      */
+      static void Release( GLuint texture );
+      /*!
+         \brief Włącza porównywanie tekstur po zawartości (suma kontrolna pikseli).
+
+         \param enable - TRUE = tekstury o tej samej zawartości z różnych plików są współdzielone
+      */
+      static void EnableHash( bool enable );
+      /*!
+         \brief Zwraca ilość tekstur OpenGL.
+      */
+      static unsigned int ReturnTextures();
+      /*!
+         \brief Zwraca ilość odwołań do tekstur, które nie utworzyły nowej tekstury.
+      */
+      static unsigned int ReturnShared();
+   private:
+      /*!
+         \brief Liczy sumę kontrolną FNV-1a (64 bity) wielkości, formatu i pikseli tekstury.
+
+         \param image - zdekodowana tekstura
+      */
+      static uint64_t Checksum( const ImageData &image );
+      /*!
+         \brief Tekstury według ścieżki do pliku.
+      */
+      static map <string, TextureCachePath> Paths;
+      /*!
+         \brief Tekstury OpenGL według identyfikatora.
+      */
+      static map <GLuint, TextureCacheEntry> Textures;
+      /*!
+         \brief Tekstury OpenGL według sumy kontrolnej zawartości.
+      */
+      static map <uint64_t, GLuint> Hashes;
+      /*!
+         \brief TRUE = porównywanie tekstur po zawartości.
+      */
+      static bool HashEnabled;
+      /*!
+         \brief Ilość odwołań, które nie utworzyły nowej tekstury.
+      */
+      static unsigned int Shared;
+      /*!
+         \brief Blokada dla wszystkich danych (dekodowanie odbywa się w wątkach roboczych).
+      */
+      static mutex Lock;
+};
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+map <string, TextureCachePath> TextureCache::Paths;
+map <GLuint, TextureCacheEntry> TextureCache::Textures;
+map <uint64_t, GLuint> TextureCache::Hashes;
+bool TextureCache::HashEnabled = false;
+unsigned int TextureCache::Shared = 0;
+mutex TextureCache::Lock;
+
+bool TextureCache::Decode( const string &path, shared_ptr <const ImageData> &image ){
+   shared_future < shared_ptr <const ImageData> > Future;
+   promise < shared_ptr <const ImageData> > Promise;
+   bool Owner = false;
+   {
+      lock_guard <mutex> Guard( TextureCache::Lock );
+      TextureCachePath &Entry = TextureCache::Paths[ path ];
+      if( Entry.Texture != 0 ){
+         image.reset();
+         return true;
+      }
+      /*
+         Pierwszy wątek dekoduje, pozostałe czekają na jego wynik.
+      */
+      if( ! Entry.Image.valid() ){
+         Entry.Image = Promise.get_future().share();
+         Owner = true;
+      }
+      Future = Entry.Image;
+   }
+   if( Owner ){
+      /*
+         Najpierw przygotowana tekstura z pamięci podręcznej (bez DevIL), potem dekodowanie i przygotowanie.
+      */
+      shared_ptr <ImageData> Data = make_shared <ImageData>();
+      bool Result = TextureCook::Load( path, *Data );
+      if( ! Result ){
+         Result = DecodeImg( path.c_str(), *Data );
+         if( Result ){
+            TextureCook::Cook( path, *Data );
+         }
+      }
+      if( Result ){
+         if( TextureCache::HashEnabled ){
+            Data->Hash = TextureCache::Checksum( *Data );
+         }
+         Promise.set_value( Data );
+      }
+      else{
+         Promise.set_value( shared_ptr <const ImageData>() );
+      }
+   }
+   image = Future.get();
+   return image != NULL;
+}
+
+bool TextureCache::Find( const string &path, const ImageData *image, GLuint &texture ){
+   lock_guard <mutex> Guard( TextureCache::Lock );
+   TextureCachePath &Entry = TextureCache::Paths[ path ];
+   if( Entry.Texture == 0 and TextureCache::HashEnabled and image != NULL ){
+      map <uint64_t, GLuint>::iterator It = TextureCache::Hashes.find( image->Hash );
+      if( It != TextureCache::Hashes.end() ){
+         /*
+            Ta sama zawartość z innego pliku.
+         */
+         Entry.Texture = It->second;
+         Entry.Image = shared_future < shared_ptr <const ImageData> >();
+         TextureCache::Textures[ It->second ].Paths.push_back( path );
+      }
+   }
+   if( Entry.Texture == 0 ){
+      return false;
+   }
+   texture = Entry.Texture;
+   ++TextureCache::Textures[ texture ].References;
+   ++TextureCache::Shared;
+   return true;
+}
+
+void TextureCache::Insert( const string &path, const ImageData &image, GLuint texture ){
+   lock_guard <mutex> Guard( TextureCache::Lock );
+   TextureCachePath &Entry = TextureCache::Paths[ path ];
+   Entry.Texture = texture;
+   Entry.Image = shared_future < shared_ptr <const ImageData> >();
+   TextureCacheEntry &Texture = TextureCache::Textures[ texture ];
+   Texture.References = 1;
+   Texture.Hash = image.Hash;
+   Texture.Paths.push_back( path );
+   if( TextureCache::HashEnabled ){
+      TextureCache::Hashes[ image.Hash ] = texture;
+   }
+}
+
+void TextureCache::Retain( GLuint texture ){
+   if( texture == 0 ){
+      return;
+   }
+   lock_guard <mutex> Guard( TextureCache::Lock );
+   map <GLuint, TextureCacheEntry>::iterator It = TextureCache::Textures.find( texture );
+   if( It != TextureCache::Textures.end() ){
+      ++It->second.References;
+   }
+}
+
+void TextureCache::Release( GLuint texture ){
+   if( texture == 0 ){
+      return;
+   }
+   lock_guard <mutex> Guard( TextureCache::Lock );
+   map <GLuint, TextureCacheEntry>::iterator It = TextureCache::Textures.find( texture );
+   if( It == TextureCache::Textures.end() ){
+      /*
+         Tekstura spoza pamięci podręcznej.
+      */
+      glDeleteTextures( 1, &texture );
+      return;
+   }
+   if( --It->second.References > 0 ){
+      return;
+   }
+   for( unsigned int i = 0; i < It->second.Paths.size(); ++i ){
+      TextureCache::Paths.erase( It->second.Paths[i] );
+   }
+   map <uint64_t, GLuint>::iterator Hash = TextureCache::Hashes.find( It->second.Hash );
+   if( Hash != TextureCache::Hashes.end() and Hash->second == texture ){
+      TextureCache::Hashes.erase( Hash );
+   }
+   TextureCache::Textures.erase( It );
+   glDeleteTextures( 1, &texture );
+}
+
+void TextureCache::EnableHash( bool enable ){
+   TextureCache::HashEnabled = enable;
+}
+
+unsigned int TextureCache::ReturnTextures(){
+   lock_guard <mutex> Guard( TextureCache::Lock );
+   return TextureCache::Textures.size();
+}
+
+unsigned int TextureCache::ReturnShared(){
+   lock_guard <mutex> Guard( TextureCache::Lock );
+   return TextureCache::Shared;
+}
+
+uint64_t TextureCache::Checksum( const ImageData &image ){
+   PROFILE_SCOPE( "TextureCache::Checksum" );
+   uint64_t Hash = 14695981039346656037ull;
+   const GLint Header[5] = { image.Width, image.Height, image.Format, image.Type, (GLint)image.InternalFormat };
+   const unsigned char *Bytes = (const unsigned char *)Header;
+   for( unsigned int i = 0; i < sizeof( Header ); ++i ){
+      Hash = ( Hash ^ Bytes[i] ) * 1099511628211ull;
+   }
+   for( unsigned int i = 0; i < image.Pixels.size(); ++i ){
+      Hash = ( Hash ^ image.Pixels[i] ) * 1099511628211ull;
+   }
+   /*
+      Przygotowane poziomy z pamięci podręcznej (wtedy Pixels jest pusty).
+   */
+   if( image.Pixels.empty() ){
+      for( unsigned int i = 0; i < image.Levels.size(); ++i ){
+         for( GLsizei j = 0; j < image.Levels[i].Size; ++j ){
+            Hash = ( Hash ^ image.Levels[i].Data[j] ) * 1099511628211ull;
+         }
+      }
+   }
+   return Hash;
+}
+
+#endif
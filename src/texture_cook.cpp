@@ -0,0 +1,503 @@
+/*!
+   \file texture_cook.cpp
+   \brief Plik odpowiedzialny za przygotowane tekstury (wszystkie poziomy mipmapy, kompresja BC1/BC3) w pamięci podręcznej.
+
+   Po pierwszym zdekodowaniu tekstury przez DevIL, na CPU liczone są wszystkie poziomy mipmapy i (gdy włączone) kompresja blokowa,
+   wynik zapisywany jest (gdy pamięć podręczna jest włączona) w katalogu \link MeshCache::Directory \endlink (plik .tex w formacie pamięci podręcznej \link MeshCache \endlink ).\n
+   Przy kolejnych uruchomieniach plik jest mapowany do pamięci i poziomy przekazywane są bezpośrednio do OpenGL,
+   bez DevIL (więc bez blokady \link DevILLock \endlink ) i bez glGenerateMipmap.
+*/
+#ifndef __texture_cook_hpp__
+#define __texture_cook_hpp__
+
+/*!
+   \brief Opis przygotowanej tekstury (sekcja \link MESH_CACHE_TEXTURE_INFO \endlink ).
+*/
+struct TextureCookInfo{
+   /*!
+      \brief Szerokość poziomu 0.
+   */
+   uint32_t Width;
+   /*!
+      \brief Wysokość poziomu 0.
+   */
+   uint32_t Height;
+   /*!
+      \brief Format tekstury w OpenGL (GL_RGBA8 lub format skompresowany).
+   */
+   uint32_t InternalFormat;
+   /*!
+      \brief Ilość poziomów mipmapy (sekcje \link MESH_CACHE_TEXTURE_LEVEL \endlink + numer poziomu).
+   */
+   uint32_t Levels;
+   /*!
+      \brief 1 = poziomy skompresowane (BC1/BC3).
+   */
+   uint32_t Compressed;
+};
+
+/*!
+   \brief Klasa odpowiedzialna za przygotowanie tekstur (mipmapy i kompresja) oraz ich odczyt z pamięci podręcznej.
+*/
+class TextureCook{
+   public:
+      /*!
+         \brief Wczytuje przygotowaną teksturę z pamięci podręcznej.
+
+         \param path - ścieżka do pliku z teksturą
+         \param data - tekstura (poziomy wskazują na zmapowany plik)
+         \return - wartość logiczną, FALSE = brak pliku, plik nieaktualny lub przygotowany z inną kompresją
+      */
+      static bool Load( const string &path, ImageData &data );
+      /*!
+         \brief Przygotowuje zdekodowaną teksturę (wszystkie poziomy mipmapy, kompresja) i zapisuje ją w pamięci podręcznej (gdy włączona).
+
+         \param path - ścieżka do pliku z teksturą
+         \param data - tekstura zdekodowana przez \link DecodeImg() \endlink, zamieniana na przygotowaną
+         \return - wartość logiczną, FALSE = nieobsługiwany format (tekstura bez zmian)
+      */
+      static bool Cook( const string &path, ImageData &data );
+      /*!
+         \brief Włącza kompresję blokową przygotowanych tekstur.
+
+         \param enable - TRUE = BC1 (bez przezroczystości) lub BC3 (z przezroczystością), FALSE = GL_RGBA8
+      */
+      static void SetCompression( bool enable );
+      /*!
+         \brief Zwraca TRUE, gdy kompresja blokowa jest włączona.
+      */
+      static bool IsCompressionEnabled();
+   private:
+      /*!
+         \brief Zamienia zdekodowane piksele na RGBA (8 bitów na kanał).
+
+         \param data - zdekodowana tekstura
+         \param rgba - piksele RGBA
+         \param alpha - TRUE = tekstura ma przezroczyste piksele
+         \return - wartość logiczną, FALSE = nieobsługiwany format
+      */
+      static bool ConvertRGBA( const ImageData &data, vector <unsigned char> &rgba, bool &alpha );
+      /*!
+         \brief Liczy kolejny poziom mipmapy (średnia z 2x2 pikseli).
+
+         \param source - piksele RGBA poziomu
+         \param width - szerokość poziomu
+         \param height - wysokość poziomu
+         \param target - piksele RGBA kolejnego poziomu
+      */
+      static void Downsample( const vector <unsigned char> &source, int width, int height, vector <unsigned char> &target );
+      /*!
+         \brief Kompresuje poziom blokami 4x4 i dopisuje wynik do wektora.
+
+         \param rgba - piksele RGBA poziomu
+         \param width - szerokość poziomu
+         \param height - wysokość poziomu
+         \param alpha - TRUE = BC3, FALSE = BC1
+         \param output - dane wyjściowe
+      */
+      static void Compress( const unsigned char *rgba, int width, int height, bool alpha, vector <unsigned char> &output );
+      /*!
+         \brief Kompresuje kolory bloku 4x4 (8 bajtów, BC1 w trybie 4 kolorów).
+
+         \param block - 16 pikseli RGBA
+         \param output - 8 bajtów wyjściowych
+      */
+      static void CompressColorBlock( const unsigned char *block, unsigned char *output );
+      /*!
+         \brief Kompresuje przezroczystość bloku 4x4 (8 bajtów, blok alfa BC3 w trybie 8 wartości).
+
+         \param block - 16 pikseli RGBA
+         \param output - 8 bajtów wyjściowych
+      */
+      static void CompressAlphaBlock( const unsigned char *block, unsigned char *output );
+      /*!
+         \brief Zamienia kolor (0 - 255) na format 5:6:5.
+
+         \param color - kolor RGB
+      */
+      static uint16_t PackColor( const vec3 &color );
+      /*!
+         \brief Zamienia kolor z formatu 5:6:5 na RGB (0 - 255).
+
+         \param color - kolor 5:6:5
+      */
+      static vec3 UnpackColor( uint16_t color );
+      /*!
+         \brief Zwraca wielkość poziomu w bajtach.
+
+         \param width - szerokość poziomu
+         \param height - wysokość poziomu
+         \param internal_format - format tekstury w OpenGL
+      */
+      static uint64_t ReturnLevelSize( int width, int height, GLenum internal_format );
+      /*!
+         \brief TRUE = kompresja blokowa włączona.
+      */
+      static bool Compression;
+};
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+bool TextureCook::Compression = false;
+
+bool TextureCook::Load( const string &path, ImageData &data ){
+   PROFILE_SCOPE_DETAIL( "TextureCook::Load", path );
+   shared_ptr <MeshCacheFile> File = make_shared <MeshCacheFile>();
+   if( ! File->Open( path, ".tex" ) ){
+      return false;
+   }
+   uint64_t Count;
+   const TextureCookInfo *Info = (const TextureCookInfo *)File->ReturnSection( MESH_CACHE_TEXTURE_INFO, sizeof( TextureCookInfo ), Count );
+   if( Info == NULL or Count != 1 or Info->Levels == 0 or Info->Levels > 32
+       or ( Info->Compressed != 0 ) != TextureCook::Compression ){
+      return false;
+   }
+   vector <ImageLevel> Levels( Info->Levels );
+   for( uint32_t i = 0; i < Info->Levels; ++i ){
+      Levels[i].Width = std::max( 1u, Info->Width >> i );
+      Levels[i].Height = std::max( 1u, Info->Height >> i );
+      Levels[i].Data = (const unsigned char *)File->ReturnSection( (MeshCacheSectionType)( MESH_CACHE_TEXTURE_LEVEL + i ), 1, Count );
+      Levels[i].Size = Count;
+      if( Levels[i].Data == NULL or Count != TextureCook::ReturnLevelSize( Levels[i].Width, Levels[i].Height, Info->InternalFormat ) ){
+         return false;
+      }
+   }
+   data.Width = Info->Width;
+   data.Height = Info->Height;
+   data.Format = GL_RGBA;
+   data.Type = GL_UNSIGNED_BYTE;
+   data.InternalFormat = Info->InternalFormat;
+   data.Compressed = Info->Compressed != 0;
+   data.Pixels.clear();
+   data.Levels.swap( Levels );
+   data.Cache = File;
+   return true;
+}
+
+bool TextureCook::Cook( const string &path, ImageData &data ){
+   PROFILE_SCOPE_DETAIL( "TextureCook::Cook", path );
+   vector <unsigned char> Level;
+   bool Alpha;
+   if( ! TextureCook::ConvertRGBA( data, Level, Alpha ) ){
+      return false;
+   }
+   GLenum InternalFormat = GL_RGBA8;
+   if( TextureCook::Compression ){
+      InternalFormat = Alpha ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+   }
+   /*
+      Wszystkie poziomy po kolei w jednym wektorze, aż do 1x1.
+   */
+   vector <unsigned char> Storage;
+   vector <ImageLevel> Levels;
+   vector <uint64_t> Offsets;
+   vector <unsigned char> Next;
+   int Width = data.Width;
+   int Height = data.Height;
+   while( true ){
+      ImageLevel Info;
+      Info.Width = Width;
+      Info.Height = Height;
+      Info.Data = NULL;
+      Offsets.push_back( Storage.size() );
+      if( TextureCook::Compression ){
+         TextureCook::Compress( &Level[0], Width, Height, Alpha, Storage );
+      }
+      else{
+         Storage.insert( Storage.end(), Level.begin(), Level.end() );
+      }
+      Info.Size = Storage.size() - Offsets.back();
+      Levels.push_back( Info );
+      if( Width == 1 and Height == 1 ){
+         break;
+      }
+      TextureCook::Downsample( Level, Width, Height, Next );
+      Level.swap( Next );
+      Width = std::max( 1, Width / 2 );
+      Height = std::max( 1, Height / 2 );
+   }
+   data.Pixels.swap( Storage );
+   for( unsigned int i = 0; i < Levels.size(); ++i ){
+      Levels[i].Data = &data.Pixels[ Offsets[i] ];
+   }
+   data.Levels.swap( Levels );
+   data.Format = GL_RGBA;
+   data.Type = GL_UNSIGNED_BYTE;
+   data.InternalFormat = InternalFormat;
+   data.Compressed = TextureCook::Compression;
+   /*
+      Zapis w pamięci podręcznej (przy wyłączonej pamięci podręcznej tekstura jest przygotowana tylko w pamięci).
+   */
+   if( ! MeshCache::IsEnabled() ){
+      return true;
+   }
+   TextureCookInfo Info;
+   Info.Width = data.Width;
+   Info.Height = data.Height;
+   Info.InternalFormat = InternalFormat;
+   Info.Levels = data.Levels.size();
+   Info.Compressed = data.Compressed ? 1 : 0;
+   MeshCache Writer;
+   Writer.Add( MESH_CACHE_TEXTURE_INFO, &Info, 1, sizeof( TextureCookInfo ) );
+   for( unsigned int i = 0; i < data.Levels.size(); ++i ){
+      Writer.Add( (MeshCacheSectionType)( MESH_CACHE_TEXTURE_LEVEL + i ), data.Levels[i].Data, data.Levels[i].Size, 1 );
+   }
+   Writer.Save( path, ".tex" );
+   return true;
+}
+
+void TextureCook::SetCompression( bool enable ){
+   TextureCook::Compression = enable;
+}
+
+bool TextureCook::IsCompressionEnabled(){
+   return TextureCook::Compression;
+}
+
+bool TextureCook::ConvertRGBA( const ImageData &data, vector <unsigned char> &rgba, bool &alpha ){
+   /*
+      Kolejność kanałów (R, G, B, A) w pikselu źródłowym, -1 = brak kanału.
+   */
+   int Channels;
+   int Order[4];
+   switch( data.Format ){
+      case IL_RGB:
+         Channels = 3; Order[0] = 0; Order[1] = 1; Order[2] = 2; Order[3] = -1;
+         break;
+      case IL_RGBA:
+         Channels = 4; Order[0] = 0; Order[1] = 1; Order[2] = 2; Order[3] = 3;
+         break;
+      case IL_BGR:
+         Channels = 3; Order[0] = 2; Order[1] = 1; Order[2] = 0; Order[3] = -1;
+         break;
+      case IL_BGRA:
+         Channels = 4; Order[0] = 2; Order[1] = 1; Order[2] = 0; Order[3] = 3;
+         break;
+      case IL_LUMINANCE:
+         Channels = 1; Order[0] = 0; Order[1] = 0; Order[2] = 0; Order[3] = -1;
+         break;
+      case IL_LUMINANCE_ALPHA:
+         Channels = 2; Order[0] = 0; Order[1] = 0; Order[2] = 0; Order[3] = 1;
+         break;
+      default:
+         return false;
+   }
+   uint64_t Count = (uint64_t)data.Width * data.Height;
+   if( data.Type != IL_UNSIGNED_BYTE or Count == 0 or data.Pixels.size() < Count * Channels ){
+      return false;
+   }
+   rgba.resize( Count * 4 );
+   alpha = false;
+   for( uint64_t i = 0; i < Count; ++i ){
+      const unsigned char *Source = &data.Pixels[ i * Channels ];
+      for( int j = 0; j < 4; ++j ){
+         rgba[ i * 4 + j ] = ( Order[j] >= 0 ) ? Source[ Order[j] ] : 255;
+      }
+      if( rgba[ i * 4 + 3 ] != 255 ){
+         alpha = true;
+      }
+   }
+   return true;
+}
+
+void TextureCook::Downsample( const vector <unsigned char> &source, int width, int height, vector <unsigned char> &target ){
+   int Width = std::max( 1, width / 2 );
+   int Height = std::max( 1, height / 2 );
+   target.resize( Width * Height * 4 );
+   for( int y = 0; y < Height; ++y ){
+      /*
+         Przy nieparzystej wielkości ostatni wiersz/kolumna są pomijane, przy wielkości 1 brany jest ten sam piksel.
+      */
+      int Y0 = std::min( y * 2, height - 1 );
+      int Y1 = std::min( y * 2 + 1, height - 1 );
+      for( int x = 0; x < Width; ++x ){
+         int X0 = std::min( x * 2, width - 1 );
+         int X1 = std::min( x * 2 + 1, width - 1 );
+         for( int c = 0; c < 4; ++c ){
+            int Sum = source[ ( Y0 * width + X0 ) * 4 + c ] + source[ ( Y0 * width + X1 ) * 4 + c ]
+                    + source[ ( Y1 * width + X0 ) * 4 + c ] + source[ ( Y1 * width + X1 ) * 4 + c ];
+            target[ ( y * Width + x ) * 4 + c ] = ( Sum + 2 ) / 4;
+         }
+      }
+   }
+}
+
+void TextureCook::Compress( const unsigned char *rgba, int width, int height, bool alpha, vector <unsigned char> &output ){
+   unsigned char Block[64];
+   for( int by = 0; by < height; by += 4 ){
+      for( int bx = 0; bx < width; bx += 4 ){
+         /*
+            Blok 4x4, piksele poza obrazkiem powtarzają ostatni wiersz/kolumnę.
+         */
+         for( int y = 0; y < 4; ++y ){
+            for( int x = 0; x < 4; ++x ){
+               int X = std::min( bx + x, width - 1 );
+               int Y = std::min( by + y, height - 1 );
+               memcpy( &Block[ ( y * 4 + x ) * 4 ], &rgba[ ( Y * width + X ) * 4 ], 4 );
+            }
+         }
+         size_t Offset = output.size();
+         output.resize( Offset + ( alpha ? 16 : 8 ) );
+         if( alpha ){
+            TextureCook::CompressAlphaBlock( Block, &output[ Offset ] );
+            Offset += 8;
+         }
+         TextureCook::CompressColorBlock( Block, &output[ Offset ] );
+      }
+   }
+}
+
+void TextureCook::CompressColorBlock( const unsigned char *block, unsigned char *output ){
+   /*
+      Kolory końcowe wzdłuż głównej osi kolorów bloku (średnia i kowariancja, kilka iteracji metody potęgowej).
+   */
+   vec3 Colors[16];
+   vec3 Mean = vec3( 0.0f );
+   for( int i = 0; i < 16; ++i ){
+      Colors[i] = vec3( block[ i * 4 ], block[ i * 4 + 1 ], block[ i * 4 + 2 ] );
+      Mean += Colors[i];
+   }
+   Mean /= 16.0f;
+   GLfloat Covariance[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+   for( int i = 0; i < 16; ++i ){
+      vec3 D = Colors[i] - Mean;
+      Covariance[0] += D.x * D.x;
+      Covariance[1] += D.x * D.y;
+      Covariance[2] += D.x * D.z;
+      Covariance[3] += D.y * D.y;
+      Covariance[4] += D.y * D.z;
+      Covariance[5] += D.z * D.z;
+   }
+   vec3 Axis = vec3( 1.0f, 1.0f, 1.0f );
+   for( int i = 0; i < 4; ++i ){
+      vec3 Next = vec3( Covariance[0] * Axis.x + Covariance[1] * Axis.y + Covariance[2] * Axis.z,
+                        Covariance[1] * Axis.x + Covariance[3] * Axis.y + Covariance[4] * Axis.z,
+                        Covariance[2] * Axis.x + Covariance[4] * Axis.y + Covariance[5] * Axis.z );
+      GLfloat Length = std::max( std::max( fabs( Next.x ), fabs( Next.y ) ), fabs( Next.z ) );
+      if( Length < 1e-6f ){
+         break;
+      }
+      Axis = Next / Length;
+   }
+   GLfloat MinProjection = 1e30f, MaxProjection = -1e30f;
+   vec3 MinColor = Mean, MaxColor = Mean;
+   for( int i = 0; i < 16; ++i ){
+      GLfloat Projection = dot( Colors[i] - Mean, Axis );
+      if( Projection < MinProjection ){
+         MinProjection = Projection;
+         MinColor = Colors[i];
+      }
+      if( Projection > MaxProjection ){
+         MaxProjection = Projection;
+         MaxColor = Colors[i];
+      }
+   }
+   /*
+      Przesunięcie kolorów końcowych do środka o 1/16 zakresu (mniejszy błąd dla kolorów pośrednich).
+   */
+   vec3 Inset = ( MaxColor - MinColor ) / 16.0f;
+   uint16_t Color0 = TextureCook::PackColor( MaxColor - Inset );
+   uint16_t Color1 = TextureCook::PackColor( MinColor + Inset );
+   /*
+      Tryb 4 kolorów wymaga Color0 > Color1.
+   */
+   if( Color0 < Color1 ){
+      swap( Color0, Color1 );
+   }
+   uint32_t Indices = 0;
+   if( Color0 != Color1 ){
+      vec3 Palette[4];
+      Palette[0] = TextureCook::UnpackColor( Color0 );
+      Palette[1] = TextureCook::UnpackColor( Color1 );
+      Palette[2] = ( 2.0f * Palette[0] + Palette[1] ) / 3.0f;
+      Palette[3] = ( Palette[0] + 2.0f * Palette[1] ) / 3.0f;
+      for( int i = 0; i < 16; ++i ){
+         int Best = 0;
+         GLfloat BestDistance = 1e30f;
+         for( int j = 0; j < 4; ++j ){
+            vec3 D = Colors[i] - Palette[j];
+            GLfloat Distance = dot( D, D );
+            if( Distance < BestDistance ){
+               BestDistance = Distance;
+               Best = j;
+            }
+         }
+         Indices |= (uint32_t)Best << ( i * 2 );
+      }
+   }
+   output[0] = Color0 & 0xFF;
+   output[1] = Color0 >> 8;
+   output[2] = Color1 & 0xFF;
+   output[3] = Color1 >> 8;
+   for( int i = 0; i < 4; ++i ){
+      output[ 4 + i ] = ( Indices >> ( i * 8 ) ) & 0xFF;
+   }
+}
+
+void TextureCook::CompressAlphaBlock( const unsigned char *block, unsigned char *output ){
+   int Alpha0 = 0, Alpha1 = 255;
+   for( int i = 0; i < 16; ++i ){
+      Alpha0 = std::max( Alpha0, (int)block[ i * 4 + 3 ] );
+      Alpha1 = std::min( Alpha1, (int)block[ i * 4 + 3 ] );
+   }
+   /*
+      Tryb 8 wartości (Alpha0 > Alpha1): wartości pośrednie to (( 7 - j ) * Alpha0 + j * Alpha1 ) / 7.
+   */
+   uint64_t Indices = 0;
+   if( Alpha0 != Alpha1 ){
+      int Palette[8];
+      Palette[0] = Alpha0;
+      Palette[1] = Alpha1;
+      for( int j = 1; j < 7; ++j ){
+         Palette[ j + 1 ] = ( ( 7 - j ) * Alpha0 + j * Alpha1 ) / 7;
+      }
+      for( int i = 0; i < 16; ++i ){
+         int Best = 0;
+         int BestDistance = 256;
+         for( int j = 0; j < 8; ++j ){
+            int Distance = abs( block[ i * 4 + 3 ] - Palette[j] );
+            if( Distance < BestDistance ){
+               BestDistance = Distance;
+               Best = j;
+            }
+         }
+         Indices |= (uint64_t)Best << ( i * 3 );
+      }
+   }
+   output[0] = Alpha0;
+   output[1] = Alpha1;
+   for( int i = 0; i < 6; ++i ){
+      output[ 2 + i ] = ( Indices >> ( i * 8 ) ) & 0xFF;
+   }
+}
+
+uint16_t TextureCook::PackColor( const vec3 &color ){
+   int R = (int)( clamp( color.x, 0.0f, 255.0f ) * 31.0f / 255.0f + 0.5f );
+   int G = (int)( clamp( color.y, 0.0f, 255.0f ) * 63.0f / 255.0f + 0.5f );
+   int B = (int)( clamp( color.z, 0.0f, 255.0f ) * 31.0f / 255.0f + 0.5f );
+   return ( R << 11 ) | ( G << 5 ) | B;
+}
+
+vec3 TextureCook::UnpackColor( uint16_t color ){
+   int R = ( color >> 11 ) & 31;
+   int G = ( color >> 5 ) & 63;
+   int B = color & 31;
+   return vec3( ( R << 3 ) | ( R >> 2 ), ( G << 2 ) | ( G >> 4 ), ( B << 3 ) | ( B >> 2 ) );
+}
+
+uint64_t TextureCook::ReturnLevelSize( int width, int height, GLenum internal_format ){
+   switch( internal_format ){
+      case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+         return (uint64_t)( ( width + 3 ) / 4 ) * ( ( height + 3 ) / 4 ) * 8;
+      case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+         return (uint64_t)( ( width + 3 ) / 4 ) * ( ( height + 3 ) / 4 ) * 16;
+      default:
+         return (uint64_t)width * height * 4;
+   }
+}
+
+#endif
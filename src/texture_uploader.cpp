@@ -0,0 +1,157 @@
+/*!
+   \file texture_uploader.cpp
+   \brief Plik odpowiedzialny za przekazywanie tekstur do OpenGL przez bufory pikseli (PBO).
+*/
+#ifndef __texture_uploader_hpp__
+#define __texture_uploader_hpp__
+
+/*!
+   \brief Klasa odpowiedzialna za przekazywanie tekstur przez pierścień buforów pikseli (GL_PIXEL_UNPACK_BUFFER).
+
+   Piksele kopiowane są do zmapowanego bufora, a glTexImage2D czyta je z bufora, więc kopiowanie do pamięci GPU
+   odbywa się asynchronicznie i nie zatrzymuje klatki.\n
+   Każdy bufor po użyciu dostaje synchronizację (glFenceSync). Bufor jest użyty ponownie dopiero, gdy GPU skończy
+   z niego czytać, gdy żaden bufor nie jest wolny, tekstura czeka na kolejną klatkę ( \link IsReady() \endlink ).
+*/
+class TextureUploader{
+   public:
+      /*!
+         \brief Konstruktor domyślny.
+      */
+      TextureUploader();
+      /*!
+         \brief Tworzy pierścień buforów.
+
+         \param buffers - ilość buforów
+      */
+      void Init( int buffers );
+      /*!
+         \brief Zwraca TRUE, gdy bufory zostały utworzone ( \link Init() \endlink ).
+      */
+      bool IsEnabled() const;
+      /*!
+         \brief Zwraca TRUE, gdy kolejny bufor jest wolny (GPU skończyło z niego czytać).
+      */
+      bool IsReady();
+      /*!
+         \brief Tworzy teksturę OpenGL przez kolejny bufor.
+
+         \param img_path_file - ścieżka do pliku z teksturą obiektu (dla komunikatów błędów)
+         \param data - zdekodowana tekstura
+         \param image - identyfikator tekstury obiektu
+         \return - wartość logiczną dla tworzenia tekstury, FALSE = błąd
+
+         Wywoływać tylko, gdy \link IsReady() \endlink zwraca TRUE.
+      */
+      bool Upload( const char *img_path_file, const ImageData &data, GLuint &image );
+      /*!
+         \brief Usuwa bufory i synchronizacje (przed usunięciem kontekstu OpenGL).
+      */
+      void Destroy();
+   private:
+      /*!
+         \brief Bufory pikseli.
+      */
+      vector <GLuint> Buffers;
+      /*!
+         \brief Synchronizacja ostatniego użycia każdego bufora. 0 = bufor wolny.
+      */
+      vector <GLsync> Fences;
+      /*!
+         \brief Numer kolejnego bufora w pierścieniu.
+      */
+      unsigned int Next = 0;
+};
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+TextureUploader::TextureUploader(){
+}
+
+void TextureUploader::Destroy(){
+   for( unsigned int i = 0; i < this->Fences.size(); ++i ){
+      if( this->Fences[i] != 0 ){
+         glDeleteSync( this->Fences[i] );
+      }
+   }
+   if( ! this->Buffers.empty() ){
+      glDeleteBuffers( this->Buffers.size(), &this->Buffers[0] );
+   }
+   this->Fences.clear();
+   this->Buffers.clear();
+   this->Next = 0;
+}
+
+void TextureUploader::Init( int buffers ){
+   this->Buffers.resize( buffers );
+   this->Fences.assign( buffers, 0 );
+   this->Next = 0;
+   glGenBuffers( buffers, &this->Buffers[0] );
+}
+
+bool TextureUploader::IsEnabled() const{
+   return ! this->Buffers.empty();
+}
+
+bool TextureUploader::IsReady(){
+   GLsync &Fence = this->Fences[ this->Next ];
+   if( Fence == 0 ){
+      return true;
+   }
+   /*
+      Sprawdzenie bez czekania (timeout 0).
+   */
+   GLenum Status = glClientWaitSync( Fence, 0, 0 );
+   if( Status == GL_ALREADY_SIGNALED or Status == GL_CONDITION_SATISFIED ){
+      glDeleteSync( Fence );
+      Fence = 0;
+      return true;
+   }
+   return false;
+}
+
+bool TextureUploader::Upload( const char *img_path_file, const ImageData &data, GLuint &image ){
+   PROFILE_SCOPE_DETAIL( "TextureUploader::Upload", img_path_file );
+   GLsizeiptr Size = ReturnImageSize( data );
+   glBindBuffer( GL_PIXEL_UNPACK_BUFFER, this->Buffers[ this->Next ] );
+   /*
+      Nowa pamięć bufora (stara zostaje, dopóki GPU z niej czyta), więc mapowanie nie czeka na GPU.
+   */
+   glBufferData( GL_PIXEL_UNPACK_BUFFER, Size, NULL, GL_STREAM_DRAW );
+   void *Memory = glMapBufferRange( GL_PIXEL_UNPACK_BUFFER, 0, Size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT );
+   if( Memory == NULL ){
+      /*
+         Bez mapowania tekstura przekazywana jest bezpośrednio.
+      */
+      glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+      return UploadImg( img_path_file, data, image );
+   }
+   /*
+      Przygotowane poziomy mipmapy jeden za drugim (tak jak czyta je UploadImg).
+   */
+   if( data.Levels.empty() ){
+      memcpy( Memory, &data.Pixels[0], Size );
+   }
+   else{
+      unsigned char *Target = (unsigned char *)Memory;
+      for( unsigned int i = 0; i < data.Levels.size(); ++i ){
+         memcpy( Target, data.Levels[i].Data, data.Levels[i].Size );
+         Target += data.Levels[i].Size;
+      }
+   }
+   glUnmapBuffer( GL_PIXEL_UNPACK_BUFFER );
+   /*
+      Piksele czytane są z bufora (przesunięcie 0).
+   */
+   bool Result = UploadImg( img_path_file, data, image, true );
+   glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+   this->Fences[ this->Next ] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+   this->Next = ( this->Next + 1 ) % this->Buffers.size();
+   return Result;
+}
+
+#endif
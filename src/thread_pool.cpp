@@ -0,0 +1,165 @@
+/*!
+   \file thread_pool.cpp
+   \brief Plik odpowiedzialny za pulę wątków roboczych.
+*/
+#ifndef __thread_pool_hpp__
+#define __thread_pool_hpp__
+
+/*!
+   \brief Klasa odpowiedzialna za pulę wątków wykonujących zadania z kolejki.
+
+   Zadania nie mogą wywoływać funkcji OpenGL, kontekst OpenGL istnieje tylko w wątku głównym.
+*/
+class ThreadPool{
+   public:
+      /*!
+         \brief Konstruktor domyślny, nie uruchamia wątków.
+      */
+      ThreadPool();
+      /*!
+         \brief Destruktor.
+
+         Czeka na zakończenie wszystkich zadań i zatrzymuje wątki.
+      */
+      ~ThreadPool();
+      /*!
+         \brief Uruchamia wątki.
+
+         \param threads - ilość wątków, 0 = ilość rdzeni procesora
+      */
+      void Start( int threads );
+      /*!
+         \brief Dodaje zadanie do kolejki.
+
+         \param task - zadanie
+
+         Gdy pula nie ma wątków, zadanie wykonywane jest od razu w wątku wywołującym.
+      */
+      void Add( function <void()> task );
+      /*!
+         \brief Czeka na zakończenie wszystkich zadań z kolejki.
+      */
+      void Wait();
+      /*!
+         \brief Zwraca ilość wątków.
+      */
+      int ReturnThreads() const;
+   private:
+      /*!
+         \brief Pętla wątku roboczego.
+      */
+      void Worker();
+      /*!
+         \brief Wątki robocze.
+      */
+      vector <thread> Threads;
+      /*!
+         \brief Kolejka zadań.
+      */
+      deque < function <void()> > Tasks;
+      /*!
+         \brief Ilość zadań w kolejce i w trakcie wykonywania.
+      */
+      int Pending = 0;
+      /*!
+         \brief TRUE = wątki mają się zakończyć.
+      */
+      bool Stop = false;
+      /*!
+         \brief Blokada dla kolejki zadań.
+      */
+      mutex Lock;
+      /*!
+         \brief Sygnał nowego zadania (dla wątków roboczych).
+      */
+      condition_variable TaskReady;
+      /*!
+         \brief Sygnał zakończenia wszystkich zadań (dla \link Wait() \endlink).
+      */
+      condition_variable TasksDone;
+};
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+ThreadPool::ThreadPool(){
+}
+
+ThreadPool::~ThreadPool(){
+   this->Wait();
+   {
+      lock_guard <mutex> Guard( this->Lock );
+      this->Stop = true;
+   }
+   this->TaskReady.notify_all();
+   for( unsigned int i = 0; i < this->Threads.size(); ++i ){
+      this->Threads[i].join();
+   }
+}
+
+void ThreadPool::Start( int threads ){
+   if( threads <= 0 ){
+      threads = thread::hardware_concurrency();
+   }
+   if( threads <= 0 ){
+      threads = 1;
+   }
+   for( int i = 0; i < threads; ++i ){
+      this->Threads.push_back( thread( &ThreadPool::Worker, this ) );
+   }
+}
+
+void ThreadPool::Add( function <void()> task ){
+   if( this->Threads.empty() ){
+      task();
+      return;
+   }
+   {
+      lock_guard <mutex> Guard( this->Lock );
+      this->Tasks.push_back( task );
+      ++this->Pending;
+   }
+   this->TaskReady.notify_one();
+}
+
+void ThreadPool::Wait(){
+   unique_lock <mutex> Guard( this->Lock );
+   while( this->Pending > 0 ){
+      this->TasksDone.wait( Guard );
+   }
+}
+
+int ThreadPool::ReturnThreads() const{
+   return this->Threads.size();
+}
+
+void ThreadPool::Worker(){
+   PROFILE_THREAD( "worker" );
+   while( true ){
+      function <void()> Task;
+      {
+         unique_lock <mutex> Guard( this->Lock );
+         while( ! this->Stop and this->Tasks.empty() ){
+            this->TaskReady.wait( Guard );
+         }
+         if( this->Stop and this->Tasks.empty() ){
+            return;
+         }
+         Task = this->Tasks.front();
+         this->Tasks.pop_front();
+      }
+      Task();
+      {
+         lock_guard <mutex> Guard( this->Lock );
+         --this->Pending;
+         if( this->Pending == 0 ){
+            this->TasksDone.notify_all();
+         }
+      }
+   }
+}
+
+#endif
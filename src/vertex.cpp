@@ -0,0 +1,172 @@
+/*!
+   \file vertex.cpp
+   \brief Plik odpowiedzialny za formaty wierzchołków (przeplatane, opcjonalnie kwantyzowane).
+*/
+#ifndef __vertex_hpp__
+#define __vertex_hpp__
+
+/*!
+   \brief Format wierzchołków w buforze OpenGL.
+*/
+enum VertexFormat{
+   /*!
+      \brief \link Vertex \endlink - pozycja, UV Mapa i normalna jako float (32 bajty).
+   */
+   VERTEX_FLOAT = 0,
+   /*!
+      \brief \link PackedVertex \endlink - pozycja 16 bitów, UV Mapa half float, normalna 10_10_10_2 (16 bajtów).
+   */
+   VERTEX_PACKED
+};
+
+/*!
+   \brief Wierzchołek przeplatany (format \link VERTEX_FLOAT \endlink ).
+*/
+struct Vertex{
+   /*!
+      \brief Pozycja.
+   */
+   vec3 Position;
+   /*!
+      \brief UV Mapa.
+   */
+   vec2 Uv;
+   /*!
+      \brief Normalna.
+   */
+   vec3 Normal;
+};
+
+/*!
+   \brief Wierzchołek przeplatany i kwantyzowany (format \link VERTEX_PACKED \endlink ).
+*/
+struct PackedVertex{
+   /*!
+      \brief Pozycja jako znormalizowany short (-1 do 1 w prostopadłościanie obiektu, patrz \link VertexQuantization \endlink ), czwarta wartość wyrównuje do 8 bajtów.
+   */
+   int16_t Position[4];
+   /*!
+      \brief UV Mapa jako dwa half float.
+   */
+   uint32_t Uv;
+   /*!
+      \brief Normalna jako znormalizowane 10_10_10_2 (GL_INT_2_10_10_10_REV).
+   */
+   uint32_t Normal;
+};
+
+/*!
+   \brief Przeliczenie kwantyzowanej pozycji na pozycję obiektu: pozycja * Scale + Offset.
+*/
+struct VertexQuantization{
+   /*!
+      \brief Skala (połowa wielkości prostopadłościanu obejmującego obiekt).
+   */
+   vec3 Scale;
+   /*!
+      \brief Przesunięcie (środek prostopadłościanu obejmującego obiekt).
+   */
+   vec3 Offset;
+};
+
+/*!
+   \brief Łączy osobne wektory wierzchołków, UV Map i normalnych w wierzchołki przeplatane.
+
+   \param positions - wektor wierzchołków
+   \param uvs - wektor UV Map
+   \param normals - wektor normalnych
+   \param vertices - wierzchołki przeplatane
+*/
+void InterleaveVertices( const vector <vec3> &positions, const vector <vec2> &uvs, const vector <vec3> &normals, vector <Vertex> &vertices );
+
+/*!
+   \brief Kwantyzuje wierzchołki przeplatane.
+
+   \param vertices - wierzchołki przeplatane
+   \param packed - wierzchołki kwantyzowane
+   \param quantization - przeliczenie pozycji dla shadera
+*/
+void PackVertices( const vector <Vertex> &vertices, vector <PackedVertex> &packed, VertexQuantization &quantization );
+
+/*!
+   \brief Zwraca wielkość jednego wierzchołka w bajtach.
+
+   \param format - format wierzchołków
+*/
+GLsizei ReturnVertexStride( VertexFormat format );
+
+/*!
+   \brief Ustala wejścia shadera (0 - pozycja, 1 - UV Mapa, 2 - normalna) dla aktualnego VAO i GL_ARRAY_BUFFER.
+
+   \param format - format wierzchołków
+*/
+void SetVertexAttributes( VertexFormat format );
+
+/*
+   ========
+    SOURCE:
+   ========
+*/
+
+void InterleaveVertices( const vector <vec3> &positions, const vector <vec2> &uvs, const vector <vec3> &normals, vector <Vertex> &vertices ){
+   vertices.resize( positions.size() );
+   for( unsigned int i = 0; i < positions.size(); ++i ){
+      vertices[i].Position = positions[i];
+      vertices[i].Uv = uvs[i];
+      vertices[i].Normal = normals[i];
+   }
+}
+
+void PackVertices( const vector <Vertex> &vertices, vector <PackedVertex> &packed, VertexQuantization &quantization ){
+   /*
+      Prostopadłościan obejmujący wszystkie wierzchołki.
+   */
+   vec3 Min = vec3( 0.0f ), Max = vec3( 0.0f );
+   if( ! vertices.empty() ){
+      Min = Max = vertices[0].Position;
+   }
+   for( unsigned int i = 1; i < vertices.size(); ++i ){
+      Min = min( Min, vertices[i].Position );
+      Max = max( Max, vertices[i].Position );
+   }
+   quantization.Offset = ( Min + Max ) * 0.5f;
+   quantization.Scale = ( Max - Min ) * 0.5f;
+   for( int i = 0; i < 3; ++i ){
+      if( quantization.Scale[i] <= 0.0f ){
+         quantization.Scale[i] = 1.0f;
+      }
+   }
+   packed.resize( vertices.size() );
+   for( unsigned int i = 0; i < vertices.size(); ++i ){
+      vec3 Position = ( vertices[i].Position - quantization.Offset ) / quantization.Scale;
+      for( int j = 0; j < 3; ++j ){
+         packed[i].Position[j] = (int16_t)floor( clamp( Position[j], -1.0f, 1.0f ) * 32767.0f + 0.5f );
+      }
+      packed[i].Position[3] = 0;
+      packed[i].Uv = packHalf2x16( vertices[i].Uv );
+      packed[i].Normal = packSnorm3x10_1x2( vec4( vertices[i].Normal, 0.0f ) );
+   }
+}
+
+GLsizei ReturnVertexStride( VertexFormat format ){
+   return ( format == VERTEX_PACKED ) ? sizeof( PackedVertex ) : sizeof( Vertex );
+}
+
+void SetVertexAttributes( VertexFormat format ){
+   GLsizei Stride = ReturnVertexStride( format );
+   if( format == VERTEX_PACKED ){
+      glVertexAttribPointer( 0, 3, GL_SHORT, GL_TRUE, Stride, (GLvoid *)offsetof( PackedVertex, Position ) );
+      glVertexAttribPointer( 1, 2, GL_HALF_FLOAT, GL_FALSE, Stride, (GLvoid *)offsetof( PackedVertex, Uv ) );
+      glVertexAttribPointer( 2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, Stride, (GLvoid *)offsetof( PackedVertex, Normal ) );
+   }
+   else{
+      glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, Stride, (GLvoid *)offsetof( Vertex, Position ) );
+      glVertexAttribPointer( 1, 2, GL_FLOAT, GL_FALSE, Stride, (GLvoid *)offsetof( Vertex, Uv ) );
+      glVertexAttribPointer( 2, 3, GL_FLOAT, GL_FALSE, Stride, (GLvoid *)offsetof( Vertex, Normal ) );
+   }
+   glEnableVertexAttribArray( 0 );
+   glEnableVertexAttribArray( 1 );
+   glEnableVertexAttribArray( 2 );
+}
+
+#endif